@@ -2,19 +2,105 @@
 #define CPPDDF_HPP
 
 #include <cctype>
+#include <cerrno>
 #include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 #include <fstream>
-#include <regex>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <variant>
 #include <gstd/gstd.hpp>
 #include <ktable.hpp>
+#include "ddfsimd.hpp"
+#include "ddfpool.hpp"
+#include "ddfbuf.hpp"
 
 #define CURRENT_VERSION 2.0
+#define DDF_LONG_LINE 4096 //Inline matrix lines this long are parsed from the structural index
+#define DDF_WRITE_CHUNK 65536 //Elements per formatting task when writing in parallel
+#define DDF_SHOW_ELEMENTS 10 //Elements of each matrix printed by show()
 
 std::string bool_to_string(bool b);
+std::string float_to_string(float f);
+std::string element_string(double x);
+std::string element_string(float x);
+std::string element_string(bool x);
+std::string element_string(const std::string& x);
+std::string element_string(const std::pmr::string& x);
+template<typename T, typename A, typename S>
+void append_elements(const std::vector<T, A>& v, size_t first, size_t last, S& out);
+template<typename T, typename A, typename B, typename S>
+void append_rows(const std::vector<std::vector<T, A>, B>& m, size_t first, size_t last, S& out);
+template<typename T, typename A, typename C>
+void append_cells(const std::vector<T, A>& v, C& cells);
+template<typename T, typename A, typename B, typename C>
+void append_cells(const std::vector<std::vector<T, A>, B>& m, C& cells);
+template<typename T, typename A>
+void append_preview(const std::vector<T, A>& v, size_t max_elements, std::string& out);
+template<typename T, typename A, typename B>
+void append_preview(const std::vector<std::vector<T, A>, B>& m, size_t max_elements, std::string& out);
 bool is_2d(std::string);
+size_t ddf_heap_bytes(double x);
+size_t ddf_heap_bytes(float x);
+size_t ddf_heap_bytes(bool x);
+template<typename A>
+size_t ddf_heap_bytes(const std::basic_string<char, std::char_traits<char>, A>& s);
+template<typename A>
+size_t ddf_heap_bytes(const std::vector<bool, A>& v);
+template<typename T, typename A>
+size_t ddf_heap_bytes(const std::vector<T, A>& v);
+void ddf_shrink(double& x);
+void ddf_shrink(float& x);
+void ddf_shrink(bool& x);
+template<typename A>
+void ddf_shrink(std::basic_string<char, std::char_traits<char>, A>& s);
+template<typename A>
+void ddf_shrink(std::vector<bool, A>& v);
+template<typename T, typename A>
+void ddf_shrink(std::vector<T, A>& v);
+template<typename T, typename A>
+void ddf_empty(std::vector<T, A>& v);
+template<typename T, typename A, typename B>
+void ddf_empty(std::vector<std::vector<T, A>, B>& m);
+template<typename T, typename A, typename B, typename R>
+void put_row(std::vector<std::vector<T, A>, B>& m, size_t& rows, const R& row);
+template<typename T, typename U>
+void ddf_assign(T& dst, const U& src);
+template<typename T, typename A, typename U, typename B>
+void ddf_assign(std::vector<T, A>& dst, const std::vector<U, B>& src);
+template<typename T, typename A, typename A2, typename U, typename B, typename B2>
+void ddf_assign(std::vector<std::vector<T, A>, A2>& dst, const std::vector<std::vector<U, B>, B2>& src);
+
+struct DDFToken;
+void tokenize_line(const char* line, size_t n, const char* keep, std::vector<DDFToken>& out, bool preserve_strings=false);
+bool token_is(const DDFToken& t, const char* s);
+bool is_number_prefix(const char* s, size_t n);
+bool is_bool_word(const char* s, size_t n);
+bool is_string_literal(const char* s, size_t n);
+bool is_escaped(const char* s, size_t i, size_t from);
+bool find_string_literal(const char* s, size_t n, size_t from, size_t& q1, size_t& q2);
+template<typename S>
+void unescape_string(const char* s, size_t n, S& out);
+std::string escape_string(const char* s, size_t n);
+bool is_matrix_body(const char* s, const DDFStructIndex& idx, char type);
+bool is_valid_name(const char* s, size_t n);
+
+bool element_to_double(const std::string& line, size_t first, size_t last, double& out);
+bool element_to_bool(const std::string& line, size_t first, size_t last, bool& out);
+template<typename S>
+bool element_to_string(const std::string& line, size_t first, size_t last, S& out);
+template<typename T, typename A, typename C>
+bool index_to_vec(const std::string& line, const DDFStructIndex& idx, C convert, std::vector<T, A>& out);
+template<typename T, typename A, typename B, typename C>
+bool index_to_vec2D(const std::string& line, const DDFStructIndex& idx, C convert, std::vector<std::vector<T, A>, B>& out);
 
 //***************************************************************************//
 //**			TYPE DEFINITIONS										   **//
@@ -47,43 +133,121 @@ typedef struct{
 }DDFItem;
 
 /*
-The DDFFlatItem, ..1DITem, and ..2DItem are used to make a simple database of
-variables inside the DDFIO object. Three vectors, once of each type of struct
-contain all of the object's variables. One vector of DDFItems could contain them
-all, but would waste more memory as 1/9 variables in ea. struct would be used
-instead of 1/3. This especially helps save memory when few matrices or 2D
-matrices are used.
+Payload of one variable. Holds exactly one of the nine DDF types, so each
+variable only pays for the data it actually has. The order of the alternatives
+matters - ddf_type() and ddf_dims() read the type character and number of
+dimensions off the variant index.
+
+The last two alternatives are m<d> matrices kept in single precision (see the
+'f' load option). They are still m<d> variables - ddf_type() returns 'd'.
+
+Strings and matrices use polymorphic allocators so that a DDFIO object can keep
+all of its data in the memory resource it was given (see DDFIO(memory_resource*)).
+Rows and strings inside a matrix draw from the same resource as the matrix.
+*/
+typedef std::variant<
+	double, bool, std::pmr::string,
+	std::pmr::vector<double>, std::pmr::vector<bool>, std::pmr::vector<std::pmr::string>,
+	std::pmr::vector<std::pmr::vector<double> >, std::pmr::vector<std::pmr::vector<bool> >, std::pmr::vector<std::pmr::vector<std::pmr::string> >,
+	std::pmr::vector<float>, std::pmr::vector<std::pmr::vector<float> >
+>DDFValue;
+
+char ddf_type(const DDFValue& v);
+int ddf_dims(const DDFValue& v);
+size_t ddf_payload_bytes(const DDFValue& v);
+DDFValue ddf_copy(const DDFValue& v, std::pmr::memory_resource* resource);
+
+/*
+Index of each type in DDFValue, eg. std::get<DDF_MD>(v) is a 1D m<d>.
 */
+enum{
+	DDF_D, DDF_B, DDF_S,
+	DDF_MD, DDF_MB, DDF_MS,
+	DDF_MD2, DDF_MB2, DDF_MS2,
+	DDF_MF, DDF_MF2
+};
 
+/*
+Side table entry describing one variable. The name and description are not
+stored here - they sit back to back in the DDFIO object's 'meta_text' string
+and this records where.
+*/
 typedef struct{
-	double d;
-	std::string s;
-	bool b;
+	uint32_t name;		//Offset of name in meta_text
+	uint32_t name_len;
+	uint32_t desc;		//Offset of description in meta_text
+	uint32_t desc_len;
+}DDFMeta;
 
+/*
+A variable as a self-contained unit. Used while parsing, before the variable is
+split into the payload and side table.
+*/
+typedef struct{
 	std::string name;
-	char type;
-	std::string description; //TODO: Add code to verify desc doesn't contain newline when added by user
-}DDFFlatItem;
+	std::string description;
+	DDFValue value;
+}DDFVariable;
 
+/*
+Memory used by one variable, in bytes. 'payload' counts the DDFValue and any
+heap memory it owns. 'metadata' counts the side table entry plus the name and
+description characters.
+*/
 typedef struct{
-	std::vector<double> md;
-	std::vector<std::string> ms;
-	std::vector<bool> mb;
-
 	std::string name;
 	char type;
-	std::string description;
-}DDF1DItem;
+	int dims;
+	size_t payload;
+	size_t metadata;
+}DDFVarMemory;
 
+/*
+Describes one variable, for DDFIO::forEach() and DDFIO::info(). 'name',
+'description' and 'value' point into the DDFIO object and are valid until it
+is modified. For ragged 2D matrices 'cols' is the length of the longest row.
+Memory use isn't included as it takes a pass over string data - see
+DDFIO::memoryUsage().
+*/
 typedef struct{
-	std::vector<std::vector<double> > md2;
-	std::vector<std::vector<std::string> > ms2;
-	std::vector<std::vector<bool> > mb2;
+	std::string_view name;
+	std::string_view description;
+	size_t index;		//Position in the file (order added)
+	char type;			//'d', 'b' or 's'
+	int dims;			//0 for non-matrix variables, else 1 or 2
+	bool single;		//m<d> stored as float (see DDFIO::storeAsFloat)
+	size_t rows;		//1 for non-matrix variables and 1D matrices
+	size_t cols;
+	size_t elements;
+	const DDFValue* value; //Payload, for reading without copying
+}DDFVarInfo;
 
-	std::string name;
-	char type;
-	std::string description;
-}DDF2DItem;
+/*
+Memory used by a DDFIO object, in bytes, broken down by variable and by
+category. 'overhead' is unused capacity in the object's containers.
+*/
+typedef struct{
+	std::vector<DDFVarMemory> variables;
+
+	size_t flat;		//Payloads of non-matrix variables
+	size_t matrix1D;	//Payloads of 1D matrices
+	size_t matrix2D;	//Payloads of 2D matrices
+	size_t metadata;	//Names, descriptions and side table
+	size_t header;
+	size_t overhead;
+
+	size_t total;
+}DDFMemoryUsage;
+
+/*
+A token within a line of text, used by the validator. Points into the line
+rather than copying it. 'idx' is the token's offset from the start of the line.
+*/
+struct DDFToken{
+	const char* p;
+	size_t len;
+	size_t idx;
+};
 
 //***************************************************************************//
 //**			CLASS DEFINITIONS									   **//
@@ -95,7 +259,13 @@ public:
 	//************ INITIALIZERS
 
 	DDFIO();
+	explicit DDFIO(std::pmr::memory_resource* resource);
 	DDFIO(std::string fileIn);
+	DDFIO(const DDFIO& other);
+	DDFIO(const DDFIO& other, std::pmr::memory_resource* resource);
+	DDFIO(DDFIO&& other) = default;
+	DDFIO& operator=(const DDFIO& other);
+	DDFIO& operator=(DDFIO&& other);
 
 	//************ ADD VARIABLES
 
@@ -114,66 +284,136 @@ public:
 	void add(std::vector<std::vector<std::string> > newVar, std::string varName, std::string desc="");
 	void add(std::vector<std::vector<bool> > newVar, std::string varName, std::string desc="");
 
+	//Matrices built on a memory resource
+	template<typename T>
+	void add(std::pmr::vector<T>&& newVar, std::string varName, std::string desc="");
+	template<typename T>
+	void add(std::pmr::vector<std::pmr::vector<T> >&& newVar, std::string varName, std::string desc="");
+
 	//TODO: Add way to edit variables
 
 	//*********** READ VARIABLES
 
-	DDFItem operator()(std::string varName);
-
+	DDFItem operator()(std::string varName) const;
+
+	bool get(std::string varName, double& out) const;
+	bool get(std::string varName, std::string& out) const;
+	bool get(std::string varName, bool& out) const;
+	bool get(std::string varName, std::vector<double>& out) const;
+	bool get(std::string varName, std::vector<std::string>& out) const;
+	bool get(std::string varName, std::vector<bool>& out) const;
+	bool get(std::string varName, std::vector<std::vector<double> >& out) const;
+	bool get(std::string varName, std::vector<std::vector<std::string> >& out) const;
+	bool get(std::string varName, std::vector<std::vector<bool> >& out) const;
+	bool get(std::string varName, std::vector<float>& out) const;
+	bool get(std::string varName, std::vector<std::vector<float> >& out) const;
+	bool contains(std::string varName) const;
+	bool isFloat(std::string varName) const;
+
+	template<typename F>
+	void forEach(F fn) const;
+	bool info(const std::string& varName, DDFVarInfo& out) const;
+	bool info(size_t index, DDFVarInfo& out) const;
+
+	//*********** STATISTICS
+
+	bool stats(std::string varName, DDFStats& out, double threshold=0) const;
+	bool stats(std::vector<std::string> varNames, std::vector<DDFStats>& out, double threshold=0) const;
+	bool rowStats(std::string varName, size_t row, DDFStats& out, double threshold=0) const;
 
 	//********** FILE I/O
 
 	std::string swrite(std::string fileOut, std::string options=""); //TODO: swrite should not have a 'fileOut' parameter
 	bool write(std::string fileOut, std::string options="");
 	bool load(std::string fileIn, std::string options="");
+	bool load(std::istream& file, std::string options="");
+	bool sload(std::string_view data, std::string options="");
+	bool fdload(int fd, std::string options="");
 	bool loadDDF_V1(std::string fileIn, std::string options="");
+	bool loadDDF_V1(std::istream& file, std::string options="");
 	bool clload(std::string fileIn);
 
+	bool validate(std::string fileIn, size_t max_errors=1);
+	bool validate(std::istream& file, size_t max_errors=1);
+
 
 	//*************** VARIABLE MANAGEMENT
 
 	bool checkContains(std::vector<std::string> names);
 	void clear();
-	size_t numVar();
+	size_t numVar() const;
+	void storeAsFloat(std::string varName, bool as_float=true);
+	void reuse(bool enable=true);
+	void shrink();
+	DDFMemoryUsage memoryUsage() const;
+	std::pmr::memory_resource* resource() const;
 
 	//*************** HEADER
 
 	void setHeader(std::string h);
-	std::string getHeader();
+	std::string getHeader() const;
 
-	double getVersion();
-	std::string err();
+	double getVersion() const;
+	std::string err() const;
 
 	//************** PRINTING
 
-	std::vector<std::string> names(std::string options="");
-	std::string show();
+	std::vector<std::string> names(std::string options="") const;
+	std::string show(size_t preview=DDF_SHOW_ELEMENTS) const;
 
 
 private:
 
-	std::vector<DDFFlatItem> variablesFlat;
-	std::vector<DDF1DItem> variables1D;
-	std::vector<DDF2DItem> variables2D;
+	std::pmr::memory_resource* memres; //Source of the memory below - see DDFIO(memory_resource*)
+
+	std::pmr::vector<DDFValue> values;	//One payload per variable, in the order added
+	std::pmr::vector<DDFMeta> meta;		//Side table - meta[i] describes values[i]
+	std::pmr::string meta_text;			//Names and descriptions, referenced by 'meta'
+
+	std::map<std::string, bool> float_override; //Per-variable storeAsFloat() settings
+
+	bool reuse_mode;				//See reuse()
+	std::pmr::vector<DDFValue> spare;	//Payloads kept by clear() in reuse mode, by position
 
 	void initialize();
+	void copyFrom(const DDFIO& other);
+
+	bool parseDDF_V1(std::istream& file, std::string options, size_t lineNum);
+	bool validateDDF_V1(std::istream& file, size_t max_errors);
 
 	bool isValidName(std::string name);
 	bool nameInUse(std::string name);
 
+	void store(DDFVariable& var, bool use_float=false);
+	void setStorage(DDFValue& v, bool as_float);
+	template<size_t I>
+	std::variant_alternative_t<I, DDFValue>& recycled(DDFValue& v);
+	size_t find(const std::string& name) const;
+	std::vector<size_t> indicesOf(int dims) const;
+	std::string nameOf(size_t idx) const;
+	std::string descOf(size_t idx) const;
+	template<size_t I, typename T>
+	bool getValue(const std::string& name, T& out) const;
+	bool reduce(size_t idx, DDFStats& out, double threshold) const;
+	DDFVarInfo infoOf(size_t idx) const;
+
 	void sortMatrices();
-	size_t matrixLength(DDF1DItem m);
-	size_t matrixLength(DDF2DItem m);
+	size_t matrixLength(const DDFValue& m) const;
+	size_t matrixRows(const DDFValue& m) const;
+	size_t rowLength(const DDFValue& m, size_t row) const;
 
-	double linaccess(std::vector<std::vector<double> > m, size_t idx);
-	bool linaccess(std::vector<std::vector<bool> > m, size_t idx);
-	std::string linaccess(std::vector<std::vector<std::string> > m, size_t idx);
+	std::vector<size_t> chunkBounds(size_t idx) const;
+	void formatRange(size_t idx, size_t first, size_t last, std::pmr::string& out) const;
+	void formatColumn(size_t idx, std::pmr::vector<std::pmr::string>& cells) const;
+	void runJobs(std::vector<std::function<void()> >& jobs, bool parallel) const;
 
-	bool isRowEnd(DDF2DItem m, size_t idx);
+	std::string shapeOf(size_t idx) const;
+	std::string previewOf(size_t idx, size_t max_elements) const;
+	std::string summaryOf(size_t idx) const;
 
 	void init_ktable(KTable& kt);
 
-	std::string header;
+	std::pmr::string header;
 	double fileVersion; //version of read file
 
 	std::string err_str; //Error data string
@@ -188,18 +428,82 @@ private:
 //***************************************************************************//
 //***************** INITIALIZERS
 
-DDFIO::DDFIO(){
+DDFIO::DDFIO() : DDFIO(std::pmr::get_default_resource()){
+}
+
+/*
+Creates an empty object whose variables, side table, header and loader/writer
+buffers are all allocated from 'resource'. The resource must outlive the object.
+A short-lived load can then run out of a preallocated region:
+
+	char buf[1 << 20];
+	std::pmr::monotonic_buffer_resource arena(buf, sizeof(buf));
+	{
+		DDFIO ddf(&arena);
+		ddf.load("run.ddf");
+		...
+	}
+	arena.release(); //Everything the load allocated, freed at once
+
+Error messages and the values handed back by get() and operator() use the
+global heap.
+*/
+DDFIO::DDFIO(std::pmr::memory_resource* resource) : memres(resource), values(resource), meta(resource), meta_text(resource), spare(resource), header(resource){
 	initialize();
 }
 
 /*
 Reads the input file. Same as calling blank initializer combined with load()
 */
-DDFIO::DDFIO(std::string fileIn){
+DDFIO::DDFIO(std::string fileIn) : DDFIO(){
+	load(fileIn);
+}
+
+/*
+Copies 'other'. As with the std::pmr containers, the copy does not share the
+original's memory resource - it uses the default resource, or 'resource' if
+given.
+*/
+DDFIO::DDFIO(const DDFIO& other) : DDFIO(other, std::pmr::get_default_resource()){
+}
 
-	initialize();
+DDFIO::DDFIO(const DDFIO& other, std::pmr::memory_resource* resource) : DDFIO(resource){
+	copyFrom(other);
+}
 
-	load(fileIn);
+/*
+Replaces the contents with a copy of 'other'. Keeps this object's memory
+resource.
+*/
+DDFIO& DDFIO::operator=(const DDFIO& other){
+	if (this != &other) copyFrom(other);
+	return *this;
+}
+
+/*
+Takes the contents of 'other'. If the two objects use different memory
+resources the contents are copied instead, so this object's data stays in its
+own resource.
+*/
+DDFIO& DDFIO::operator=(DDFIO&& other){
+
+	if (this == &other) return *this;
+	if (memres != other.memres){
+		copyFrom(other);
+		return *this;
+	}
+
+	values = std::move(other.values);
+	meta = std::move(other.meta);
+	meta_text = std::move(other.meta_text);
+	float_override = std::move(other.float_override);
+	reuse_mode = other.reuse_mode;
+	spare = std::move(other.spare);
+	header = std::move(other.header);
+	fileVersion = other.fileVersion;
+	err_str = std::move(other.err_str);
+
+	return *this;
 }
 
 /*
@@ -208,7 +512,31 @@ Initialize the object
 void DDFIO::initialize(){
 
 	fileVersion = CURRENT_VERSION;
+	reuse_mode = false;
+
+}
+
+/*
+Replaces the contents with a deep copy of 'other', allocated from this object's
+memory resource. Payloads kept for reuse() are not copied.
+*/
+void DDFIO::copyFrom(const DDFIO& other){
+
+	values.clear();
+	values.reserve(other.values.size());
+	for (size_t i = 0 ; i < other.values.size() ; i++){
+		values.push_back(ddf_copy(other.values[i], memres));
+	}
+	meta.assign(other.meta.begin(), other.meta.end());
+	meta_text = other.meta_text;
+
+	float_override = other.float_override;
+	reuse_mode = other.reuse_mode;
+	spare.clear();
 
+	header = other.header;
+	fileVersion = other.fileVersion;
+	err_str = other.err_str;
 }
 
 //***************************************************************************//
@@ -218,7 +546,8 @@ void DDFIO::initialize(){
 
 /*
 Adds a variable to the DDFIO object. Retuns without adding variable if name is
-invalid or already in use.
+invalid or already in use. The value is copied into the object's memory
+resource.
 */
 
 
@@ -227,13 +556,12 @@ void DDFIO::add(double newVar, std::string varName, std::string desc){
 	//Check that name is valid and unclaimed
 	if ( (!isValidName(varName)) || nameInUse(varName)) return;
 
-	DDFFlatItem newItem; 	//Create new item
-	newItem.d = newVar;		//Give new item correct value
-	newItem.name = varName; //Give new item
-	newItem.type = 'd';		//Specify type
+	DDFVariable newItem; 		//Create new item
+	newItem.value = std::move(newVar);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
 	newItem.description = desc; //Add description
 
-	variablesFlat.push_back(newItem); //Add to vector of varaiables
+	store(newItem); //Add to object's variables
 
 }
 
@@ -242,13 +570,12 @@ void DDFIO::add(std::string newVar, std::string varName, std::string desc){
 	//Check that name is valid and unclaimed
 	if ( (!isValidName(varName)) || nameInUse(varName)) return;
 
-	DDFFlatItem newItem; 	//Create new item
-	newItem.s = newVar;		//Give new item correct value
-	newItem.name = varName; //Give new item
-	newItem.type = 's';		//Specify type
+	DDFVariable newItem; 		//Create new item
+	newItem.value.emplace<DDF_S>(newVar, memres);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
 	newItem.description = desc; //Add description
 
-	variablesFlat.push_back(newItem); //Add to vector of varaiables
+	store(newItem); //Add to object's variables
 
 }
 
@@ -257,13 +584,12 @@ void DDFIO::add(bool newVar, std::string varName, std::string desc){
 	//Check that name is valid and unclaimed
 	if ( (!isValidName(varName)) || nameInUse(varName)) return;
 
-	DDFFlatItem newItem; 	//Create new item
-	newItem.b = newVar;		//Give new item correct value
-	newItem.name = varName; //Give new item
-	newItem.type = 'b';		//Specify type
+	DDFVariable newItem; 		//Create new item
+	newItem.value = std::move(newVar);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
 	newItem.description = desc; //Add description
 
-	variablesFlat.push_back(newItem); //Add to vector of varaiables
+	store(newItem); //Add to object's variables
 
 }
 
@@ -274,13 +600,12 @@ void DDFIO::add(std::vector<double> newVar, std::string varName, std::string des
 	//Check that name is valid and unclaimed
 	if ( (!isValidName(varName)) || nameInUse(varName)) return;
 
-	DDF1DItem newItem; 		//Create new item
-	newItem.md = newVar;	//Give new item correct value
-	newItem.name = varName; //Give new item
-	newItem.type = 'd';		//Specify type
+	DDFVariable newItem; 		//Create new item
+	ddf_assign(newItem.value.emplace<DDF_MD>(memres), newVar);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
 	newItem.description = desc; //Add description
 
-	variables1D.push_back(newItem); //Add to vector of varaiables
+	store(newItem); //Add to object's variables
 
 }
 
@@ -289,13 +614,12 @@ void DDFIO::add(std::vector<std::string> newVar, std::string varName, std::strin
 	//Check that name is valid and unclaimed
 	if ( (!isValidName(varName)) || nameInUse(varName)) return;
 
-	DDF1DItem newItem; 		//Create new item
-	newItem.ms = newVar;	//Give new item correct value
-	newItem.name = varName; //Give new item
-	newItem.type = 's';		//Specify type
+	DDFVariable newItem; 		//Create new item
+	ddf_assign(newItem.value.emplace<DDF_MS>(memres), newVar);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
 	newItem.description = desc; //Add description
 
-	variables1D.push_back(newItem); //Add to vector of varaiables
+	store(newItem); //Add to object's variables
 
 }
 
@@ -304,13 +628,12 @@ void DDFIO::add(std::vector<bool> newVar, std::string varName, std::string desc)
 	//Check that name is valid and unclaimed
 	if ( (!isValidName(varName)) || nameInUse(varName)) return;
 
-	DDF1DItem newItem; 		//Create new item
-	newItem.mb = newVar;	//Give new item correct value
-	newItem.name = varName; //Give new item
-	newItem.type = 'b';		//Specify type
+	DDFVariable newItem; 		//Create new item
+	ddf_assign(newItem.value.emplace<DDF_MB>(memres), newVar);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
 	newItem.description = desc; //Add description
 
-	variables1D.push_back(newItem); //Add to vector of varaiables
+	store(newItem); //Add to object's variables
 
 }
 
@@ -321,13 +644,12 @@ void DDFIO::add(std::vector<std::vector<double> > newVar, std::string varName, s
 	//Check that name is valid and unclaimed
 	if ( (!isValidName(varName)) || nameInUse(varName)) return;
 
-	DDF2DItem newItem; 		//Create new item
-	newItem.md2 = newVar;	//Give new item correct value
-	newItem.name = varName; //Give new item
-	newItem.type = 'd';		//Specify type
+	DDFVariable newItem; 		//Create new item
+	ddf_assign(newItem.value.emplace<DDF_MD2>(memres), newVar);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
 	newItem.description = desc; //Add description
 
-	variables2D.push_back(newItem); //Add to vector of varaiables
+	store(newItem); //Add to object's variables
 
 }
 
@@ -336,13 +658,12 @@ void DDFIO::add(std::vector<std::vector<std::string> > newVar, std::string varNa
 	//Check that name is valid and unclaimed
 	if ( (!isValidName(varName)) || nameInUse(varName)) return;
 
-	DDF2DItem newItem; 		//Create new item
-	newItem.ms2 = newVar;	//Give new item correct value
-	newItem.name = varName; //Give new item
-	newItem.type = 's';		//Specify type
+	DDFVariable newItem; 		//Create new item
+	ddf_assign(newItem.value.emplace<DDF_MS2>(memres), newVar);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
 	newItem.description = desc; //Add description
 
-	variables2D.push_back(newItem); //Add to vector of varaiables
+	store(newItem); //Add to object's variables
 
 }
 
@@ -351,14 +672,249 @@ void DDFIO::add(std::vector<std::vector<bool> > newVar, std::string varName, std
 	//Check that name is valid and unclaimed
 	if ( (!isValidName(varName)) || nameInUse(varName)) return;
 
-	DDF2DItem newItem; 		//Create new item
-	newItem.mb2 = newVar;	//Give new item correct value
-	newItem.name = varName; //Give new item
-	newItem.type = 'b';		//Specify type
+	DDFVariable newItem; 		//Create new item
+	ddf_assign(newItem.value.emplace<DDF_MB2>(memres), newVar);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
+	newItem.description = desc; //Add description
+
+	store(newItem); //Add to object's variables
+
+}
+
+//******  Matrices on a memory resource **********
+
+/*
+Adds a matrix built with polymorphic allocators, taking over its buffers if it
+uses this object's memory resource and copying it into the resource otherwise.
+'T' is double, bool or std::pmr::string.
+
+	std::pmr::vector<double> v(ddf.resource());
+	...
+	ddf.add(std::move(v), "v");
+*/
+template<typename T>
+void DDFIO::add(std::pmr::vector<T>&& newVar, std::string varName, std::string desc){
+
+	//Check that name is valid and unclaimed
+	if ( (!isValidName(varName)) || nameInUse(varName)) return;
+
+	DDFVariable newItem; 		//Create new item
+	newItem.value.emplace<std::pmr::vector<T> >(std::move(newVar), memres);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
+	newItem.description = desc; //Add description
+
+	store(newItem); //Add to object's variables
+
+}
+
+template<typename T>
+void DDFIO::add(std::pmr::vector<std::pmr::vector<T> >&& newVar, std::string varName, std::string desc){
+
+	//Check that name is valid and unclaimed
+	if ( (!isValidName(varName)) || nameInUse(varName)) return;
+
+	DDFVariable newItem; 		//Create new item
+	newItem.value.emplace<std::pmr::vector<std::pmr::vector<T> > >(std::move(newVar), memres);	//Give new item correct value
+	newItem.name = varName; 	//Give new item
 	newItem.description = desc; //Add description
 
-	variables2D.push_back(newItem); //Add to vector of varaiables
+	store(newItem); //Add to object's variables
+
+}
+
+//***************************************************************************//
+//*************** READ VARIABLES
+
+/*
+Const methods don't modify the object - they can be called from any number of
+threads at once, as long as no thread is changing the object (eg. through a
+DDFSnapshot, see ddfsnapshot.hpp).
+*/
+
+/*
+Returns the variable 'varName' in a DDFItem, with the field matching its type
+filled in. Returns a blank DDFItem if there is no such variable.
+*/
+DDFItem DDFIO::operator()(std::string varName) const{
+
+	DDFItem item;
+	item.d = 0;
+	item.b = false;
+
+	size_t idx = find(varName);
+	if (idx == DDF_NPOS) return item;
+
+	switch(values[idx].index()){
+		case(DDF_D):
+			item.d = std::get<DDF_D>(values[idx]);
+			break;
+		case(DDF_B):
+			item.b = std::get<DDF_B>(values[idx]);
+			break;
+		case(DDF_S):
+			ddf_assign(item.s, std::get<DDF_S>(values[idx]));
+			break;
+		case(DDF_MD):
+			ddf_assign(item.md, std::get<DDF_MD>(values[idx]));
+			break;
+		case(DDF_MB):
+			ddf_assign(item.mb, std::get<DDF_MB>(values[idx]));
+			break;
+		case(DDF_MS):
+			ddf_assign(item.ms, std::get<DDF_MS>(values[idx]));
+			break;
+		case(DDF_MD2):
+			ddf_assign(item.md2, std::get<DDF_MD2>(values[idx]));
+			break;
+		case(DDF_MB2):
+			ddf_assign(item.mb2, std::get<DDF_MB2>(values[idx]));
+			break;
+		case(DDF_MS2):
+			ddf_assign(item.ms2, std::get<DDF_MS2>(values[idx]));
+			break;
+		case(DDF_MF):
+			ddf_assign(item.md, std::get<DDF_MF>(values[idx]));
+			break;
+		case(DDF_MF2):
+			ddf_assign(item.md2, std::get<DDF_MF2>(values[idx]));
+			break;
+	}
+
+	return item;
+}
+
+/*
+Copies the variable 'varName' into 'out'. Returns false, leaving 'out'
+unchanged, if there is no such variable or it has a different type. Doesn't
+touch the error string, so it's safe to call from concurrent readers.
+*/
+bool DDFIO::get(std::string varName, double& out) const{
+	return getValue<DDF_D>(varName, out);
+}
+
+bool DDFIO::get(std::string varName, std::string& out) const{
+	return getValue<DDF_S>(varName, out);
+}
+
+bool DDFIO::get(std::string varName, bool& out) const{
+	return getValue<DDF_B>(varName, out);
+}
+
+bool DDFIO::get(std::string varName, std::vector<double>& out) const{
+
+	size_t idx = find(varName);
+	if (idx != DDF_NPOS && values[idx].index() == DDF_MF){ //Widen
+		ddf_assign(out, std::get<DDF_MF>(values[idx]));
+		return true;
+	}
+
+	return getValue<DDF_MD>(varName, out);
+}
+
+bool DDFIO::get(std::string varName, std::vector<std::string>& out) const{
+	return getValue<DDF_MS>(varName, out);
+}
+
+bool DDFIO::get(std::string varName, std::vector<bool>& out) const{
+	return getValue<DDF_MB>(varName, out);
+}
+
+bool DDFIO::get(std::string varName, std::vector<std::vector<double> >& out) const{
+
+	size_t idx = find(varName);
+	if (idx != DDF_NPOS && values[idx].index() == DDF_MF2){ //Widen
+		ddf_assign(out, std::get<DDF_MF2>(values[idx]));
+		return true;
+	}
+
+	return getValue<DDF_MD2>(varName, out);
+}
+
+bool DDFIO::get(std::string varName, std::vector<std::vector<std::string> >& out) const{
+	return getValue<DDF_MS2>(varName, out);
+}
+
+bool DDFIO::get(std::string varName, std::vector<std::vector<bool> >& out) const{
+	return getValue<DDF_MB2>(varName, out);
+}
+
+/*
+Copies an m<d> variable stored in single precision (see storeAsFloat()) into
+'out' without widening it. Returns false if there is no such variable or it is
+kept as doubles.
+*/
+bool DDFIO::get(std::string varName, std::vector<float>& out) const{
+	return getValue<DDF_MF>(varName, out);
+}
+
+bool DDFIO::get(std::string varName, std::vector<std::vector<float> >& out) const{
+	return getValue<DDF_MF2>(varName, out);
+}
+
+/*
+Returns true if a variable called 'varName' exists.
+*/
+bool DDFIO::contains(std::string varName) const{
+	return (find(varName) != DDF_NPOS);
+}
+
+/*
+Returns true if 'varName' is an m<d> matrix stored in single precision.
+*/
+bool DDFIO::isFloat(std::string varName) const{
+
+	size_t idx = find(varName);
+	if (idx == DDF_NPOS) return false;
+
+	return (values[idx].index() == DDF_MF || values[idx].index() == DDF_MF2);
+}
+
+/*
+Calls 'fn' with a DDFVarInfo for each variable, in file order. Nothing is
+allocated, so it is cheap enough to call in a loop to discover variables.
+
+	ddf.forEach([](const DDFVarInfo& v){
+		std::cout << v.name << " " << v.rows << "x" << v.cols << std::endl;
+	});
+
+If 'fn' returns a bool, iteration stops as soon as it returns false.
+*/
+template<typename F>
+void DDFIO::forEach(F fn) const{
+
+	for (size_t i = 0 ; i < values.size() ; i++){
+		DDFVarInfo v = infoOf(i);
+		if constexpr (std::is_same<decltype(fn(v)), bool>::value){
+			if (!fn(v)) return;
+		}else{
+			fn(v);
+		}
+	}
+}
+
+/*
+Saves the descriptor of variable 'varName' in 'out'. Returns false if there is
+no such variable.
+*/
+bool DDFIO::info(const std::string& varName, DDFVarInfo& out) const{
+
+	size_t idx = find(varName);
+	if (idx == DDF_NPOS) return false;
+
+	out = infoOf(idx);
+	return true;
+}
+
+/*
+Saves the descriptor of the variable at position 'index' (in file order) in
+'out'. Returns false if 'index' is out of range.
+*/
+bool DDFIO::info(size_t index, DDFVarInfo& out) const{
+
+	if (index >= values.size()) return false;
 
+	out = infoOf(index);
+	return true;
 }
 
 //***************************************************************************//
@@ -376,6 +932,8 @@ Options: (Order does not matter. Case-sensitive)
 	;: Terminate variable statements with the optional semicolon
 	s: Sort vectors largest to smallest
 	u: Undocumented - variable descriptions are not printed
+	p: Parallel - format matrices on the shared thread pool. Large matrices are
+		split into several tasks. The output is the same as without 'p'.
 
 In the event of an error, it returns a blank string.
 */
@@ -390,6 +948,7 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 	std::string term_char = "";
 	bool sort_mats = false;
 	bool show_descriptions = true;
+	bool parallel = false;
 
 	//Read in options
 	if (options.find("v", 0) != std::string::npos){
@@ -413,6 +972,9 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 	if (options.find("u", 0) != std::string::npos){
 		show_descriptions = false;
 	}
+	if (options.find("p", 0) != std::string::npos){
+		parallel = true;
+	}
 
 	//********************** Write version statement *************************//
 	ddf = ddf + "#VERSION " + std::string(std::to_string(CURRENT_VERSION)) + "\n";
@@ -420,31 +982,35 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 
 	//*********************** Write header statement *************************//
 	if (header.length() > 0 && !decapitate){
-		ddf = ddf + "#HEADER\n" + header + "\n#HEADER\n";
+		ddf = ddf + "#HEADER\n";
+		ddf += header;
+		ddf = ddf + "\n#HEADER\n";
 		if (!optimize) ddf = ddf + "\n";
 	}
 
 
 	//********************** Write Flat Variables ****************************//
 
+	std::vector<size_t> flat = indicesOf(0);
+
 	//For each variable...
-	for (size_t i = 0 ; i < variablesFlat.size() ; i++){
+	for (size_t i = 0 ; i < flat.size() ; i++){
 
 		//Write type, name, value
-		switch(variablesFlat[i].type){
+		switch(ddf_type(values[flat[i]])){
 			case('d'):
-				ddf = ddf + "d " + variablesFlat[i].name + " " + gstd::to_gstring(variablesFlat[i].d) + term_char; //Add variable
-				if (variablesFlat[i].description.length() > 0 && show_descriptions) ddf = ddf + " ?" + variablesFlat[i].description; //Add description if applicable
+				ddf = ddf + "d " + nameOf(flat[i]) + " " + gstd::to_gstring(std::get<DDF_D>(values[flat[i]])) + term_char; //Add variable
+				if (descOf(flat[i]).length() > 0 && show_descriptions) ddf = ddf + " ?" + descOf(flat[i]); //Add description if applicable
 				ddf = ddf + "\n"; //Add newline
 				break;
 			case('b'):
-				ddf = ddf + "b " + variablesFlat[i].name + " " + bool_to_string(variablesFlat[i].b) + term_char;  //Add variable
-				if (variablesFlat[i].description.length() > 0 && show_descriptions) ddf = ddf + " ?" + variablesFlat[i].description; //Add description if applicable
+				ddf = ddf + "b " + nameOf(flat[i]) + " " + bool_to_string(std::get<DDF_B>(values[flat[i]])) + term_char;  //Add variable
+				if (descOf(flat[i]).length() > 0 && show_descriptions) ddf = ddf + " ?" + descOf(flat[i]); //Add description if applicable
 				ddf = ddf + "\n"; //Add newline
 				break;
 			case('s'):
-				ddf = ddf + "s " + variablesFlat[i].name + " \"" + variablesFlat[i].s + "\"" + term_char;  //Add variable
-				if (variablesFlat[i].description.length() > 0 && show_descriptions) ddf = ddf + " ?" + variablesFlat[i].description; //Add description if applicable
+				ddf = ddf + "s " + nameOf(flat[i]) + " " + element_string(std::get<DDF_S>(values[flat[i]])) + term_char;  //Add variable
+				if (descOf(flat[i]).length() > 0 && show_descriptions) ddf = ddf + " ?" + descOf(flat[i]); //Add description if applicable
 				ddf = ddf + "\n"; //Add newline
 				break;
 			default:
@@ -456,6 +1022,9 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 	//Sort matrices if requested or requried (required for vertical writing)
 	if (sort_mats || vertical_mode) sortMatrices();
 
+	std::vector<size_t> m1d = indicesOf(1);
+	std::vector<size_t> m2d = indicesOf(2);
+
 	if (vertical_mode){ //******************** Write matrices - Vertical Mode ***********//
 
 		//TODO: Optimized veritcal mode not using KTable, instead using spaces
@@ -473,8 +1042,8 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 			//Write types
 			//
 			std::vector<std::string> trow;
-			for (size_t i = 0 ; i < variables1D.size() ; i++){
-				switch(variables1D[i].type){
+			for (size_t i = 0 ; i < m1d.size() ; i++){
+				switch(ddf_type(values[m1d[i]])){
 					case('d'):
 						trow.push_back("m<d>");
 						break;
@@ -494,8 +1063,8 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 			//Write names
 			//
 			trow.clear();
-			for (size_t i = 0 ; i < variables1D.size() ; i++){
-				trow.push_back(variables1D[i].name);
+			for (size_t i = 0 ; i < m1d.size() ; i++){
+				trow.push_back(nameOf(m1d[i]));
 			}
 			//
 			kt.row(trow);
@@ -511,12 +1080,12 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 				bool all_descr_blank = true; //Will let code skip description if all blank
 
 				trow.clear();
-				for (size_t i = 0 ; i < variables1D.size() ; i++){ //Get descr for 1D vars
+				for (size_t i = 0 ; i < m1d.size() ; i++){ //Get descr for 1D vars
 
-					if (variables1D[i].description.find("?", 0) != std::string::npos){ //Skip desc if it contains key symbol '?''
+					if (descOf(m1d[i]).find("?", 0) != std::string::npos){ //Skip desc if it contains key symbol '?''
 						trow.push_back("?");
 					}else{
-						trow.push_back("?" + variables1D[i].description); //Else print desc
+						trow.push_back("?" + descOf(m1d[i])); //Else print desc
 						all_descr_blank = false;
 					}
 
@@ -526,8 +1095,16 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 
 			}
 
-			//Write data lines
+			//Write data lines - each matrix's column is formatted first (in parallel
+			//if requested), then the columns are laid out row by row
 			//
+			std::pmr::vector<std::pmr::vector<std::pmr::string> > cells(m1d.size(), memres);
+			std::vector<std::function<void()> > jobs;
+			for (size_t i = 0 ; i < m1d.size() ; i++){
+				jobs.push_back([this, &cells, &m1d, i](){ formatColumn(m1d[i], cells[i]); });
+			}
+			runJobs(jobs, parallel);
+
 			bool still_printing;
 			size_t row = 0;
 			do{ //While any matrix still has data to print...
@@ -536,29 +1113,11 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 
 				still_printing = false;
 
-				for (size_t i = 0 ; i < variables1D.size() ; i++){ //For each 1D matrix...
-
-					switch(variables1D[i].type){ //Find out its type...
-						case('d'):
-							if (row < variables1D[i].md.size()){ //See if it has data to print...
-								still_printing  = true; //Set printing to true
-								trow.push_back(gstd::to_gstring(variables1D[i].md[row])); //Add its data point
-							}
-							break;
-						case('b'):
-							if (row < variables1D[i].mb.size()){ //See if it has data to print...
-								still_printing  = true; //Set printing to true
-								trow.push_back(bool_to_string(variables1D[i].mb[row])); //Add its data point
-							}
-							break;
-						case('s'):
-							if (row < variables1D[i].ms.size()){ //See if it has data to print...
-								still_printing  = true; //Set printing to true
-								trow.push_back("\"" + variables1D[i].ms[row] + "\""); //Add its data point
-							}
-							break;
+				for (size_t i = 0 ; i < m1d.size() ; i++){ //For each 1D matrix...
+					if (row < cells[i].size()){ //See if it has data to print...
+						still_printing  = true; //Set printing to true
+						trow.emplace_back(cells[i][row]); //Add its data point
 					}
-
 				}
 
 				kt.row(trow);
@@ -596,8 +1155,8 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 			//Write types
 			//
 			std::vector<std::string> trow;
-			for (size_t i = 0 ; i < variables2D.size() ; i++){
-				switch(variables2D[i].type){
+			for (size_t i = 0 ; i < m2d.size() ; i++){
+				switch(ddf_type(values[m2d[i]])){
 					case('d'):
 						trow.push_back("m<d>");
 						break;
@@ -617,8 +1176,8 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 			//Write names
 			//
 			trow.clear();
-			for (size_t i = 0 ; i < variables2D.size() ; i++){
-				trow.push_back(variables2D[i].name);
+			for (size_t i = 0 ; i < m2d.size() ; i++){
+				trow.push_back(nameOf(m2d[i]));
 			}
 			//
 			kt.row(trow);
@@ -632,12 +1191,12 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 				bool all_descr_blank = true; //Will let code skip description if all blank
 
 				trow.clear();
-				for (size_t i = 0 ; i < variables2D.size() ; i++){ //Get descrs for 2D vars
+				for (size_t i = 0 ; i < m2d.size() ; i++){ //Get descrs for 2D vars
 
-					if (variables2D[i].description.find("?", 0) != std::string::npos){ //Skip desc if it contains key symbol '?''
+					if (descOf(m2d[i]).find("?", 0) != std::string::npos){ //Skip desc if it contains key symbol '?''
 						trow.push_back("?");
 					}else{
-						trow.push_back("?" + variables2D[i].description); //Else print desc
+						trow.push_back("?" + descOf(m2d[i])); //Else print desc
 						all_descr_blank = false;
 					}
 
@@ -647,8 +1206,16 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 
 			}
 
-			//Write data lines
+			//Write data lines - each matrix's column is formatted first (in parallel
+			//if requested), then the columns are laid out row by row
 			//
+			std::pmr::vector<std::pmr::vector<std::pmr::string> > cells(m2d.size(), memres);
+			std::vector<std::function<void()> > jobs;
+			for (size_t i = 0 ; i < m2d.size() ; i++){
+				jobs.push_back([this, &cells, &m2d, i](){ formatColumn(m2d[i], cells[i]); });
+			}
+			runJobs(jobs, parallel);
+
 			bool still_printing;
 			size_t row = 0;
 			do{ //While any matrix still has data to print...
@@ -656,34 +1223,11 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 				trow.clear();
 
 				still_printing = false;
-				for (size_t i = 0 ; i < variables2D.size() ; i++){ //For each 2D variable
-
-					switch(variables2D[i].type){ //Find out its type...
-						case('d'):
-							if (row < matrixLength(variables2D[i])){ //See if it has data to print...
-								still_printing  = true; //Set printing to true
-								std::string tstr = gstd::to_gstring(linaccess(variables2D[i].md2, row));
-								if (isRowEnd(variables2D[i], row)) tstr = tstr + ";";
-								trow.push_back(tstr); //Add its data point
 
-							}
-							break;
-						case('b'):
-							if (row < matrixLength(variables2D[i])){ //See if it has data to print...
-								still_printing  = true; //Set printing to true
-								std::string tstr = bool_to_string(linaccess(variables2D[i].mb2, row));
-								if (isRowEnd(variables2D[i], row)) tstr = tstr + ";";
-								trow.push_back(tstr); //Add its data point
-							}
-							break;
-						case('s'):
-							if (row < matrixLength(variables2D[i])){ //See if it has data to print...
-								still_printing  = true; //Set printing to true
-								std::string tstr = "\"" + linaccess(variables2D[i].ms2, row) + "\"";
-								if (isRowEnd(variables2D[i], row)) tstr = tstr + ";";
-								trow.push_back(tstr); //Add its data point
-							}
-							break;
+				for (size_t i = 0 ; i < m2d.size() ; i++){ //For each 2D matrix...
+					if (row < cells[i].size()){ //See if it has data to print...
+						still_printing  = true; //Set printing to true
+						trow.emplace_back(cells[i][row]); //Add its data point
 					}
 				}
 
@@ -711,186 +1255,120 @@ std::string DDFIO::swrite(std::string fileOut, std::string options){ //TODO: Imp
 
 	}else{ //******************** Write matrices - Horizontal Mode **********************//
 
-		//********************** Write 1D Variables - Horizontal ****************************//
-
-		//For each variable...
-		for (size_t i = 0 ; i < variables1D.size() ; i++){
+		//Each statement is its opening, its elements and its closing. Large
+		//matrices are split into several ranges of elements (rows, for 2D
+		//matrices) so they can be formatted in parallel. All pieces are joined in
+		//order, so the result is the same either way.
+
+		std::vector<size_t> mats = m1d;
+		mats.insert(mats.end(), m2d.begin(), m2d.end());
+
+		std::pmr::vector<std::pmr::string> parts(memres);
+		std::vector<size_t> part_var; //Variable of each elements piece, or DDF_NPOS for text
+		std::vector<size_t> part_first, part_last;
+		for (size_t i = 0 ; i < mats.size() ; i++){
+
+			//Opening - type, name, open brackets
+			parts.emplace_back(std::string("m<") + ddf_type(values[mats[i]]) + "> " + nameOf(mats[i]) + " [");
+			part_var.push_back(DDF_NPOS);
+			part_first.push_back(0);
+			part_last.push_back(0);
+
+			//Elements
+			std::vector<size_t> bounds = chunkBounds(mats[i]);
+			for (size_t c = 0 ; c+1 < bounds.size() ; c++){
+				parts.emplace_back();
+				part_var.push_back(mats[i]);
+				part_first.push_back(bounds[c]);
+				part_last.push_back(bounds[c+1]);
+			}
 
-			switch(variables1D[i].type){
-				case('d'):
+			//Closing - termination, description, newline
+			std::string close = "]" + term_char;
+			if (descOf(mats[i]).length() > 0 && show_descriptions) close = close + " ?" + descOf(mats[i]); //Add description if applicable
+			parts.emplace_back(close + "\n");
+			part_var.push_back(DDF_NPOS);
+			part_first.push_back(0);
+			part_last.push_back(0);
+		}
 
-					//print type, name, open brackets
-					ddf = ddf + "m<d> " + variables1D[i].name + " [";
+		std::vector<std::function<void()> > jobs;
+		for (size_t k = 0 ; k < parts.size() ; k++){
+			if (part_var[k] == DDF_NPOS) continue;
+			jobs.push_back([this, &parts, &part_var, &part_first, &part_last, k](){ formatRange(part_var[k], part_first[k], part_last[k], parts[k]); });
+		}
+		runJobs(jobs, parallel);
 
-					//For each element...
-					for (size_t k = 0 ; k < variables1D[i].md.size() ; k++){
-						if (k != 0) ddf = ddf + ", "; //Add comma if not first element
-						ddf = ddf + gstd::to_gstring(variables1D[i].md[k]); //Add variable string
-					}
+		size_t total = ddf.length();
+		for (size_t k = 0 ; k < parts.size() ; k++){
+			total += parts[k].length();
+		}
+		ddf.reserve(total);
+		for (size_t k = 0 ; k < parts.size() ; k++){
+			ddf += parts[k];
+		}
 
-					ddf = ddf + "]" + term_char;  //Add termination
-					if (variables1D[i].description.length() > 0 && show_descriptions) ddf = ddf + " ?" + variables1D[i].description; //Add description if applicable
-					ddf = ddf + "\n"; //Add newline
-					break;
-				case('b'):
+	}
 
-					//print type, name, open brackets
-					ddf = ddf + "m<b> " + variables1D[i].name + " [";
 
-					//For each element...
-					for (size_t k = 0 ; k < variables1D[i].mb.size() ; k++){
-						if (k != 0) ddf = ddf + ", "; //Add comma if not first element
-						ddf = ddf + bool_to_string(variables1D[i].mb[k]); //Add variable string
-					}
 
-					ddf = ddf + "]" + term_char;  //Add termination
-					if (variables1D[i].description.length() > 0 && show_descriptions) ddf = ddf + " ?" + variables1D[i].description; //Add description if applicable
-					ddf = ddf + "\n"; //Add newline
-					break;
-				case('s'):
+	return ddf;
+}
 
-					//print type, name, open brackets
-					ddf = ddf + "m<s> " + variables1D[i].name + " [";
+/*
+Writes a DDF file to disk. Returns true if successful, else false. Options are passed
+to DDFIO::swrite - see its documentation for options.
+*/
+bool DDFIO::write(std::string fileOut, std::string options){
 
-					//For each element...
-					for (size_t k = 0 ; k < variables1D[i].ms.size() ; k++){
-						if (k != 0) ddf = ddf + ", "; //Add comma if not first element
-						ddf = ddf + "\"" + variables1D[i].ms[k] + "\""; //Add variable string
-					}
+	//Generate string
+	std::string fileString = swrite(fileOut, options);
 
-					ddf = ddf + "]" + term_char;  //Add termination
-					if (variables1D[i].description.length() > 0 && show_descriptions) ddf = ddf + " ?" + variables1D[i].description; //Add description if applicable
-					ddf = ddf + "\n"; //Add newline
-					break;
+	if (fileString == ""){ //Error occured in swrite
+		return false;
+	}
 
-				default:
-					return ""; //An error occured
-			}
-		}
+	//Write to file
+	std::ofstream out(fileOut);
+	if (!out.is_open()){
+		return false;
+	}
+    out << fileString;
+    out.close();
 
-		//********************** Write 2D Variables - Horizontal ****************************//
+	return true;
+}
 
-		//For each variable...
-		for (size_t i = 0 ; i < variables2D.size() ; i++){
+/*
+Reads a DDF file. Returns true if successful, else false.
 
-			switch(variables2D[i].type){
-				case('d'):
+Options: (Order does not matter. Case-sensitive)
+	f: Store m<d> matrices in single precision (float). Halves their memory;
+		see storeAsFloat() to choose per variable.
 
-					//print type, name, open brackets
-					ddf = ddf + "m<d> " + variables2D[i].name + " [";
+TODO: Accept earlier standards.
+*/
+bool DDFIO::load(std::string fileIn, std::string options){ //TODO: Impliment load()
 
-					//For each row...
-					for (size_t k = 0 ; k < variables2D[i].md2.size() ; k++){
-
-						if (k != 0) ddf = ddf + "; "; //Add semicolon if not first row
-
-						//Write row
-						for (size_t j = 0 ; j < variables2D[i].md2[k].size() ; j++){ //For each element...
-							if (j != 0) ddf = ddf + ", "; //Add comma if not first element
-							ddf = ddf + gstd::to_gstring(variables2D[i].md2[k][j]); //Add variable string
-						}
-					}
-
-					ddf = ddf + "]" + term_char;  //Add termination
-					if (variables2D[i].description.length() > 0 && show_descriptions) ddf = ddf + " ?" + variables2D[i].description; //Add description if applicable
-					ddf = ddf + "\n"; //Add newline
-					break;
-				case('b'):
-
-					//print type, name, open brackets
-					ddf = ddf + "m<b> " + variables2D[i].name + " [";
-
-					//For each row...
-					for (size_t k = 0 ; k < variables2D[i].mb2.size() ; k++){
-
-						if (k != 0) ddf = ddf + "; "; //Add semicolon if not first row
-
-						//Write row
-						for (size_t j = 0 ; j < variables2D[i].mb2[k].size() ; j++){ //For each element...
-							if (j != 0) ddf = ddf + ", "; //Add comma if not first element
-							ddf = ddf + bool_to_string(variables2D[i].mb2[k][j]); //Add variable string
-						}
-					}
-
-					ddf = ddf + "]" + term_char;  //Add termination
-					if (variables2D[i].description.length() > 0 && show_descriptions) ddf = ddf + " ?" + variables2D[i].description; //Add description if applicable
-					ddf = ddf + "\n"; //Add newline
-					break;
-				case('s'):
-
-					//print type, name, open brackets
-					ddf = ddf + "m<s> " + variables2D[i].name + " [";
-
-					//For each row...
-					for (size_t k = 0 ; k < variables2D[i].ms2.size() ; k++){
-
-						if (k != 0) ddf = ddf + "; "; //Add semicolon if not first row
-
-						//Write row
-						for (size_t j = 0 ; j < variables2D[i].ms2[k].size() ; j++){ //For each element...
-							if (j != 0) ddf = ddf + ", "; //Add comma if not first element
-							ddf = ddf + "\"" + variables2D[i].ms2[k][j] + "\""; //Add variable string
-						}
-					}
-
-					ddf = ddf + "]" + term_char;  //Add termination
-					if (variables2D[i].description.length() > 0 && show_descriptions) ddf = ddf + " ?" + variables2D[i].description; //Add description if applicable
-					ddf = ddf + "\n"; //Add newline
-					break;
-				default:
-					return ""; //An error occured
-			}
-		}
-
-	}
-
-
-
-	return ddf;
-}
-
-/*
-Writes a DDF file to disk. Returns true if successful, else false. Options are passed
-to DDFIO::swrite - see its documentation for options.
-*/
-bool DDFIO::write(std::string fileOut, std::string options){
-
-	//Generate string
-	std::string fileString = swrite(fileOut, options);
-
-	if (fileString == ""){ //Error occured in swrite
-		return false;
-	}
-
-	//Write to file
-	std::ofstream out(fileOut);
-	if (!out.is_open()){
+	//Open file - return if fail
+	std::ifstream file(fileIn.c_str());
+	if (!file.is_open()){
 		return false;
 	}
-    out << fileString;
-    out.close();
 
-	return true;
+	return load(file, options);
 }
 
 /*
-Reads a DDF file. Returns true if successful, else false.
-
-TODO: Accept earlier standards.
+Reads a DDF file from a stream, starting at the version statement. The stream
+is read once, front to back, so it need not be seekable. Returns true if
+successful, else false.
 */
-bool DDFIO::load(std::string fileIn, std::string options){ //TODO: Impliment load()
-
-	//Open file - return if fail
-	std::ifstream file(fileIn.c_str());
-	if (!file.is_open()){
-		return false;
-	}
+bool DDFIO::load(std::istream& file, std::string options){
 
 	//Read first line - get version
  	std::string line;
     getline(file, line);
-	file.close();
-
 
 	//Read version
 	try{
@@ -904,12 +1382,52 @@ bool DDFIO::load(std::string fileIn, std::string options){ //TODO: Impliment loa
 		std::cout << "ERROR: Version 1.x not supported yet" << std::endl;
 		return false;
 	}else if(fileVersion < 3){
-		return loadDDF_V1(fileIn, options);
+
+		//Version line has been consumed - apply the check the parser would have made
+		if (gstd::parseIdx(line, " \t", ";[]").size() != 2){
+			err_str = "Failed on line 1.\n\tVersion statement accepts exactly 2 words.";
+			return false;
+		}
+
+		return parseDDF_V1(file, options, 1);
 	}
 
 	return false;
 }
 
+/*
+Reads DDF data held in memory (eg. a message received over a queue). The data
+is parsed in place, not copied. Options are as for load(). Returns true if
+successful, else false.
+*/
+bool DDFIO::sload(std::string_view data, std::string options){
+
+	DDFMemoryBuf buf(data.data(), data.length());
+	std::istream in(&buf);
+
+	return load(in, options);
+}
+
+/*
+Reads DDF data from an open file descriptor, such as a pipe or stdin (0), until
+end of file. The descriptor is not closed. Options are as for load(). Returns
+true if successful, else false.
+*/
+bool DDFIO::fdload(int fd, std::string options){
+
+	DDFFileDescBuf buf(fd);
+	std::istream in(&buf);
+
+	bool success = load(in, options);
+
+	if (buf.error() != 0){
+		err_str = "Failed to read from file descriptor " + std::to_string(fd) + " (" + std::strerror(buf.error()) + ").";
+		return false;
+	}
+
+	return success;
+}
+
 /*
 Read DDF version 1 file. Returns true if read success.
 */
@@ -921,10 +1439,28 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 		return false;
 	}
 
+	return parseDDF_V1(file, options, 0);
+}
+
+/*
+Read DDF version 1 file from a stream. Returns true if read success.
+*/
+bool DDFIO::loadDDF_V1(std::istream& file, std::string options){
+	return parseDDF_V1(file, options, 0);
+}
+
+/*
+Parses DDF version 1 statements from 'file' until the end of the stream.
+'lineNum' is the number of lines already consumed from the stream (so error
+messages give the line number in the file). Returns true if read success.
+*/
+bool DDFIO::parseDDF_V1(std::istream& file, std::string options, size_t lineNum){
+
 	std::string line;
 	std::vector<gstd::string_idx> words;
-	size_t lineNum = 0;
-	std::regex matrix_identifier("m<.>");
+	DDFStructIndex sidx; //Reused for every matrix statement
+	std::vector<DDFToken> toks; //Reused for every line of a vertical block
+	bool use_float = (options.find("f", 0) != std::string::npos); //Keep m<d> matrices as floats
 	while (getline(file, line)){ //For each line in file...
 
 		lineNum++;
@@ -977,7 +1513,8 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 					if (header.length() == 0){
 						header = line;
 					}else{
-						header = header + "\n" + line;
+						header += "\n";
+						header += line;
 					}
 
 				}
@@ -994,7 +1531,7 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
             continue;
 
-        }else if (words[0].str == "d" || words[0].str == "b" || words[0].str == "s" || std::regex_match(words[0].str, matrix_identifier)){ //Inline variables
+        }else if (words[0].str == "d" || words[0].str == "b" || words[0].str == "s" || (words[0].str.length() == 4 && words[0].str.compare(0, 2, "m<") == 0 && words[0].str[3] == '>')){ //Inline variables (matrices are 'm<.>')
 
 			//Ensure 3+ words exist
 			if (words.size() < 3){
@@ -1008,15 +1545,21 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 				return false;
 			}
 
+			//Index brackets, separators and strings of matrix statements
+			bool matrix_2d = false;
+			if (words[0].str.length() == 4){
+				simd_scan_structure(line.c_str(), line.length(), sidx);
+				matrix_2d = (sidx.semis > 0); //Semicolon inside the brackets (outside strings)
+			}
+
 			//Read value
 			size_t optional_features_start = 3;
 			if (words[0].str == "d"){ //Double
 
-				DDFFlatItem temp;
+				DDFVariable temp;
 				temp.name = words[1].str;
-				temp.type = 'd';
 				try{
-					temp.d = stod(words[2].str);
+					temp.value = stod(words[2].str);
 				}catch(...){
 					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + words[2].str + "' as a double.";
 					return false;
@@ -1043,15 +1586,14 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
 				}
 
-				variablesFlat.push_back(temp);
+				store(temp, use_float);
 
 			}else if(words[0].str == "b"){ //Boolean
 
-				DDFFlatItem temp;
+				DDFVariable temp;
 				temp.name = words[1].str;
-				temp.type = 'b';
 				try{
-					temp.b = gstd::to_bool(words[2].str);
+					temp.value = gstd::to_bool(words[2].str);
 				}catch(...){
 					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + words[2].str + "' as a bool.";
 					return false;
@@ -1078,30 +1620,27 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
 				}
 
-				variablesFlat.push_back(temp);
+				store(temp, use_float);
 
 			}else if(words[0].str == "s"){ //string
 
-				DDFFlatItem temp;
+				DDFVariable temp;
 				temp.name = words[1].str;
-				temp.type = 's';
-				try{
-
-					size_t end;
-					temp.s = gstd::get_string(line, end, words[0].idx+1);
-
-					//Find word where to start to looking for optional features
-					for (size_t i = 0 ; i < words.size() ; i++){
-						if (words[i].idx+words[i].str.length() > end){
-							optional_features_start = i;
-							break;
-						}
-					}
-
-				}catch(...){
+				size_t q1, end;
+				if (!find_string_literal(line.c_str(), line.length(), words[0].idx+1, q1, end)){
 					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + words[2].str + "' as a string.";
 					return false;
 				}
+				unescape_string(line.c_str() + q1 + 1, end - q1 - 1, temp.value.emplace<DDF_S>(memres));
+
+				//Find word where to start to looking for optional features
+				for (size_t i = 0 ; i < words.size() ; i++){
+					if (words[i].idx+words[i].str.length() > end){
+						optional_features_start = i;
+						break;
+					}
+				}
+
 				optional_features_start = 3;
 
 				//Read optional arguments/features
@@ -1124,27 +1663,37 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
 				}
 
-				variablesFlat.push_back(temp);
+				store(temp, use_float);
 
-			}else if(words[0].str == "m<d>" && !is_2d(line)){ //Double matrix 1D
+			}else if(words[0].str == "m<d>" && !matrix_2d){ //Double matrix 1D
 
-				DDF1DItem temp;
+				DDFVariable temp;
 				temp.name = words[1].str;
-				temp.type = 'd';
+				std::pmr::vector<double>& md = recycled<DDF_MD>(temp.value);
 
-				size_t start = line.find("[", 0);
-				size_t end = line.find("]", 0);
+				size_t start = sidx.open;
+				size_t end = sidx.close;
 				if (start == std::string::npos || end == std::string::npos){
 					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to find square brackets.";
 					return false;
 				}
 
-				std::string mat_str = line.substr(start+1, end-start-1);
-				try{
-					temp.md = gstd::to_dvec(mat_str);
-				}catch(...){
-					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a matrix of doubles.";
-					return false;
+				if (line.length() >= DDF_LONG_LINE || reuse_mode){ //Long line (or reusing buffers) - parse straight from the index, no copy of the body
+
+					if (!index_to_vec(line, sidx, element_to_double, md)){
+						err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + line.substr(start+1, end-start-1) + "' as a matrix of doubles.";
+						return false;
+					}
+
+				}else{
+
+					std::string mat_str = line.substr(start+1, end-start-1);
+					try{
+						ddf_assign(md, gstd::to_dvec(mat_str));
+					}catch(...){
+						err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a matrix of doubles.";
+						return false;
+					}
 				}
 
 				//Find where data ends, optional features begin
@@ -1176,28 +1725,37 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
 				}
 
-				variables1D.push_back(temp);
+				store(temp, use_float);
 
-			}else if(words[0].str == "m<b>" && !is_2d(line)){ //Bool matrix 1D
+			}else if(words[0].str == "m<b>" && !matrix_2d){ //Bool matrix 1D
 
-				DDF1DItem temp;
+				DDFVariable temp;
 				temp.name = words[1].str;
-				temp.type = 'b';
+				std::pmr::vector<bool>& mb = recycled<DDF_MB>(temp.value);
 
-				size_t start = line.find("[", 0);
-				size_t end = line.find("]", 0);
+				size_t start = sidx.open;
+				size_t end = sidx.close;
 				if (start == std::string::npos || end == std::string::npos){
 					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to find square brackets.";
 					return false;
 				}
 
-				std::string mat_str = line.substr(start+1, end-start-1);
+				if (line.length() >= DDF_LONG_LINE || reuse_mode){ //Long line (or reusing buffers) - parse straight from the index, no copy of the body
 
-				try{
-					temp.mb = gstd::to_bvec(mat_str);
-				}catch(...){
-					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a matrix of booleans.";
-					return false;
+					if (!index_to_vec(line, sidx, element_to_bool, mb)){
+						err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + line.substr(start+1, end-start-1) + "' as a matrix of booleans.";
+						return false;
+					}
+
+				}else{
+
+					std::string mat_str = line.substr(start+1, end-start-1);
+					try{
+						ddf_assign(mb, gstd::to_bvec(mat_str));
+					}catch(...){
+						err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a matrix of booleans.";
+						return false;
+					}
 				}
 
 				//Find where data ends, optional features begin
@@ -1228,27 +1786,24 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
 				}
 
-				variables1D.push_back(temp);
+				store(temp, use_float);
 
-			}else if(words[0].str == "m<s>" && !is_2d(line)){ //String matrix 1D
+			}else if(words[0].str == "m<s>" && !matrix_2d){ //String matrix 1D
 
-				DDF1DItem temp;
+				DDFVariable temp;
 				temp.name = words[1].str;
-				temp.type = 's';
+				std::pmr::vector<std::pmr::string>& ms = recycled<DDF_MS>(temp.value);
 
-				size_t start = line.find("[", 0);
-				size_t end = line.find("]", 0);
+				size_t start = sidx.open;
+				size_t end = sidx.close;
 				if (start == std::string::npos || end == std::string::npos){
 					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to find square brackets.";
 					return false;
 				}
 
-				std::string mat_str = line.substr(start+1, end-start-1);
-
-				try{
-					temp.ms = gstd::to_svec(mat_str);
-				}catch(...){
-					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a matrix of strings.";
+				//Strings always go through the index, whose quote mask knows about escapes
+				if (!index_to_vec(line, sidx, element_to_string<std::pmr::string>, ms)){
+					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + line.substr(start+1, end-start-1) + "' as a matrix of strings.";
 					return false;
 				}
 
@@ -1280,27 +1835,37 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
 				}
 
-				variables1D.push_back(temp);
+				store(temp, use_float);
 
 			}else if(words[0].str == "m<d>"){ //Double matrix 2D
 
-				DDF2DItem temp;
+				DDFVariable temp;
 				temp.name = words[1].str;
-				temp.type = 'd';
+				std::pmr::vector<std::pmr::vector<double> >& md2 = recycled<DDF_MD2>(temp.value);
 
-				size_t start = line.find("[", 0);
-				size_t end = line.find("]", 0);
+				size_t start = sidx.open;
+				size_t end = sidx.close;
 				if (start == std::string::npos || end == std::string::npos){
 					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to find square brackets.";
 					return false;
 				}
 
-				std::string mat_str = line.substr(start+1, end-start-1);
-				try{
-					temp.md2 = gstd::to_dvec2D(mat_str);
-				}catch(...){
-					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a 2D matrix of doubles.";
-					return false;
+				if (line.length() >= DDF_LONG_LINE || reuse_mode){ //Long line (or reusing buffers) - parse straight from the index, no copy of the body
+
+					if (!index_to_vec2D(line, sidx, element_to_double, md2)){
+						err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + line.substr(start+1, end-start-1) + "' as a 2D matrix of doubles.";
+						return false;
+					}
+
+				}else{
+
+					std::string mat_str = line.substr(start+1, end-start-1);
+					try{
+						ddf_assign(md2, gstd::to_dvec2D(mat_str));
+					}catch(...){
+						err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a 2D matrix of doubles.";
+						return false;
+					}
 				}
 
 				//Find where data ends, optional features begin
@@ -1332,28 +1897,37 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
 				}
 
-				variables2D.push_back(temp);
+				store(temp, use_float);
 
 			}else if(words[0].str == "m<b>"){ //Bool matrix 2D
 
-				DDF2DItem temp;
+				DDFVariable temp;
 				temp.name = words[1].str;
-				temp.type = 'b';
+				std::pmr::vector<std::pmr::vector<bool> >& mb2 = recycled<DDF_MB2>(temp.value);
 
-				size_t start = line.find("[", 0);
-				size_t end = line.find("]", 0);
+				size_t start = sidx.open;
+				size_t end = sidx.close;
 				if (start == std::string::npos || end == std::string::npos){
 					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to find square brackets.";
 					return false;
 				}
 
-				std::string mat_str = line.substr(start+1, end-start-1);
+				if (line.length() >= DDF_LONG_LINE || reuse_mode){ //Long line (or reusing buffers) - parse straight from the index, no copy of the body
 
-				try{
-					temp.mb2 = gstd::to_bvec2D(mat_str);
-				}catch(...){
-					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a 2D matrix of booleans.";
-					return false;
+					if (!index_to_vec2D(line, sidx, element_to_bool, mb2)){
+						err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + line.substr(start+1, end-start-1) + "' as a 2D matrix of booleans.";
+						return false;
+					}
+
+				}else{
+
+					std::string mat_str = line.substr(start+1, end-start-1);
+					try{
+						ddf_assign(mb2, gstd::to_bvec2D(mat_str));
+					}catch(...){
+						err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a 2D matrix of booleans.";
+						return false;
+					}
 				}
 
 				//Find where data ends, optional features begin
@@ -1384,27 +1958,24 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
 				}
 
-				variables2D.push_back(temp);
+				store(temp, use_float);
 
 			}else if(words[0].str == "m<s>"){ //String matrix 2D
 
-				DDF2DItem temp;
+				DDFVariable temp;
 				temp.name = words[1].str;
-				temp.type = 's';
+				std::pmr::vector<std::pmr::vector<std::pmr::string> >& ms2 = recycled<DDF_MS2>(temp.value);
 
-				size_t start = line.find("[", 0);
-				size_t end = line.find("]", 0);
+				size_t start = sidx.open;
+				size_t end = sidx.close;
 				if (start == std::string::npos || end == std::string::npos){
 					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to find square brackets.";
 					return false;
 				}
 
-				std::string mat_str = line.substr(start+1, end-start-1);
-
-				try{
-					temp.ms2 = gstd::to_svec2D(mat_str);
-				}catch(...){
-					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + mat_str + "' as a 2D matrix of strings.";
+				//Strings always go through the index, whose quote mask knows about escapes
+				if (!index_to_vec2D(line, sidx, element_to_string<std::pmr::string>, ms2)){
+					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + words[1].str + "': Failed to interpret '" + line.substr(start+1, end-start-1) + "' as a 2D matrix of strings.";
 					return false;
 				}
 
@@ -1436,13 +2007,13 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 
 				}
 
-				variables2D.push_back(temp);
+				store(temp, use_float);
 			}
 
 		}else if(words[0].str == "#VERTICAL"){
 
-			std::vector<std::string> vert_block; //Clear header
-			std::vector<size_t> line_nums;
+			std::pmr::vector<std::pmr::string> vert_block(memres); //Clear header
+			std::pmr::vector<size_t> line_nums(memres);
 			size_t openedOnLine = lineNum;
 
 			bool foundBlock = false;
@@ -1451,27 +2022,27 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 				lineNum++;
 
 				//Break line into words...
-				std::vector<gstd::string_idx> words = gstd::parseIdx(line, " \t", ";");
+				tokenize_line(line.c_str(), line.length(), ";", toks);
 
-				if (words.size() < 1) continue; //Skip blank lines
+				if (toks.size() < 1) continue; //Skip blank lines
 
-				if (words[0].str.length() >= 2 && words[0].str.substr(0, 2) == "//") continue; //Skip comments TODO: Change comment removal to occur in pass through at beginning of read
+				if (toks[0].len >= 2 && strncmp(toks[0].p, "//", 2) == 0) continue; //Skip comments TODO: Change comment removal to occur in pass through at beginning of read
 
-				if(words[0].str == "#VERTICAL"){ //Is a closing block statement
+				if(token_is(toks[0], "#VERTICAL")){ //Is a closing block statement
 					foundBlock = true;
 					break;
 				}else{ //Is part of the block...
 
 					//Trim inline comments
-					std::string comment_trimmed_line = line;
+					size_t comment_start = line.length();
 					for (size_t l = 1 ; l+1 < line.length() ; l++){ //Can't be first character - comments starting with first character were removed along with blank lines
-						if (line.substr(l, 2) == "//"){
-							comment_trimmed_line = line.substr(0, l);
+						if (line.compare(l, 2, "//") == 0){
+							comment_start = l;
 						}
 					}
 
 					//Push line w/ comment removed back
-					vert_block.push_back(comment_trimmed_line);
+					vert_block.emplace_back(line.data(), comment_start);
 					line_nums.push_back(lineNum);
 
 				}
@@ -1491,17 +2062,18 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 				return false;
 			}
 
-			std::vector<std::string> types = gstd::parse(vert_block[0], " \t"); //Read variable types from first line
-			std::vector<std::string> names = gstd::parse(vert_block[1], " \t"); //Read variable names from 2nd line
+			std::vector<std::string> types = gstd::parse(std::string(vert_block[0]), " \t"); //Read variable types from first line
+			std::vector<std::string> names = gstd::parse(std::string(vert_block[1]), " \t"); //Read variable names from 2nd line
 			std::vector<std::string> descs;
 
 			//Check if descriptions are present
-			std::string desc_line = vert_block[2];
-			gstd::trim_whitespace(vert_block[2]); //Remove whitespace from start + end, '?' must be first char if desc line
+			std::string desc_line(vert_block[2]);
+			std::string desc_trimmed = desc_line;
+			gstd::trim_whitespace(desc_trimmed); //Remove whitespace from start + end, '?' must be first char if desc line
 			if (desc_line.length() >= 1 && desc_line[0] == '?'){
 
 				//Read description line
-				descs = gstd::parse(vert_block[2], "?"); //Read descriptions from 3rd line
+				descs = gstd::parse(desc_trimmed, "?"); //Read descriptions from 3rd line
 				for (size_t e = 0 ; e < descs.size() ; e++){ //Remove trailing whitespace from descriptions
 					gstd::trim_whitespace(descs[e]);
 				}
@@ -1531,37 +2103,35 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 			}
 
 			//Initialize the 2D vector of string data contents for each matrix detected
-			std::vector<std::vector<std::string> > data_str;
-			std::vector<bool> is_2dmat;
+			std::pmr::vector<std::pmr::vector<std::string> > data_str(names.size(), memres); //Cells stay std::string - they are converted with std::stod and gstd
+			std::pmr::vector<bool> is_2dmat(names.size(), false, memres);
 			for (size_t i = 0 ; i < names.size() ; i++){
-				std::vector<std::string> temp_vs;
-				data_str.push_back(temp_vs);
-				is_2dmat.push_back(false);
+				data_str[i].reserve(vert_block.size());
 			}
 
 
 			//Go through data line by line and add contents to string vectors
-			std::vector<std::string> words;
 			size_t max_allowed = names.size();
 			size_t l = 2;
 			if (descs.size() > 0) l++;
+			const size_t first_data = l; //Cell k of a column comes from line first_data+k
 			for (; l < vert_block.size() ; l++){
 
-				words = gstd::parse(vert_block[l], " \t", "", true); //Parse tokens via whitespace, but preserve strings as one token
+				tokenize_line(vert_block[l].c_str(), vert_block[l].length(), "", toks, true); //Parse tokens via whitespace, but preserve strings as one token
 
 				//Check that a matrix didn't omit data one line, then bring it back the next
-				if (words.size() > max_allowed){
+				if (toks.size() > max_allowed){
 					err_str = "Failed on line " + std::to_string(line_nums[l]) + ".\n\tToo many characters detected.";
 					return false;
 				}
 
 				//Update maximum No. allowed tokens
-				if (words.size() < max_allowed) max_allowed = words.size();
+				if (toks.size() < max_allowed) max_allowed = toks.size();
 
 				//For each token, add to corresponding string data vector
-				for (size_t i = 0 ; i < words.size() ; i++){
-					data_str[i].push_back(words[i]);
-					if (words[i][words[i].length()-1] == ';'){
+				for (size_t i = 0 ; i < toks.size() ; i++){
+					data_str[i].emplace_back(toks[i].p, toks[i].len);
+					if (toks[i].p[toks[i].len-1] == ';'){
 						is_2dmat[i] = true;
 					}
 				}
@@ -1572,17 +2142,18 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 			for (size_t i = 0 ; i < names.size() ; i++){
 				if (is_2dmat[i]){
 
-					DDF2DItem temp;
-					std::vector<double> td;
-					std::vector<bool> tb;
-					std::vector<std::string> ts;
+					DDFVariable temp;
+					std::pmr::vector<double> td(memres);
+					std::pmr::vector<bool> tb(memres);
+					std::pmr::vector<std::pmr::string> ts(memres);
+					size_t rows = 0; //Rows filled - recycled matrices can already hold more
 
 					if (types[i] == "m<d>"){
-						temp.type = 'd';
+						recycled<DDF_MD2>(temp.value);
 					}else if(types[i] == "m<s>"){
-						temp.type = 's';
+						recycled<DDF_MS2>(temp.value);
 					}else{ //bool
-						temp.type = 'b';
+						recycled<DDF_MB2>(temp.value);
 					}
 
 					temp.name = names[i];
@@ -1608,51 +2179,62 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 							try{
 								td.push_back(stod(data_str_wo_semicolon));
 							 }catch(...){
-								err_str = "Failed on line " + std::to_string(line_nums[l]) + ".\n\tFailed to convert '" + data_str_wo_semicolon + "' to a double.";
+								err_str = "Failed on line " + std::to_string(line_nums[first_data+k]) + ".\n\tFailed to convert '" + data_str_wo_semicolon + "' to a double.";
 								return false;
 							}
 							if (row_end){
-								temp.md2.push_back(td);
+								put_row(std::get<DDF_MD2>(temp.value), rows, td);
 								td.clear();
 							}
 						}else if(types[i] == "m<s>"){
-							size_t pos;
-							ts.push_back(gstd::get_string(data_str_wo_semicolon, pos));
+							ts.emplace_back();
+							if (!element_to_string(data_str_wo_semicolon, 0, data_str_wo_semicolon.length(), ts.back())){
+								err_str = "Failed on line " + std::to_string(line_nums[first_data+k]) + ".\n\tFailed to convert '" + data_str_wo_semicolon + "' to a string.";
+								return false;
+							}
 							if (row_end){
-								temp.ms2.push_back(ts);
+								put_row(std::get<DDF_MS2>(temp.value), rows, ts);
 								ts.clear();
 							}
 						}else{ //bool
-							tb.push_back( gstd::to_bool(data_str_wo_semicolon) );
+							try{
+								tb.push_back( gstd::to_bool(data_str_wo_semicolon) );
+							}catch(...){
+								err_str = "Failed on line " + std::to_string(line_nums[first_data+k]) + ".\n\tFailed to convert '" + data_str_wo_semicolon + "' to a bool.";
+								return false;
+							}
 
 							if (row_end){
-								temp.mb2.push_back(tb);
+								put_row(std::get<DDF_MB2>(temp.value), rows, tb);
 								tb.clear();
 							}
 						}
 					}
 
 					//Add last row...
-					if (types[i] == "m<d>" && td.size() > 0){
-						temp.md2.push_back(td);
-					}else if(types[i] == "m<s>" && ts.size() > 0){
-						temp.ms2.push_back(ts);
-					}else if(types[i] == "m<b>" && tb.size() > 0){
-						temp.mb2.push_back(tb);
+					if (types[i] == "m<d>"){
+						if (td.size() > 0) put_row(std::get<DDF_MD2>(temp.value), rows, td);
+						std::get<DDF_MD2>(temp.value).resize(rows);
+					}else if(types[i] == "m<s>"){
+						if (ts.size() > 0) put_row(std::get<DDF_MS2>(temp.value), rows, ts);
+						std::get<DDF_MS2>(temp.value).resize(rows);
+					}else{
+						if (tb.size() > 0) put_row(std::get<DDF_MB2>(temp.value), rows, tb);
+						std::get<DDF_MB2>(temp.value).resize(rows);
 					}
 
-					variables2D.push_back(temp);
+					store(temp, use_float);
 
 				}else{
 
-					DDF1DItem temp;
+					DDFVariable temp;
 
 					if (types[i] == "m<d>"){
-						temp.type = 'd';
+						recycled<DDF_MD>(temp.value).reserve(data_str[i].size());
 					}else if(types[i] == "m<s>"){
-						temp.type = 's';
+						recycled<DDF_MS>(temp.value).reserve(data_str[i].size());
 					}else{ //bool
-						temp.type = 'b';
+						recycled<DDF_MB>(temp.value).reserve(data_str[i].size());
 					}
 
 					temp.name = names[i];
@@ -1665,20 +2247,29 @@ bool DDFIO::loadDDF_V1(std::string fileIn, std::string options){
 					for (size_t k = 0 ; k < data_str[i].size() ; k++){
 						if (types[i] == "m<d>"){
 							try{
-								temp.md.push_back(stod(data_str[i][k]));
+								std::get<DDF_MD>(temp.value).push_back(stod(data_str[i][k]));
 							 }catch(...){
-								err_str = "Failed on line " + std::to_string(line_nums[l]) + ".\n\tFailed to convert '" + data_str[i][k] + "' to a double.";
+								err_str = "Failed on line " + std::to_string(line_nums[first_data+k]) + ".\n\tFailed to convert '" + data_str[i][k] + "' to a double.";
 								return false;
 							}
 						}else if(types[i] == "m<s>"){
-							size_t pos;
-							temp.ms.push_back(gstd::get_string(data_str[i][k], pos));
+							std::pmr::vector<std::pmr::string>& ms = std::get<DDF_MS>(temp.value);
+							ms.emplace_back();
+							if (!element_to_string(data_str[i][k], 0, data_str[i][k].length(), ms.back())){
+								err_str = "Failed on line " + std::to_string(line_nums[first_data+k]) + ".\n\tFailed to convert '" + data_str[i][k] + "' to a string.";
+								return false;
+							}
 						}else{ //bool
-							temp.mb.push_back( gstd::to_bool(data_str[i][k]) );
+							try{
+								std::get<DDF_MB>(temp.value).push_back( gstd::to_bool(data_str[i][k]) );
+							}catch(...){
+								err_str = "Failed on line " + std::to_string(line_nums[first_data+k]) + ".\n\tFailed to convert '" + data_str[i][k] + "' to a bool.";
+								return false;
+							}
 						}
 					}
 
-					variables1D.push_back(temp);
+					store(temp, use_float);
 				}
 
 			}
@@ -1702,657 +2293,2113 @@ bool DDFIO::clload(std::string fileIn){
 	return load(fileIn);
 }
 
-
-
 //***************************************************************************//
-//*************** VARIABLE MANAGEMENT
-
-bool DDFIO::checkContains(std::vector<std::string> names){ //TODO: impliment checkContains()
-	std::cout << "Oops! Need to impliment this :)" << std::endl;
-	return false;
-}
-
-/*
-Clears all variables from the DDFIO object.
-*/
-void DDFIO::clear(){
-	fileVersion = -1;
-	header = "";
-	variablesFlat.clear();
-	variables1D.clear();
-	variables2D.clear();
-}
+//*************** VALIDATION
 
 /*
-Returns the number of variables of all types combined that are presently loaded
-in this DDFIO object.
+Checks that a DDF file is well-formed without loading it. Runs the same checks
+as load() and reports failures with the same messages, but doesn't store any
+variables, doesn't allocate per variable and doesn't use exceptions, so it is
+much faster than a full load.
+
+Stops after 'max_errors' errors (0 collects all errors). The messages are saved
+in the error string (see err()), one after the other separated by newlines.
+Returns true if the file is valid.
 */
-size_t DDFIO::numVar(){
-	return variablesFlat.size() + variables1D.size() + variables2D.size();
-}
-
-//***************************************************************************//
-//*************** HEADER
+bool DDFIO::validate(std::string fileIn, size_t max_errors){
 
-/*
-Sets the header
-*/
-void DDFIO::setHeader(std::string h){
-	header = h;
-}
+	//Open file - return if fail
+	std::ifstream file(fileIn.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open()){
+		err_str = "Failed to open file '" + fileIn + "'.";
+		return false;
+	}
 
-/*
-Returns the header
-*/
-std::string DDFIO::getHeader(){
-	return header;
+	return validate(file, max_errors);
 }
 
 /*
-Returns the file's verion.
+Checks that the DDF file in a stream is well-formed. See validate() above.
 */
-double DDFIO::getVersion(){
-	return fileVersion;
+bool DDFIO::validate(std::istream& file, size_t max_errors){
+	return validateDDF_V1(file, max_errors);
 }
 
 /*
-Returns the error status
+Validates the DDF text in 'file', one line at a time. Only the current line
+(and the two header lines of a vertical block) is kept in memory, so files of
+any size can be checked.
 */
-std::string DDFIO::err(){
-	return err_str;
-}
+bool DDFIO::validateDDF_V1(std::istream& file, size_t max_errors){
 
-//***************************************************************************//
-//*************** PRINTING
+	std::vector<std::string> errors;
+	std::vector<DDFToken> words;
+	std::vector<DDFToken> types;
+	std::vector<DDFToken> names;
+	std::string head[2]; //Type and name lines of the current vertical block
+	DDFStructIndex sidx;
+	words.reserve(64);
 
-/*
-Returns a vector of strings of the variables' names.
+	std::string cur;
+	size_t lineNum = 0;
+	const char* line = NULL;
+	size_t line_len = 0;
+
+	//Reads the next line into line/line_len. Returns false at end of data.
+	auto nextLine = [&]() -> bool {
+		if (!std::getline(file, cur)) return false;
+		line = cur.c_str();
+		line_len = cur.length();
+		lineNum++;
+		return true;
+	};
 
-Options:
-	- t: include variable type with name
-	- m: merge all names into one string, save in returned vector's index 0.
-*/
-std::vector<std::string> DDFIO::names(std::string options){
+	//Records an error. Returns true if validation should stop.
+	auto fail = [&](size_t ln, std::string msg) -> bool {
+		errors.push_back("Failed on line " + std::to_string(ln) + ".\n\t" + msg);
+		return (max_errors != 0 && errors.size() >= max_errors);
+	};
 
-	//Options
-	bool include_type = false;
-	bool merge = false;
+	auto str = [](const DDFToken& t) -> std::string {
+		return std::string(t.p, t.len);
+	};
 
-	//Read in options
-	if (options.find("t", 0) != std::string::npos){
-		include_type = true;
-	}
-	if (options.find("m", 0) != std::string::npos){
-		merge = true;
-	}
+	bool stop = false;
 
-	std::vector<std::string> names_out;
+	//******************** Version statement (see load()) *******************//
 
-	//Add flat names
-	for (size_t i = 0 ; i < variablesFlat.size() ; i++){
-		if (include_type){
-			names_out.push_back(variablesFlat[i].name + " (" + variablesFlat[i].type + ")");
-		}else{
-			names_out.push_back(variablesFlat[i].name);
-		}
-	}
+	if (!nextLine() || line_len < 9 || !is_number_prefix(line + 9, line_len - 9)){
+		fail(1, "Failed to read version number.");
+		stop = true;
+	}else{
 
-	//Add 1D names
-	for (size_t i = 0 ; i < variables1D.size() ; i++){
-		if (include_type){
-			names_out.push_back(variables1D[i].name + " (m<" + variables1D[i].type + ">)");
-		}else{
-			names_out.push_back(variables1D[i].name);
-		}
-	}
+		double version = strtod(line + 9, NULL);
+		tokenize_line(line, line_len, ";[]", words);
 
-	//Add 2D names
-	for (size_t i = 0 ; i < variables2D.size() ; i++){
-		if (include_type){
-			names_out.push_back(variables2D[i].name + " (m<" + variables2D[i].type + ">(2D))");
-		}else{
-			names_out.push_back(variables2D[i].name);
+		if (version < 2 || version >= 3){
+			stop = fail(1, "Version " + gstd::to_gstring(version) + " is not supported.");
+		}else if (words.size() != 2){
+			stop = fail(1, "Version statement accepts exactly 2 words.");
 		}
 	}
 
-	//Merge (if requested)
-	if (merge){
+	//*************************** Statements ********************************//
 
-		std::string merged_str = ""; //Create blank string
+	while (!stop && nextLine()){
 
-		//For each name...
-		for (size_t i = 0 ; i+1 < names_out.size() ; i++){
-			merged_str = merged_str + names_out[i] + ", "; //Add to merged name...
-		}
+		tokenize_line(line, line_len, ";[]", words);
 
-		//Add last element without comma
-		if (names_out.size() > 0){
-			merged_str = merged_str + names_out[names_out.size()-1];
-		}
+		if (words.size() < 1) continue; //Skip blank lines
 
-		names_out.clear(); //Clear output vector
-		names_out.push_back(merged_str); //push back merged string
-	}
+		if (token_is(words[0], "#VERSION")){
 
-	//Return names vector
-	return names_out;
+			if (words.size() != 2){
+				stop = fail(lineNum, "Version statement accepts exactly 2 words.");
+			}else if (!is_number_prefix(words[1].p, words[1].len)){
+				stop = fail(lineNum, "Failed to read version number.");
+			}
 
-}
+		}else if (token_is(words[0], "#HEADER")){
 
-/*
-Returns the contents of the DDFIO object as a string.
-*/
-std::string DDFIO::show(){
+			size_t openedOnLine = lineNum;
+			bool foundHeader = false;
+			while (nextLine()){
+				tokenize_line(line, line_len, ";", words);
+				if (words.size() > 0 && token_is(words[0], "#HEADER")){
+					foundHeader = true;
+					break;
+				}
+			}
 
-	std::string out = "";
+			if (!foundHeader){
+				fail(openedOnLine, "Failed to find closing #HEADER statement.");
+				stop = true;
+			}
 
-	out = "No. Variables: " + std::to_string(numVar());
-	out = out + "\nFlat Variables:\n";
+		}else if (token_is(words[0], "//")){
 
-	size_t trim_len = 45;
+			continue;
 
-	if (variablesFlat.size() > 0){
-		KTable flat_vars;
-		flat_vars.table_title("Flat Variables");
-		flat_vars.row({"Name", "Type", "Value", "Description"});
-		for (size_t i = 0 ; i < variablesFlat.size() ; i++){
+		}else if (token_is(words[0], "d") || token_is(words[0], "b") || token_is(words[0], "s") || (words[0].len == 4 && words[0].p[0] == 'm' && words[0].p[1] == '<' && words[0].p[3] == '>')){
 
-			std::string typecode = "";
-			std::string valstr = "";
-			switch (variablesFlat[i].type){
-				case('d'):
-					typecode = "double";
-					valstr = std::to_string(variablesFlat[i].d);
-					break;
-				case('s'):
-					typecode = "string";
-					valstr = variablesFlat[i].s;
-					break;
-				case('b'):
-					typecode = "bool";
-					valstr = bool_to_string(variablesFlat[i].b);
-					break;
-				default:
-					typecode = "?";
-					valstr = "?";
-					break;
+			if (words.size() < 3){
+				stop = fail(lineNum, "Insufficient number of tokens for inline variable statement.");
+				continue;
 			}
 
-			flat_vars.row({variablesFlat[i].name, typecode, valstr, variablesFlat[i].description});
+			if (!is_valid_name(words[1].p, words[1].len)){
+				stop = fail(lineNum, "Invalid variable name '" + str(words[1]) +"'.");
+				continue;
+			}
 
-		}
+			size_t optional_features_start = 3;
+			char type = (words[0].len == 1) ? words[0].p[0] : words[0].p[2];
 
-		flat_vars.alignt('l');
-		flat_vars.alignh('l');
-		flat_vars.alignc('l');
-		flat_vars.alignc(3, 'l');
-		flat_vars.trimc('c', trim_len);
-		out = out + flat_vars.str();
-	}
+			if (words[0].len == 1){ //Flat variable
 
-	if (variables1D.size() > 0){
-		KTable m1d_vars;
-		m1d_vars.table_title("1D Variables");
-		m1d_vars.row({"Name", "Type", "Value", "Description"});
-		for (size_t i = 0 ; i < variables1D.size() ; i++){
+				bool ok = true;
+				switch(type){
+					case('d'):
+						ok = is_number_prefix(words[2].p, words[2].len);
+						if (!ok) stop = fail(lineNum, "For variable '" + str(words[1]) + "': Failed to interpret '" + str(words[2]) + "' as a double.");
+						break;
+					case('b'):
+						ok = is_bool_word(words[2].p, words[2].len);
+						if (!ok) stop = fail(lineNum, "For variable '" + str(words[1]) + "': Failed to interpret '" + str(words[2]) + "' as a bool.");
+						break;
+					case('s'):
+						{
+							size_t q1, q2;
+							ok = find_string_literal(line, line_len, words[0].idx + 1, q1, q2);
+							if (!ok) stop = fail(lineNum, "For variable '" + str(words[1]) + "': Failed to interpret '" + str(words[2]) + "' as a string.");
+						}
+						break;
+				}
+				if (!ok) continue;
 
-			size_t k;
-			std::string typecode = "";
-			std::string val_str = "[";
-			switch (variables1D[i].type){
-				case('d'):
-					typecode = "m<double>";
-					for (k = 0 ; k < variables1D[i].md.size()-1 ; k++){
-						val_str = val_str + gstd::to_gstring(variables1D[i].md[k]) + ", ";
-					}
-					val_str = val_str + gstd::to_gstring(variables1D[i].md[k]);
-					break;
-				case('s'):
-					typecode = "m<string>";
-					for (k = 0 ; k < variables1D[i].ms.size()-1 ; k++){
-						val_str = val_str + "\"" + (variables1D[i].ms[k]) + "\", ";
+			}else if (type == 'd' || type == 'b' || type == 's'){ //Matrix
+
+				//Same structural index as load(), so brackets, strings and 2D matrices are found the same way
+				simd_scan_structure(line, line_len, sidx);
+				if (sidx.open == DDF_NPOS || sidx.close == DDF_NPOS){
+					stop = fail(lineNum, "For variable '" + str(words[1]) + "': Failed to find square brackets.");
+					continue;
+				}
+
+				bool two_d = (sidx.semis > 0);
+				if (!is_matrix_body(line, sidx, type)){
+					std::string desc = (type == 'd') ? "doubles" : ((type == 'b') ? "booleans" : "strings");
+					std::string body(line + sidx.open + 1, sidx.close - sidx.open - 1);
+					stop = fail(lineNum, "For variable '" + str(words[1]) + "': Failed to interpret '" + body + "' as a " + (two_d ? "2D " : "") + "matrix of " + desc + ".");
+					continue;
+				}
+
+				//Find where data ends, optional features begin
+				size_t end = sidx.close;
+				optional_features_start = 4;
+				for (; optional_features_start < words.size() ; optional_features_start++){
+					if (words[optional_features_start].idx > end){
+						break;
 					}
-					val_str = val_str + "\"" + (variables1D[i].ms[k]) + "\"";
-					break;
-				case('b'):
-					typecode = "m<bool>";
-					for (k = 0 ; k < variables1D[i].mb.size()-1 ; k++){
-						val_str = val_str + bool_to_string(variables1D[i].mb[k]) + ", ";
+				}
+
+			}else{ //Unknown matrix type - skipped by the reader too
+				continue;
+			}
+
+			//Check optional arguments/features
+			bool allow_semi = true;
+			for (size_t i = optional_features_start ; i < words.size() ; i++){
+				if (token_is(words[i], ";")){
+					if (!allow_semi){
+						stop = fail(lineNum, "For variable '" + str(words[1]) + "': Detected excessive semicolons.");
+						break;
 					}
-					val_str = val_str + bool_to_string(variables1D[i].mb[k]);
-					break;
-				default:
-					typecode = "?";
-					val_str = "?";
-					break;
+					allow_semi = false;
+				}else if (token_is(words[i], "//")){
+					break; //the rest is a comment
+				}
 			}
-			val_str = val_str + "]";
 
-			m1d_vars.row({variables1D[i].name, typecode, val_str, variables1D[i].description});
+		}else if (token_is(words[0], "#VERTICAL")){
 
-		}
+			//Lines are checked as they are read. The block's first error is
+			//only reported once the closing statement is found, as load()
+			//reads the whole block before converting it.
+			size_t openedOnLine = lineNum;
+			size_t num_lines = 0; //Non-blank lines in the block
+			size_t head_line[2] = {0, 0};
+			size_t max_allowed = 0;
+			bool ok = true;
+			size_t err_line = 0;
+			std::string err_msg;
 
-		m1d_vars.alignt('l');
-		m1d_vars.alignh('l');
-		m1d_vars.alignc('l');
-		m1d_vars.alignc(3, 'l');
-		m1d_vars.trimc('c', trim_len);
-		out = out + m1d_vars.str();
-	}
+			bool foundBlock = false;
+			while (nextLine()){
 
-	if (variables2D.size() > 0){
-		KTable m2d_vars;
-		m2d_vars.table_title("2D Variables");
-		m2d_vars.row({"Name", "Type", "Value", "Description"});
-		for (size_t i = 0 ; i < variables2D.size() ; i++){
+				tokenize_line(line, line_len, ";", words);
 
-			size_t k,j;
-			std::string typecode = "";
-			std::string val_str = "";
-			switch (variables2D[i].type){
-				case('d'):
-					typecode = "double";
-					for (k = 0 ; k < variables2D[i].md2.size()-1 ; k++){
-						for (j = 0 ; j < variables2D[i].md2[k].size()-1 ; j++){
-							val_str = val_str + gstd::to_gstring(variables2D[i].md2[k][j]) + ", ";
-						}
-						val_str = val_str + gstd::to_gstring(variables2D[i].md2[k][j]) + " ; ";
-					}
-					for (j = 0 ; j < variables2D[i].md2[k].size()-1 ; j++){
-						val_str = val_str + gstd::to_gstring(variables2D[i].md2[k][j]) + ", ";
-					}
-					val_str = val_str + gstd::to_gstring(variables2D[i].md2[k][j]);
-					// valstr = std::to_string(variables2D[i].d);
+				if (words.size() < 1) continue; //Skip blank lines
+				if (words[0].len >= 2 && words[0].p[0] == '/' && words[0].p[1] == '/') continue; //Skip comments
+
+				if (token_is(words[0], "#VERTICAL")){
+					foundBlock = true;
 					break;
-				case('s'):
-					typecode = "string";
-					for (k = 0 ; k < variables2D[i].ms2.size()-1 ; k++){
-						for (j = 0 ; j < variables2D[i].ms2[k].size()-1 ; j++){
-							val_str = val_str + "\"" + (variables2D[i].ms2[k][j]) + "\", ";
+				}
+
+				//Trim inline comments (at the last '//', as the reader does)
+				size_t trimmed_len = line_len;
+				for (size_t l = 1 ; l+1 < line_len ; l++){
+					if (line[l] == '/' && line[l+1] == '/') trimmed_len = l;
+				}
+
+				num_lines++;
+				if (!ok) continue; //Already failed - just look for the end of the block
+
+				if (num_lines <= 2){
+					head[num_lines-1].assign(line, trimmed_len);
+					head_line[num_lines-1] = lineNum;
+					continue;
+				}
+
+				if (num_lines == 3){
+
+					tokenize_line(head[0].c_str(), head[0].length(), "", types);
+					tokenize_line(head[1].c_str(), head[1].length(), "", names);
+
+					//Count descriptions - non-empty pieces between question marks
+					size_t num_descs = 0;
+					bool is_desc = (trimmed_len >= 1 && line[0] == '?');
+					if (is_desc){
+						const char* p = line;
+						const char* e = line + trimmed_len;
+						while (e > p && isspace(static_cast<unsigned char>(e[-1]))) e--;
+						bool in_piece = false;
+						for (; p < e ; p++){
+							if (*p == '?'){
+								in_piece = false;
+							}else if (!in_piece){
+								in_piece = true;
+								num_descs++;
+							}
 						}
-						val_str = val_str + "\"" + (variables2D[i].ms2[k][j]) + "\" ; ";
 					}
-					for (j = 0 ; j < variables2D[i].ms2[k].size()-1 ; j++){
-						val_str = val_str + "\"" + (variables2D[i].ms2[k][j]) + "\", ";
+
+					if (types.size() != names.size() || (num_descs > 0 && num_descs != types.size())){
+						err_line = head_line[0];
+						err_msg = "Number of type declarations, names, and descriptions (if present) must match.";
+						ok = false;
+						continue;
 					}
-					val_str = val_str + "\"" + (variables2D[i].ms2[k][j]) + "\"";
-					break;
-				case('b'):
-					typecode = "bool";
-					for (k = 0 ; k < variables2D[i].mb2.size()-1 ; k++){
-						for (j = 0 ; j < variables2D[i].mb2[k].size()-1 ; j++){
-							val_str = val_str + bool_to_string(variables2D[i].mb2[k][j]) + ", ";
+
+					for (size_t i = 0 ; i < names.size() && ok ; i++){
+						if (!is_valid_name(names[i].p, names[i].len)){
+							err_line = head_line[1];
+							err_msg = "Variable name '" + str(names[i]) + "' is invalid.";
+							ok = false;
+						}else if (!token_is(types[i], "m<d>") && !token_is(types[i], "m<s>") && !token_is(types[i], "m<b>")){
+							err_line = head_line[0];
+							err_msg = "Type '" + str(types[i]) + "' is invalid.";
+							ok = false;
 						}
-						val_str = val_str + bool_to_string(variables2D[i].mb2[k][j]) + " ; ";
 					}
-					for (j = 0 ; j < variables2D[i].mb2[k].size()-1 ; j++){
-						val_str = val_str + bool_to_string(variables2D[i].mb2[k][j]) + ", ";
+					if (!ok) continue;
+
+					max_allowed = names.size();
+					if (is_desc) continue;
+				}
+
+				//Check data line
+				tokenize_line(line, trimmed_len, "", words, true);
+
+				if (words.size() > max_allowed){
+					err_line = lineNum;
+					err_msg = "Too many characters detected.";
+					ok = false;
+					continue;
+				}
+				if (words.size() < max_allowed) max_allowed = words.size();
+
+				for (size_t i = 0 ; i < words.size() ; i++){
+
+					size_t n = words[i].len;
+					if (n > 0 && words[i].p[n-1] == ';') n--; //Row end marker
+
+					char type = types[i].p[2];
+					bool valid = (type == 'd') ? is_number_prefix(words[i].p, n) : ((type == 'b') ? is_bool_word(words[i].p, n) : is_string_literal(words[i].p, n));
+					if (!valid){
+						std::string desc = (type == 'd') ? "double" : ((type == 'b') ? "bool" : "string");
+						err_line = lineNum;
+						err_msg = "Failed to convert '" + std::string(words[i].p, n) + "' to a " + desc + ".";
+						ok = false;
+						break;
 					}
-					val_str = val_str + bool_to_string(variables2D[i].mb2[k][j]);
-					break;
-				default:
-					typecode = "?";
-					val_str = "?";
-					break;
+				}
+			}
+
+			if (!foundBlock){
+				fail(openedOnLine, "Failed to find closing #VERTICAL statement.");
+				stop = true;
+				continue;
+			}
+
+			if (num_lines < 3){
+				errors.push_back("Failed in vertical block beginning on line " + std::to_string(openedOnLine) + ".\n\tFound fewer than three non-blank lines.");
+				stop = (max_errors != 0 && errors.size() >= max_errors);
+				continue;
 			}
 
-			m2d_vars.row({variables2D[i].name, typecode, val_str, variables2D[i].description});
+			if (!ok) stop = fail(err_line, err_msg);
+
+		}else{
+			stop = fail(lineNum, "Unidentified token '" + str(words[0]) + "'");
+		}
+
+	}
+
+	//Save errors
+	err_str = "";
+	for (size_t i = 0 ; i < errors.size() ; i++){
+		if (i != 0) err_str = err_str + "\n";
+		err_str = err_str + errors[i];
+	}
+
+	return errors.empty();
+}
+
+//***************************************************************************//
+//*************** STATISTICS
+
+/*
+Computes min, max, mean, sum, argmin, argmax and the number of elements greater
+than 'threshold' for the m<d> variable 'varName' in one pass, directly on the
+stored data (see simd_reduce). For 2D matrices the rows are treated as if
+appended end to end, so argmin/argmax are linear indices.
+
+Returns false if the variable doesn't exist or isn't a matrix of doubles. Like
+get(), it doesn't touch the error string, so it's safe to call from concurrent
+readers (eg. on a DDFSnapshot).
+*/
+bool DDFIO::stats(std::string varName, DDFStats& out, double threshold) const{
+
+	size_t idx = find(varName);
+	if (idx == DDF_NPOS) return false;
+
+	return reduce(idx, out, threshold);
+}
+
+/*
+Computes stats() for each variable in 'varNames', saving the results in 'out'
+in the same order. Each column is reduced in a single pass for all statistics.
+
+Returns false if any variable fails; 'out' is then incomplete.
+*/
+bool DDFIO::stats(std::vector<std::string> varNames, std::vector<DDFStats>& out, double threshold) const{
+
+	out.clear();
+	out.reserve(varNames.size());
+
+	DDFStats st;
+	for (size_t i = 0 ; i < varNames.size() ; i++){
+		if (!stats(varNames[i], st, threshold)) return false;
+		out.push_back(st);
+	}
+
+	return true;
+}
+
+/*
+Computes stats() for row 'row' of the 2D m<d> variable 'varName'. argmin and
+argmax are column indices within the row.
+
+Returns false if the variable doesn't exist, isn't a 2D matrix of doubles, or
+has no such row. Doesn't touch the error string.
+*/
+bool DDFIO::rowStats(std::string varName, size_t row, DDFStats& out, double threshold) const{
+
+	size_t idx = find(varName);
+	if (idx == DDF_NPOS || ddf_dims(values[idx]) != 2) return false;
+	if (ddf_type(values[idx]) != 'd') return false;
+	if (row >= matrixRows(values[idx])) return false;
+
+	if (const std::pmr::vector<std::pmr::vector<float> >* mf2 = std::get_if<DDF_MF2>(&values[idx])){ //Single precision
+		out = simd_reduce((*mf2)[row].data(), (*mf2)[row].size(), threshold);
+	}else{
+		const std::pmr::vector<double>& r = std::get<DDF_MD2>(values[idx])[row];
+		out = simd_reduce(r.data(), r.size(), threshold);
+	}
+	return true;
+}
+
+
+
+//***************************************************************************//
+//*************** VARIABLE MANAGEMENT
+
+bool DDFIO::checkContains(std::vector<std::string> names){ //TODO: impliment checkContains()
+	std::cout << "Oops! Need to impliment this :)" << std::endl;
+	return false;
+}
+
+/*
+Clears all variables from the DDFIO object.
+*/
+void DDFIO::clear(){
+	fileVersion = -1;
+	header = "";
+	if (reuse_mode && values.size() > 0) values.swap(spare); //Keep payloads for the next load to refill
+	values.clear();
+	meta.clear();
+	meta_text.clear();
+}
+
+/*
+Returns the number of variables of all types combined that are presently loaded
+in this DDFIO object.
+*/
+size_t DDFIO::numVar() const{
+	return values.size();
+}
+
+/*
+Chooses the storage precision of the m<d> matrix 'varName', overriding the
+'f' load option. Applies to the variable if it is already loaded and whenever
+it is loaded or added later (clear() does not reset it). Keeping a matrix as
+float halves its memory; values are widened when read as doubles.
+*/
+void DDFIO::storeAsFloat(std::string varName, bool as_float){
+
+	float_override[varName] = as_float;
+
+	size_t idx = find(varName);
+	if (idx != DDF_NPOS) setStorage(values[idx], as_float);
+}
+
+/*
+Turns reuse mode on or off. In reuse mode clear() (and so clload()) keeps the
+loaded matrices instead of freeing them, and the next load refills them in
+place wherever a variable has the same type at the same position in the file.
+Loading many files of the same shape then reuses the same buffers rather than
+growing new ones each time. Use shrink() to give the memory back.
+*/
+void DDFIO::reuse(bool enable){
+
+	reuse_mode = enable;
+	if (!enable) std::pmr::vector<DDFValue>(memres).swap(spare);
+}
+
+/*
+Frees the memory kept for reuse (see reuse()) and any unused capacity in the
+loaded variables.
+*/
+void DDFIO::shrink(){
+
+	std::pmr::vector<DDFValue>(memres).swap(spare);
+
+	for (size_t i = 0 ; i < values.size() ; i++){
+		std::visit([](auto& x){ ddf_shrink(x); }, values[i]);
+	}
+
+	values.shrink_to_fit();
+	meta.shrink_to_fit();
+	meta_text.shrink_to_fit();
+	header.shrink_to_fit();
+}
+
+/*
+Reports the memory used by the object, broken down by variable and category.
+Heap memory is counted by capacity, so the figures include slack that
+shrink_to_fit() would give back.
+*/
+DDFMemoryUsage DDFIO::memoryUsage() const{
+
+	DDFMemoryUsage mu;
+	mu.flat = 0;
+	mu.matrix1D = 0;
+	mu.matrix2D = 0;
+	mu.metadata = 0;
+
+	for (size_t i = 0 ; i < values.size() ; i++){
+
+		DDFVarMemory vm;
+		vm.name = nameOf(i);
+		vm.type = ddf_type(values[i]);
+		vm.dims = ddf_dims(values[i]);
+		vm.payload = ddf_payload_bytes(values[i]);
+		vm.metadata = sizeof(DDFMeta) + meta[i].name_len + meta[i].desc_len;
+
+		switch(vm.dims){
+			case(0):
+				mu.flat += vm.payload;
+				break;
+			case(1):
+				mu.matrix1D += vm.payload;
+				break;
+			default:
+				mu.matrix2D += vm.payload;
+				break;
+		}
+		mu.metadata += vm.metadata;
+
+		mu.variables.push_back(vm);
+	}
+
+	mu.header = header.length();
+
+	//Everything the object holds - whatever isn't assigned to a category above is overhead
+	mu.total = sizeof(DDFIO) + (values.capacity() - values.size())*sizeof(DDFValue) + meta.capacity()*sizeof(DDFMeta) + ddf_heap_bytes(meta_text) + ddf_heap_bytes(header) + ddf_heap_bytes(err_str);
+	mu.total += mu.flat + mu.matrix1D + mu.matrix2D;
+	mu.total += spare.capacity()*sizeof(DDFValue);
+	for (size_t i = 0 ; i < spare.size() ; i++){
+		mu.total += ddf_payload_bytes(spare[i]) - sizeof(DDFValue); //Kept for reuse() - counts as overhead
+	}
+	mu.overhead = mu.total - mu.flat - mu.matrix1D - mu.matrix2D - mu.metadata - mu.header;
+
+	return mu;
+}
+
+/*
+Returns the memory resource the object allocates from.
+*/
+std::pmr::memory_resource* DDFIO::resource() const{
+	return memres;
+}
+
+//***************************************************************************//
+//*************** HEADER
+
+/*
+Sets the header
+*/
+void DDFIO::setHeader(std::string h){
+	header = h;
+}
+
+/*
+Returns the header
+*/
+std::string DDFIO::getHeader() const{
+	return std::string(header);
+}
+
+/*
+Returns the file's verion.
+*/
+double DDFIO::getVersion() const{
+	return fileVersion;
+}
+
+/*
+Returns the error status
+*/
+std::string DDFIO::err() const{
+	return err_str;
+}
+
+//***************************************************************************//
+//*************** PRINTING
+
+/*
+Returns a vector of strings of the variables' names.
+
+Options:
+	- t: include variable type with name
+	- m: merge all names into one string, save in returned vector's index 0.
+*/
+std::vector<std::string> DDFIO::names(std::string options) const{
+
+	//Options
+	bool include_type = false;
+	bool merge = false;
+
+	//Read in options
+	if (options.find("t", 0) != std::string::npos){
+		include_type = true;
+	}
+	if (options.find("m", 0) != std::string::npos){
+		merge = true;
+	}
+
+	//Sort names into flat, 1D and 2D in one pass
+	std::vector<std::string> by_dims[3];
+	forEach([&](const DDFVarInfo& v){
+
+		std::vector<std::string>& group = by_dims[v.dims];
+		group.push_back(std::string(v.name));
+		if (include_type){
+			switch(v.dims){
+				case(0):
+					group.back() += std::string(" (") + v.type + ")";
+					break;
+				case(1):
+					group.back() += std::string(" (m<") + v.type + ">)";
+					break;
+				default:
+					group.back() += std::string(" (m<") + v.type + ">(2D))";
+					break;
+			}
+		}
+	});
+
+	//Add flat names, then 1D names, then 2D names
+	std::vector<std::string> names_out;
+	names_out.reserve(numVar());
+	for (int dims = 0 ; dims <= 2 ; dims++){
+		for (size_t i = 0 ; i < by_dims[dims].size() ; i++){
+			names_out.push_back(std::move(by_dims[dims][i]));
+		}
+	}
+
+	//Merge (if requested)
+	if (merge){
+
+		size_t len = 0;
+		for (size_t i = 0 ; i < names_out.size() ; i++){
+			len += names_out[i].length() + 2;
+		}
+
+		std::string merged_str; //Create blank string
+		merged_str.reserve(len);
+
+		//For each name...
+		for (size_t i = 0 ; i < names_out.size() ; i++){
+			if (i != 0) merged_str += ", "; //Comma between names
+			merged_str += names_out[i];
+		}
+
+		names_out.clear(); //Clear output vector
+		names_out.push_back(merged_str); //push back merged string
+	}
+
+	//Return names vector
+	return names_out;
+
+}
+
+/*
+Returns the contents of the DDFIO object as a string. Matrices are summarized
+rather than printed in full: their size, their first 'preview' elements, and
+min/max/mean (m<d>) or the number of true values (m<b>). The cost depends on
+the preview length, not the size of the matrices (apart from the one pass for
+the summary, which doesn't allocate).
+*/
+std::string DDFIO::show(size_t preview) const{
+
+	std::string out = "";
+
+	out = "No. Variables: " + std::to_string(numVar());
+
+	std::vector<size_t> flat = indicesOf(0);
+	std::vector<size_t> m1d = indicesOf(1);
+	std::vector<size_t> m2d = indicesOf(2);
+	out = out + "\nFlat Variables:\n";
+
+	size_t trim_len = 45;
+
+	if (flat.size() > 0){
+		KTable flat_vars;
+		flat_vars.table_title("Flat Variables");
+		flat_vars.row({"Name", "Type", "Value", "Description"});
+		for (size_t i = 0 ; i < flat.size() ; i++){
+
+			std::string typecode = "";
+			std::string valstr = "";
+			switch (ddf_type(values[flat[i]])){
+				case('d'):
+					typecode = "double";
+					valstr = std::to_string(std::get<DDF_D>(values[flat[i]]));
+					break;
+				case('s'):
+					typecode = "string";
+					valstr = std::get<DDF_S>(values[flat[i]]);
+					break;
+				case('b'):
+					typecode = "bool";
+					valstr = bool_to_string(std::get<DDF_B>(values[flat[i]]));
+					break;
+				default:
+					typecode = "?";
+					valstr = "?";
+					break;
+			}
+
+			flat_vars.row({nameOf(flat[i]), typecode, valstr, descOf(flat[i])});
+
+		}
+
+		flat_vars.alignt('l');
+		flat_vars.alignh('l');
+		flat_vars.alignc('l');
+		flat_vars.alignc(3, 'l');
+		flat_vars.trimc('c', trim_len);
+		out = out + flat_vars.str();
+	}
+
+	if (m1d.size() > 0){
+		KTable m1d_vars;
+		m1d_vars.table_title("1D Variables");
+		m1d_vars.row({"Name", "Type", "Size", "Value", "Summary", "Description"});
+		for (size_t i = 0 ; i < m1d.size() ; i++){
+
+			std::string typecode = "";
+			switch (ddf_type(values[m1d[i]])){
+				case('d'):
+					typecode = "m<double>";
+					break;
+				case('s'):
+					typecode = "m<string>";
+					break;
+				case('b'):
+					typecode = "m<bool>";
+					break;
+				default:
+					typecode = "?";
+					break;
+			}
+
+			m1d_vars.row({nameOf(m1d[i]), typecode, shapeOf(m1d[i]), "[" + previewOf(m1d[i], preview) + "]", summaryOf(m1d[i]), descOf(m1d[i])});
+
+		}
+
+		m1d_vars.alignt('l');
+		m1d_vars.alignh('l');
+		m1d_vars.alignc('l');
+		m1d_vars.alignc(5, 'l');
+		m1d_vars.trimc('c', trim_len);
+		out = out + m1d_vars.str();
+	}
+
+	if (m2d.size() > 0){
+		KTable m2d_vars;
+		m2d_vars.table_title("2D Variables");
+		m2d_vars.row({"Name", "Type", "Size", "Value", "Summary", "Description"});
+		for (size_t i = 0 ; i < m2d.size() ; i++){
+
+			std::string typecode = "";
+			switch (ddf_type(values[m2d[i]])){
+				case('d'):
+					typecode = "double";
+					break;
+				case('s'):
+					typecode = "string";
+					break;
+				case('b'):
+					typecode = "bool";
+					break;
+				default:
+					typecode = "?";
+					break;
+			}
+
+			m2d_vars.row({nameOf(m2d[i]), typecode, shapeOf(m2d[i]), previewOf(m2d[i], preview), summaryOf(m2d[i]), descOf(m2d[i])});
+
+		}
+
+		m2d_vars.alignt('l');
+		m2d_vars.alignh('l');
+		m2d_vars.alignc('l');
+		m2d_vars.alignc(5, 'l');
+		m2d_vars.trimc('c', trim_len);
+		out = out + m2d_vars.str();
+	}
+
+	return out;
+}
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Verifies that the proposed variable name is a valid variable name.
+
+Returns true if the name is valid.
+*/
+bool DDFIO::isValidName(std::string name){
+
+	//Ensure name is at least 1 character
+	if (name.length() < 1){
+		return false;
+	}
+
+	//Make sure name starts with a letter
+	if (!isalpha(name[0])){
+		return false;
+	}
+
+	//For each character...
+	for (size_t i = 0 ; i < name.length() ; i++){
+
+		//Check if it is whitespace...
+		if (isspace(name[i]) == 1){
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+Checks if the variable name is already in use. Returns true if in use.
+*/
+bool DDFIO::nameInUse(std::string name){
+	return (find(name) != DDF_NPOS);
+}
+
+/*
+Adds a variable to the object. Its value is moved into 'values' and its name
+and description are appended to the side table. Does not check the name.
+m<d> matrices are kept as floats if 'use_float' is true, unless storeAsFloat()
+says otherwise for this name.
+*/
+void DDFIO::store(DDFVariable& var, bool use_float){
+
+	std::map<std::string, bool>::const_iterator ovr = float_override.find(var.name);
+	if (ovr != float_override.end()) use_float = ovr->second;
+	setStorage(var.value, use_float);
+
+	DDFMeta m;
+	m.name = meta_text.length();
+	m.name_len = var.name.length();
+	meta_text += var.name;
+	m.desc = meta_text.length();
+	m.desc_len = var.description.length();
+	meta_text += var.description;
+
+	values.push_back(std::move(var.value));
+	meta.push_back(m);
+}
+
+/*
+Converts an m<d> matrix to single precision if 'as_float' is true, or back to
+double precision if false. Other values are left alone.
+*/
+void DDFIO::setStorage(DDFValue& v, bool as_float){
+
+	if (as_float && v.index() == DDF_MD){
+		std::pmr::vector<double> md = std::move(std::get<DDF_MD>(v));
+		ddf_assign(v.emplace<DDF_MF>(memres), md);
+	}else if (as_float && v.index() == DDF_MD2){
+		std::pmr::vector<std::pmr::vector<double> > md2 = std::move(std::get<DDF_MD2>(v));
+		ddf_assign(v.emplace<DDF_MF2>(memres), md2);
+	}else if (!as_float && v.index() == DDF_MF){
+		std::pmr::vector<float> mf = std::move(std::get<DDF_MF>(v));
+		ddf_assign(v.emplace<DDF_MD>(memres), mf);
+	}else if (!as_float && v.index() == DDF_MF2){
+		std::pmr::vector<std::pmr::vector<float> > mf2 = std::move(std::get<DDF_MF2>(v));
+		ddf_assign(v.emplace<DDF_MD2>(memres), mf2);
+	}
+}
+
+/*
+Makes 'v' hold alternative I and returns it, empty, for the parser to fill. In
+reuse mode the payload at the same position in the previous load is taken
+instead if it has the same type, so its buffers are refilled in place. 2D
+matrices keep their rows (emptied) - resize them to the final row count rather
+than appending.
+*/
+template<size_t I>
+std::variant_alternative_t<I, DDFValue>& DDFIO::recycled(DDFValue& v){
+
+	size_t pos = values.size();
+	if (reuse_mode && pos < spare.size() && spare[pos].index() == I){
+		v = std::move(spare[pos]);
+		ddf_empty(std::get<I>(v));
+		return std::get<I>(v);
+	}
+
+	return v.emplace<I>(memres);
+}
+
+/*
+Returns the index of the variable called 'name', or DDF_NPOS if there is none.
+*/
+size_t DDFIO::find(const std::string& name) const{
+
+	for (size_t i = 0 ; i < meta.size() ; i++){
+		if (meta[i].name_len == name.length() && meta_text.compare(meta[i].name, meta[i].name_len, name) == 0) return i;
+	}
+
+	return DDF_NPOS;
+}
+
+/*
+Returns the indices of all variables with 'dims' dimensions (0 for non-matrix
+variables), in the order they were added.
+*/
+std::vector<size_t> DDFIO::indicesOf(int dims) const{
+
+	std::vector<size_t> idx;
+	for (size_t i = 0 ; i < values.size() ; i++){
+		if (ddf_dims(values[i]) == dims) idx.push_back(i);
+	}
+
+	return idx;
+}
+
+/*
+Returns the name of variable 'idx'.
+*/
+std::string DDFIO::nameOf(size_t idx) const{
+	return std::string(meta_text.data() + meta[idx].name, meta[idx].name_len);
+}
+
+/*
+Returns the description of variable 'idx'.
+*/
+std::string DDFIO::descOf(size_t idx) const{
+	return std::string(meta_text.data() + meta[idx].desc, meta[idx].desc_len);
+}
+
+/*
+Copies variable 'name' into 'out' if it exists and holds DDFValue alternative
+'I'. Returns true if successful.
+*/
+template<size_t I, typename T>
+bool DDFIO::getValue(const std::string& name, T& out) const{
+
+	size_t idx = find(name);
+	if (idx == DDF_NPOS || values[idx].index() != I) return false;
+
+	ddf_assign(out, std::get<I>(values[idx]));
+	return true;
+}
+
+/*
+Reduces the m<d> matrix 'idx' for stats(). Returns false if it isn't a matrix
+of doubles.
+*/
+bool DDFIO::reduce(size_t idx, DDFStats& out, double threshold) const{
+
+	if (const std::pmr::vector<double>* md = std::get_if<DDF_MD>(&values[idx])){ //1D matrix
+		out = simd_reduce(md->data(), md->size(), threshold);
+		return true;
+	}
+
+	if (const std::pmr::vector<std::pmr::vector<double> >* md2 = std::get_if<DDF_MD2>(&values[idx])){ //2D matrix
+		out = simd_reduce(static_cast<const double*>(NULL), 0, threshold);
+		size_t offset = 0;
+		for (size_t r = 0 ; r < md2->size() ; r++){ //Reduce each row, merge into total
+			simd_merge_stats(out, simd_reduce((*md2)[r].data(), (*md2)[r].size(), threshold), offset);
+			offset += (*md2)[r].size();
+		}
+		return true;
+	}
+
+	if (const std::pmr::vector<float>* mf = std::get_if<DDF_MF>(&values[idx])){ //1D matrix, single precision
+		out = simd_reduce(mf->data(), mf->size(), threshold);
+		return true;
+	}
+
+	if (const std::pmr::vector<std::pmr::vector<float> >* mf2 = std::get_if<DDF_MF2>(&values[idx])){ //2D matrix, single precision
+		out = simd_reduce(static_cast<const double*>(NULL), 0, threshold);
+		size_t offset = 0;
+		for (size_t r = 0 ; r < mf2->size() ; r++){
+			simd_merge_stats(out, simd_reduce((*mf2)[r].data(), (*mf2)[r].size(), threshold), offset);
+			offset += (*mf2)[r].size();
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/*
+Builds the descriptor of variable 'idx'.
+*/
+DDFVarInfo DDFIO::infoOf(size_t idx) const{
+
+	DDFVarInfo v;
+	v.name = std::string_view(meta_text.data() + meta[idx].name, meta[idx].name_len);
+	v.description = std::string_view(meta_text.data() + meta[idx].desc, meta[idx].desc_len);
+	v.index = idx;
+	v.type = ddf_type(values[idx]);
+	v.dims = ddf_dims(values[idx]);
+	v.single = (values[idx].index() == DDF_MF || values[idx].index() == DDF_MF2);
+	v.value = &values[idx];
+
+	switch(v.dims){
+		case(0):
+			v.rows = 1;
+			v.cols = 1;
+			v.elements = 1;
+			break;
+		case(1):
+			v.elements = matrixLength(values[idx]);
+			v.rows = 1;
+			v.cols = v.elements;
+			break;
+		default:
+			v.elements = 0;
+			v.rows = matrixRows(values[idx]);
+			v.cols = 0;
+			for (size_t r = 0 ; r < v.rows ; r++){
+				size_t len = rowLength(values[idx], r);
+				v.elements += len;
+				if (len > v.cols) v.cols = len;
+			}
+			break;
+	}
+
+	return v;
+}
+
+/*
+Sorts the 1D and 2D matrices from largest to smallest. Matrices only trade
+places with matrices of the same dimension.
+*/
+void DDFIO::sortMatrices(){
+
+	for (int dims = 1 ; dims <= 2 ; dims++){ //Sort 1D matrices, then 2D matrices
+
+		std::vector<size_t> pos = indicesOf(dims); //Where the matrices of this dimension sit
+
+		for (size_t i = 1 ; i < pos.size() ; i++){ //For each matrix (skipping first) ...
+
+			//Get length
+			size_t el = matrixLength(values[pos[i]]);
+
+			size_t j = i-1; //Get position to compare against
+			while (el > matrixLength(values[pos[j]])){ //Keep checking new indeces until you find a larger or equal size matrix
+
+				//The current matrix is larger than the previous matrix...
+
+				if (j > 0){ //If possible, move compare index closer to 0
+					j--;
+				}else{ //Else break - you're at the beginning
+					break;
+				}
+			}
+
+			//Move matrix if required - shift the matrices in between back one place
+			if (j+1 == i){
+				for (size_t k = i ; k > j+1 ; k--){
+					std::swap(values[pos[k]], values[pos[k-1]]);
+					std::swap(meta[pos[k]], meta[pos[k-1]]);
+				}
+			}
+
+		}
+	}
+
+}
+
+/*
+Calculates the total number of elements (in all rows and cols, combined) in the
+matrix and returns it. Returns 0 for non-matrix variables.
+*/
+size_t DDFIO::matrixLength(const DDFValue& m) const{
+
+	size_t l = 0;
+
+	switch(m.index()){
+		case(DDF_MD):
+			return std::get<DDF_MD>(m).size();
+		case(DDF_MB):
+			return std::get<DDF_MB>(m).size();
+		case(DDF_MS):
+			return std::get<DDF_MS>(m).size();
+		case(DDF_MD2):
+			for (size_t j = 0 ; j < std::get<DDF_MD2>(m).size() ; j++){ //For each row...
+				l += std::get<DDF_MD2>(m)[j].size(); //Get size, increment sum
+			}
+			return l; //Return sum
+		case(DDF_MB2):
+			for (size_t j = 0 ; j < std::get<DDF_MB2>(m).size() ; j++){ //For each row...
+				l += std::get<DDF_MB2>(m)[j].size(); //Get size, increment sum
+			}
+			return l; //Return sum
+		case(DDF_MS2):
+			for (size_t j = 0 ; j < std::get<DDF_MS2>(m).size() ; j++){ //For each row...
+				l += std::get<DDF_MS2>(m)[j].size(); //Get size, increment sum
+			}
+			return l; //Return sum
+		case(DDF_MF):
+			return std::get<DDF_MF>(m).size();
+		case(DDF_MF2):
+			for (size_t j = 0 ; j < std::get<DDF_MF2>(m).size() ; j++){ //For each row...
+				l += std::get<DDF_MF2>(m)[j].size(); //Get size, increment sum
+			}
+			return l; //Return sum
+		default:
+			return 0;
+	}
+
+}
+
+/*
+Returns the number of rows in a 2D matrix, or 0 for other variables.
+*/
+size_t DDFIO::matrixRows(const DDFValue& m) const{
+
+	switch(m.index()){
+		case(DDF_MD2):
+			return std::get<DDF_MD2>(m).size();
+		case(DDF_MB2):
+			return std::get<DDF_MB2>(m).size();
+		case(DDF_MS2):
+			return std::get<DDF_MS2>(m).size();
+		case(DDF_MF2):
+			return std::get<DDF_MF2>(m).size();
+		default:
+			return 0;
+	}
+
+}
+
+/*
+Returns the number of elements in row 'row' of a 2D matrix, or 0 for other
+variables. 'row' must be in range.
+*/
+size_t DDFIO::rowLength(const DDFValue& m, size_t row) const{
+
+	switch(m.index()){
+		case(DDF_MD2):
+			return std::get<DDF_MD2>(m)[row].size();
+		case(DDF_MB2):
+			return std::get<DDF_MB2>(m)[row].size();
+		case(DDF_MS2):
+			return std::get<DDF_MS2>(m)[row].size();
+		case(DDF_MF2):
+			return std::get<DDF_MF2>(m)[row].size();
+		default:
+			return 0;
+	}
+
+}
+
+/*
+Splits matrix 'idx' into ranges for formatRange() of about DDF_WRITE_CHUNK
+elements each. 1D matrices are split by element and 2D matrices by row.
+Returns the bounds: range c is [bounds[c], bounds[c+1]).
+*/
+std::vector<size_t> DDFIO::chunkBounds(size_t idx) const{
+
+	std::vector<size_t> bounds(1, 0);
+
+	if (ddf_dims(values[idx]) == 1){
+		size_t n = matrixLength(values[idx]);
+		for (size_t k = DDF_WRITE_CHUNK ; k < n ; k += DDF_WRITE_CHUNK){
+			bounds.push_back(k);
+		}
+		bounds.push_back(n);
+	}else{
+		size_t rows = matrixRows(values[idx]);
+		size_t count = 0;
+		for (size_t r = 0 ; r < rows ; r++){
+			count += rowLength(values[idx], r);
+			if (count >= DDF_WRITE_CHUNK && r+1 < rows){
+				bounds.push_back(r+1);
+				count = 0;
+			}
+		}
+		bounds.push_back(rows);
+	}
+
+	return bounds;
+}
+
+/*
+Appends elements [first, last) of 1D matrix 'idx', or rows [first, last) of
+2D matrix 'idx', to 'out' as they appear between the brackets of an inline
+matrix statement. Each piece starts with the separator that precedes it, so
+consecutive ranges can simply be joined.
+*/
+void DDFIO::formatRange(size_t idx, size_t first, size_t last, std::pmr::string& out) const{
+
+	switch(values[idx].index()){
+		case(DDF_MD):
+			append_elements(std::get<DDF_MD>(values[idx]), first, last, out);
+			break;
+		case(DDF_MB):
+			append_elements(std::get<DDF_MB>(values[idx]), first, last, out);
+			break;
+		case(DDF_MS):
+			append_elements(std::get<DDF_MS>(values[idx]), first, last, out);
+			break;
+		case(DDF_MF):
+			append_elements(std::get<DDF_MF>(values[idx]), first, last, out);
+			break;
+		case(DDF_MD2):
+			append_rows(std::get<DDF_MD2>(values[idx]), first, last, out);
+			break;
+		case(DDF_MB2):
+			append_rows(std::get<DDF_MB2>(values[idx]), first, last, out);
+			break;
+		case(DDF_MS2):
+			append_rows(std::get<DDF_MS2>(values[idx]), first, last, out);
+			break;
+		case(DDF_MF2):
+			append_rows(std::get<DDF_MF2>(values[idx]), first, last, out);
+			break;
+	}
+
+}
+
+/*
+Formats every element of matrix 'idx' into 'cells', one per line of a vertical
+block. Elements ending a row of a 2D matrix get a trailing semicolon.
+*/
+void DDFIO::formatColumn(size_t idx, std::pmr::vector<std::pmr::string>& cells) const{
+
+	cells.clear();
+	cells.reserve(matrixLength(values[idx]));
+
+	switch(values[idx].index()){
+		case(DDF_MD):
+			append_cells(std::get<DDF_MD>(values[idx]), cells);
+			break;
+		case(DDF_MB):
+			append_cells(std::get<DDF_MB>(values[idx]), cells);
+			break;
+		case(DDF_MS):
+			append_cells(std::get<DDF_MS>(values[idx]), cells);
+			break;
+		case(DDF_MF):
+			append_cells(std::get<DDF_MF>(values[idx]), cells);
+			break;
+		case(DDF_MD2):
+			append_cells(std::get<DDF_MD2>(values[idx]), cells);
+			break;
+		case(DDF_MB2):
+			append_cells(std::get<DDF_MB2>(values[idx]), cells);
+			break;
+		case(DDF_MS2):
+			append_cells(std::get<DDF_MS2>(values[idx]), cells);
+			break;
+		case(DDF_MF2):
+			append_cells(std::get<DDF_MF2>(values[idx]), cells);
+			break;
+	}
+
+}
+
+/*
+Runs each job once. If 'parallel' is true and there is more than one job, they
+are run on the shared thread pool and this returns when all have finished.
+*/
+void DDFIO::runJobs(std::vector<std::function<void()> >& jobs, bool parallel) const{
+
+	if (!parallel || jobs.size() < 2){
+		for (size_t i = 0 ; i < jobs.size() ; i++){
+			jobs[i]();
+		}
+		return;
+	}
+
+	DDFThreadPool& pool = DDFThreadPool::shared();
+	std::atomic<size_t> remaining(jobs.size());
+	for (size_t i = 0 ; i < jobs.size() ; i++){
+		std::function<void()>* job = &jobs[i];
+		pool.submit([job, &remaining](){
+			DDFTaskDone done(remaining);
+			(*job)();
+		});
+	}
+	pool.wait(remaining);
+}
+
+/*
+Returns the size of matrix 'idx' for show(): the number of elements for 1D
+matrices, 'rows x columns' for 2D matrices, or the number of rows and elements
+if its rows differ in length.
+*/
+std::string DDFIO::shapeOf(size_t idx) const{
+
+	size_t n = matrixLength(values[idx]);
+	if (ddf_dims(values[idx]) == 1) return std::to_string(n);
+
+	size_t rows = matrixRows(values[idx]);
+	size_t cols = (rows > 0) ? rowLength(values[idx], 0) : 0;
+	if (cols * rows == n){
+		bool ragged = false;
+		for (size_t r = 1 ; r < rows && !ragged ; r++){
+			ragged = (rowLength(values[idx], r) != cols);
+		}
+		if (!ragged) return std::to_string(rows) + "x" + std::to_string(cols);
+	}
+
+	return std::to_string(rows) + " rows, " + std::to_string(n) + " el.";
+}
+
+/*
+Formats at most 'max_elements' elements from the start of matrix 'idx' as
+they appear in a matrix statement, with '...' if there are more.
+*/
+std::string DDFIO::previewOf(size_t idx, size_t max_elements) const{
+
+	std::string out;
+
+	switch(values[idx].index()){
+		case(DDF_MD):
+			append_preview(std::get<DDF_MD>(values[idx]), max_elements, out);
+			break;
+		case(DDF_MB):
+			append_preview(std::get<DDF_MB>(values[idx]), max_elements, out);
+			break;
+		case(DDF_MS):
+			append_preview(std::get<DDF_MS>(values[idx]), max_elements, out);
+			break;
+		case(DDF_MF):
+			append_preview(std::get<DDF_MF>(values[idx]), max_elements, out);
+			break;
+		case(DDF_MD2):
+			append_preview(std::get<DDF_MD2>(values[idx]), max_elements, out);
+			break;
+		case(DDF_MB2):
+			append_preview(std::get<DDF_MB2>(values[idx]), max_elements, out);
+			break;
+		case(DDF_MS2):
+			append_preview(std::get<DDF_MS2>(values[idx]), max_elements, out);
+			break;
+		case(DDF_MF2):
+			append_preview(std::get<DDF_MF2>(values[idx]), max_elements, out);
+			break;
+	}
+
+	return out;
+}
+
+/*
+Returns a one-line summary of matrix 'idx' for show(): min, max and mean for
+m<d>, the number of true values for m<b>. Blank for m<s> and empty matrices.
+*/
+std::string DDFIO::summaryOf(size_t idx) const{
+
+	DDFStats st;
+	if (reduce(idx, st, 0)){
+		if (st.count == 0) return "";
+		return "min " + gstd::to_gstring(st.min) + ", max " + gstd::to_gstring(st.max) + ", mean " + gstd::to_gstring(st.mean);
+	}
+
+	size_t n = 0;
+	if (const std::pmr::vector<bool>* mb = std::get_if<DDF_MB>(&values[idx])){
+		for (size_t k = 0 ; k < mb->size() ; k++) n += (*mb)[k];
+	}else if (const std::pmr::vector<std::pmr::vector<bool> >* mb2 = std::get_if<DDF_MB2>(&values[idx])){
+		for (size_t r = 0 ; r < mb2->size() ; r++){
+			for (size_t k = 0 ; k < (*mb2)[r].size() ; k++) n += (*mb2)[r][k];
+		}
+	}else{
+		return "";
+	}
+
+	return (matrixLength(values[idx]) > 0) ? std::to_string(n) + " true" : "";
+}
+
+/*
+Initializes the KTable for use in generating vertical DDF matrix statements.
+*/
+void DDFIO::init_ktable(KTable& kt){
+
+	kt.table_title("");
+	kt.set(KTABLE_INTERWALLS, false);
+	kt.set(KTABLE_SIDEWALLS, false);
+	kt.set(KTABLE_TOPBOTTOMHBAR, false);
+	kt.set(KTABLE_HEADERINTERWALLS, false);
+	kt.set(KTABLE_HEADERHBAR, false);
+	kt.set(KTABLE_TITLEHBAR, false);
+	// kt.set(KTABLE_TITLEBAR, false); //TODO: KTable bug - if I turn title off, can't surpress preceeding ----s and on same line :\
+	// kt.set(KTABLE_INTERHBARS, false);
+	kt.alignh('l');
+	kt.alignc('l');
+	kt.alignt('l');
+
+}
+
+//***************************************************************************//
+//**			NON-CLASS FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+
+
+std::string bool_to_string(bool b){
+	return b? "true" : "false";
+}
+
+/*
+Returns the shortest string that reads back as exactly 'f' when parsed as a
+float. Never needs more than 9 significant digits.
+*/
+std::string float_to_string(float f){
+
+	char buf[32];
+	for (int p = 6 ; p <= 9 ; p++){
+		snprintf(buf, sizeof(buf), "%.*g", p, f);
+		if (strtof(buf, NULL) == f) break;
+	}
+
+	return buf;
+}
+
+/*
+Formats one matrix element as it is written in a DDF file.
+*/
+std::string element_string(double x){
+	return gstd::to_gstring(x);
+}
+
+std::string element_string(float x){
+	return float_to_string(x);
+}
+
+std::string element_string(bool x){
+	return bool_to_string(x);
+}
+
+std::string element_string(const std::string& x){
+	return escape_string(x.data(), x.length());
+}
+
+std::string element_string(const std::pmr::string& x){
+	return escape_string(x.data(), x.length());
+}
+
+/*
+Appends elements [first, last) of 'v' to 'out', each preceded by a comma
+unless it is the first element of 'v'.
+*/
+template<typename T, typename A, typename S>
+void append_elements(const std::vector<T, A>& v, size_t first, size_t last, S& out){
+
+	for (size_t k = first ; k < last ; k++){
+		if (k != 0) out += ", ";
+		out += element_string(static_cast<const T&>(v[k]));
+	}
+}
+
+/*
+Appends rows [first, last) of 'm' to 'out', each preceded by a semicolon
+unless it is the first row of 'm'.
+*/
+template<typename T, typename A, typename B, typename S>
+void append_rows(const std::vector<std::vector<T, A>, B>& m, size_t first, size_t last, S& out){
+
+	for (size_t k = first ; k < last ; k++){
+		if (k != 0) out += "; ";
+		append_elements(m[k], 0, m[k].size(), out);
+	}
+}
+
+/*
+Appends each element of 'v' to 'cells' as a string.
+*/
+template<typename T, typename A, typename C>
+void append_cells(const std::vector<T, A>& v, C& cells){
+
+	for (size_t k = 0 ; k < v.size() ; k++){
+		cells.emplace_back(element_string(static_cast<const T&>(v[k])));
+	}
+}
+
+/*
+Appends each element of 'm' to 'cells' as a string, row after row. The last
+element of each row gets a trailing semicolon.
+*/
+template<typename T, typename A, typename B, typename C>
+void append_cells(const std::vector<std::vector<T, A>, B>& m, C& cells){
 
+	for (size_t r = 0 ; r < m.size() ; r++){
+		for (size_t k = 0 ; k < m[r].size() ; k++){
+			cells.emplace_back(element_string(static_cast<const T&>(m[r][k])));
+			if (k+1 == m[r].size()) cells.back() += ";";
 		}
-
-		m2d_vars.alignt('l');
-		m2d_vars.alignh('l');
-		m2d_vars.alignc('l');
-		m2d_vars.alignc(3, 'l');
-		m2d_vars.trimc('c', trim_len);
-		out = out + m2d_vars.str();
 	}
-
-	return out;
 }
 
-//***************************************************************************//
-//**			PRIVATE FUNCTION DEFINITIONS							   **//
-//***************************************************************************//
-
 /*
-Verifies that the proposed variable name is a valid variable name.
+Appends at most 'max_elements' elements from the start of 'v' to 'out',
+followed by ', ...' if some were left out.
+*/
+template<typename T, typename A>
+void append_preview(const std::vector<T, A>& v, size_t max_elements, std::string& out){
 
-Returns true if the name is valid.
+	append_elements(v, 0, std::min(v.size(), max_elements), out);
+	if (v.size() > max_elements) out += (max_elements > 0) ? ", ..." : "...";
+}
+
+/*
+Appends at most 'max_elements' elements from the start of 'm' to 'out', row
+after row, followed by '...' if some were left out.
 */
-bool DDFIO::isValidName(std::string name){
+template<typename T, typename A, typename B>
+void append_preview(const std::vector<std::vector<T, A>, B>& m, size_t max_elements, std::string& out){
 
-	//Ensure name is at least 1 character
-	if (name.length() < 1){
-		return false;
-	}
+	size_t shown = 0;
+	for (size_t r = 0 ; r < m.size() ; r++){
 
-	//Make sure name starts with a letter
-	if (!isalpha(name[0])){
-		return false;
-	}
+		if (shown == max_elements){ //Rows left over
+			out += (r != 0) ? "; ..." : "...";
+			return;
+		}
 
-	//For each character...
-	for (size_t i = 0 ; i < name.length() ; i++){
+		if (r != 0) out += "; ";
+		size_t n = std::min(m[r].size(), max_elements - shown);
+		append_elements(m[r], 0, n, out);
+		shown += n;
 
-		//Check if it is whitespace...
-		if (isspace(name[i]) == 1){
-			return false;
+		if (n < m[r].size()){ //Rest of row left over
+			out += ", ...";
+			return;
 		}
 	}
-
-	return true;
 }
 
 /*
-Checks if the variable name is already in use. Returns true if in use.
+Returns the type character ('d', 'b' or 's') of a variable's value.
 */
-bool DDFIO::nameInUse(std::string name){
+char ddf_type(const DDFValue& v){
+	return (v.index() < DDF_MF) ? "dbs"[v.index() % 3] : 'd';
+}
 
-	//Check flat variables...
-	for (size_t i = 0 ; i < variablesFlat.size() ; i++){
-		if (variablesFlat[i].name == name) return true;
-	}
+/*
+Returns the number of dimensions of a variable's value: 0 for non-matrix
+variables, 1 or 2 for matrices.
+*/
+int ddf_dims(const DDFValue& v){
+	return (v.index() < DDF_MF) ? v.index() / 3 : v.index() - DDF_MF + 1;
+}
 
-	//Check 1D variables...
-	for (size_t i = 0 ; i < variables1D.size() ; i++){
-		if (variables1D[i].name == name) return true;
-	}
+/*
+Returns the bytes used by a value: the DDFValue itself plus any heap memory
+it owns.
+*/
+size_t ddf_payload_bytes(const DDFValue& v){
+	return sizeof(DDFValue) + std::visit([](const auto& x){ return ddf_heap_bytes(x); }, v);
+}
 
-	//Check 2D variables...
-	for (size_t i = 0 ; i < variables2D.size() ; i++){
-		if (variables2D[i].name == name) return true;
-	}
+/*
+Returns a deep copy of 'v' allocated from 'resource'. Copying a DDFValue
+directly would put the copy on the default resource.
+*/
+DDFValue ddf_copy(const DDFValue& v, std::pmr::memory_resource* resource){
 
-	return false;
+	return std::visit([resource](const auto& x) -> DDFValue {
+		typedef typename std::decay<decltype(x)>::type T;
+		if constexpr (std::is_arithmetic<T>::value){
+			return DDFValue(std::in_place_type<T>, x);
+		}else{
+			return DDFValue(std::in_place_type<T>, x, resource);
+		}
+	}, v);
 }
 
 /*
-Sorts the 1D and 2D matrices from largest to smallest.
+Returns the heap memory owned by a value, in bytes. Short strings kept inside
+the std::string object own none.
 */
-void DDFIO::sortMatrices(){
+size_t ddf_heap_bytes(double){
+	return 0;
+}
 
-	//Sort 1D vector
-	for (size_t i = 1 ; i < variables1D.size() ; i++){ //For each matrix (skipping first) ...
+size_t ddf_heap_bytes(float){
+	return 0;
+}
 
-		//Get length
-		size_t el = matrixLength(variables1D[i]);
+size_t ddf_heap_bytes(bool){
+	return 0;
+}
 
-		size_t j = i-1; //Get position to compare against
-		while (el > matrixLength(variables1D[j])){ //Keep checking new indeces until you find a larger or equal size matrix
+template<typename A>
+size_t ddf_heap_bytes(const std::basic_string<char, std::char_traits<char>, A>& s){
 
-			//The current matrix is larger than the previous matrix...
+	const char* p = s.data();
+	if (p >= reinterpret_cast<const char*>(&s) && p < reinterpret_cast<const char*>(&s + 1)){ //Short string optimization
+		return 0;
+	}
 
-			if (j > 0){ //If possible, move compare index closer to 0
-				j--;
-			}else{ //Else break - you're at the beginning
-				break;
-			}
-		}
+	return s.capacity() + 1;
+}
 
-		//Move matrix if required
-		if (j+1 == i){
-			DDF1DItem temp = variables1D[i]; //Make a copy of the current matrix
+template<typename A>
+size_t ddf_heap_bytes(const std::vector<bool, A>& v){
+	return (v.capacity() + 7) / 8; //Packed bits
+}
 
-			variables1D.erase(variables1D.begin() + i); 			//Erase at old location
-			variables1D.insert(variables1D.begin() + j+1, temp);	//Insert into new location
-		}
+template<typename T, typename A>
+size_t ddf_heap_bytes(const std::vector<T, A>& v){
 
+	size_t n = v.capacity() * sizeof(T);
+	for (size_t i = 0 ; i < v.size() ; i++){
+		n += ddf_heap_bytes(v[i]);
 	}
 
-	//Sort 2D vector
-	for (size_t i = 1 ; i < variables2D.size() ; i++){ //For each matrix (skipping first) ...
+	return n;
+}
 
-		//Get length
-		size_t el = matrixLength(variables2D[i]);
+/*
+Releases unused capacity held by a value, including that of any rows or
+strings it contains.
+*/
+void ddf_shrink(double&){
+}
 
-		size_t j = i-1; //Get position to compare against
-		while (el > matrixLength(variables2D[j])){ //Keep checking new indeces until you find a larger or equal size matrix
+void ddf_shrink(float&){
+}
 
-			//The current matrix is larger than the previous matrix...
+void ddf_shrink(bool&){
+}
 
-			if (j > 0){ //If possible, move compare index closer to 0
-				j--;
-			}else{ //Else break - you're at the beginning
-				break;
-			}
-		}
+template<typename A>
+void ddf_shrink(std::basic_string<char, std::char_traits<char>, A>& s){
+	s.shrink_to_fit();
+}
 
-		//Move matrix if required
-		if (j+1 == i){
-			DDF2DItem temp = variables2D[i]; //Make a copy of the current matrix
+template<typename A>
+void ddf_shrink(std::vector<bool, A>& v){
+	v.shrink_to_fit();
+}
 
-			variables2D.erase(variables2D.begin() + i); 			//Erase at old location
-			variables2D.insert(variables2D.begin() + j+1, temp);	//Insert into new location
-		}
+template<typename T, typename A>
+void ddf_shrink(std::vector<T, A>& v){
 
+	for (size_t i = 0 ; i < v.size() ; i++){
+		ddf_shrink(v[i]);
 	}
 
+	v.shrink_to_fit();
 }
 
 /*
-Calculates the total number of elements in the DDFItem and returns it.
+Empties a matrix but keeps its memory. 2D matrices keep their rows, each
+emptied, so they can be refilled without allocating.
 */
-size_t DDFIO::matrixLength(DDF1DItem m){
+template<typename T, typename A>
+void ddf_empty(std::vector<T, A>& v){
+	v.clear();
+}
 
-	switch(m.type){
-		case('d'):
-			return m.md.size();
-			break;
-		case('s'):
-			return m.ms.size();
-			break;
-		case('b'):
-			return m.mb.size();
-			break;
-		default:
-			return 0;
-			break;
+template<typename T, typename A, typename B>
+void ddf_empty(std::vector<std::vector<T, A>, B>& m){
+	for (size_t r = 0 ; r < m.size() ; r++){
+		m[r].clear();
 	}
 }
 
 /*
-Calculates the total number of elements (in all rows and cols, combined) in the
-DDFItem and returns it.
+Sets row 'rows' of 'm' to 'row' and increments 'rows'. Rows already in 'm' are
+overwritten in place, reusing their memory. Resize 'm' to 'rows' once done.
 */
-size_t DDFIO::matrixLength(DDF2DItem m){
-
-	size_t l;
-
-	switch(m.type){
-		case('d'):
+template<typename T, typename A, typename B, typename R>
+void put_row(std::vector<std::vector<T, A>, B>& m, size_t& rows, const R& row){
 
-			l = 0;
-			for (size_t j = 0 ; j < m.md2.size() ; j++){ //For each row...
-				l += m.md2[j].size(); //Get size, increment sum
-			}
+	if (rows < m.size()){
+		m[rows].assign(row.begin(), row.end());
+	}else{
+		m.emplace_back(row.begin(), row.end());
+	}
 
-			return l; //Return sum
+	rows++;
+}
 
-			break;
-		case('s'):
+/*
+Copies 'src' into 'dst', converting between std::vector and std::pmr::vector
+(and std::string and std::pmr::string) as needed. 'dst' keeps its allocator, so
+copying into a payload keeps it on the DDFIO object's memory resource.
+*/
+template<typename T, typename U>
+void ddf_assign(T& dst, const U& src){
+	dst = src;
+}
 
-			l = 0;
-			for (size_t j = 0 ; j < m.ms2.size() ; j++){ //For each row...
-				l += m.ms2[j].size(); //Get size, increment sum
-			}
+template<typename T, typename A, typename U, typename B>
+void ddf_assign(std::vector<T, A>& dst, const std::vector<U, B>& src){
+	dst.assign(src.begin(), src.end());
+}
 
-			return l; //Return sum
+template<typename T, typename A, typename A2, typename U, typename B, typename B2>
+void ddf_assign(std::vector<std::vector<T, A>, A2>& dst, const std::vector<std::vector<U, B>, B2>& src){
 
-			break;
-		case('b'):
+	dst.resize(src.size());
+	for (size_t r = 0 ; r < src.size() ; r++){
+		dst[r].assign(src[r].begin(), src[r].end());
+	}
+}
 
-			l = 0;
-			for (size_t j = 0 ; j < m.mb2.size() ; j++){ //For each row...
-				l += m.mb2[j].size(); //Get size, increment sum
-			}
+/*
+Accepts a string from a DDF inline variable statement and determines if it represents
+a 2D matrix by seeing if a semicolon appears before a closing square bracket.
+*/
+bool is_2d(std::string line){
 
-			return l; //Return sum
+	//Find end brackets, find first semicolon
+	size_t end = line.find("]", 0);
+	size_t first_semi = line.find(";", 0);
 
-			break;
-		default:
-			return 0;
-			break;
+	//Not 2D matrix if no brackets or no semicolon
+	if (first_semi == std::string::npos || end == std::string::npos){
+		return false;
 	}
 
+	return (first_semi < end);
 }
 
 /*
-Finds the 'idx'th variable in m, acting as if each lower row is appended to the
-end of the preceeding row. Makes 2D vector look 1D in terms of indexing.
-
-Returns 'idx'-th value in 'm'. Returns -1 if idx out of range.
+Splits 'n' characters of 'line' into tokens separated by spaces and tabs. Each
+character in 'keep' is returned as a token of its own. If 'preserve_strings' is
+true, whitespace inside double quotes doesn't split tokens. Tokens point into
+'line' - nothing is copied. 'out' is cleared first and reused to avoid
+allocation.
 */
-double DDFIO::linaccess(std::vector<std::vector<double> > m, size_t idx){
+void tokenize_line(const char* line, size_t n, const char* keep, std::vector<DDFToken>& out, bool preserve_strings){
 
-	size_t count = 0;
+	out.clear();
 
-	for (size_t r = 0 ; r < m.size() ; r++){
-		if (m[r].size() + count > idx){
-			return m[r][idx - count];
+	DDFToken tok;
+	tok.p = NULL;
+	tok.len = 0;
+	tok.idx = 0;
+	bool in_string = false;
+
+	for (size_t i = 0 ; i < n ; i++){
+
+		char c = line[i];
+
+		if (preserve_strings && c == '"' && !is_escaped(line, i, 0)) in_string = !in_string;
+
+		if (!in_string && (c == ' ' || c == '\t')){ //Delimiter
+			if (tok.len > 0) out.push_back(tok);
+			tok.len = 0;
+		}else if (!in_string && c != '\0' && strchr(keep, c) != NULL){ //Kept character
+			if (tok.len > 0) out.push_back(tok);
+			tok.p = line + i;
+			tok.len = 1;
+			tok.idx = i;
+			out.push_back(tok);
+			tok.len = 0;
 		}else{
-			count += m[r].size();
+			if (tok.len == 0){
+				tok.p = line + i;
+				tok.idx = i;
+			}
+			tok.len++;
 		}
 	}
 
-	return -1; //Default return if out of bounds
+	if (tok.len > 0) out.push_back(tok);
 }
 
 /*
-Finds the 'idx'th variable in m, acting as if each lower row is appended to the
-end of the preceeding row. Makes 2D vector look 1D in terms of indexing.
+Returns true if the token's text is exactly 's'.
+*/
+bool token_is(const DDFToken& t, const char* s){
+	return (strlen(s) == t.len && memcmp(t.p, s, t.len) == 0);
+}
 
-Returns 'idx'-th value in 'm'. Returns false if idx out of range.
+/*
+Returns true if 'n' characters starting at 's' begin with a number that
+std::stod would accept (leading whitespace, sign, decimal or hex digits, an
+exponent, or inf/nan). Like std::stod, trailing characters are ignored.
 */
-bool DDFIO::linaccess(std::vector<std::vector<bool> > m, size_t idx){
+bool is_number_prefix(const char* s, size_t n){
 
-	size_t count = 0;
+	size_t i = 0;
+	while (i < n && isspace(static_cast<unsigned char>(s[i]))) i++;
+	if (i < n && (s[i] == '+' || s[i] == '-')) i++;
 
-	for (size_t r = 0 ; r < m.size() ; r++){
-		if (m[r].size() + count > idx){
-			return m[r][idx - count];
-		}else{
-			count += m[r].size();
+	//inf, infinity, nan
+	if (i < n && (s[i] == 'i' || s[i] == 'I' || s[i] == 'n' || s[i] == 'N')){
+		const char* word = (s[i] == 'i' || s[i] == 'I') ? "inf" : "nan";
+		for (size_t k = 0 ; k < 3 ; k++){
+			if (i+k >= n || tolower(static_cast<unsigned char>(s[i+k])) != word[k]) return false;
+		}
+		return true;
+	}
+
+	//Hex prefix
+	bool hex = false;
+	if (i+1 < n && s[i] == '0' && (s[i+1] == 'x' || s[i+1] == 'X')){
+		hex = true;
+		i += 2;
+	}
+
+	//Mantissa needs at least one digit
+	size_t digits = 0;
+	while (i < n && (hex ? isxdigit(static_cast<unsigned char>(s[i])) : isdigit(static_cast<unsigned char>(s[i])))){
+		i++;
+		digits++;
+	}
+	if (i < n && s[i] == '.'){
+		i++;
+		while (i < n && (hex ? isxdigit(static_cast<unsigned char>(s[i])) : isdigit(static_cast<unsigned char>(s[i])))){
+			i++;
+			digits++;
 		}
 	}
 
-	return ""; //Default false if out of bounds
+	//'0x' with no digits still reads as 0
+	return (digits > 0 || hex);
+}
+
+/*
+Returns true if 'n' characters starting at 's' (ignoring surrounding
+whitespace) spell 'true' or 'false', case-insensitive.
+*/
+bool is_bool_word(const char* s, size_t n){
+
+	while (n > 0 && isspace(static_cast<unsigned char>(*s))){
+		s++;
+		n--;
+	}
+	while (n > 0 && isspace(static_cast<unsigned char>(s[n-1]))) n--;
+
+	const char* word;
+	if (n == 4){
+		word = "true";
+	}else if (n == 5){
+		word = "false";
+	}else{
+		return false;
+	}
+
+	for (size_t i = 0 ; i < n ; i++){
+		if (tolower(static_cast<unsigned char>(s[i])) != word[i]) return false;
+	}
+
+	return true;
 }
 
 /*
-Finds the 'idx'th variable in m, acting as if each lower row is appended to the
-end of the preceeding row. Makes 2D vector look 1D in terms of indexing.
+Returns true if 'n' characters starting at 's' contain a double-quoted string.
+*/
+bool is_string_literal(const char* s, size_t n){
+	size_t q1, q2;
+	return find_string_literal(s, n, 0, q1, q2);
+}
 
-Returns 'idx'-th value in 'm'. Returns blank if idx out of range.
+/*
+Returns true if the character at offset 'i' of 's' is escaped, ie. preceded by
+an odd number of backslashes (counting back no further than offset 'from').
 */
-std::string DDFIO::linaccess(std::vector<std::vector<std::string> > m, size_t idx){
+bool is_escaped(const char* s, size_t i, size_t from){
 
-	size_t count = 0;
+	size_t run = 0;
+	while (i > from + run && s[i-1-run] == '\\') run++;
 
-	for (size_t r = 0 ; r < m.size() ; r++){
-		if (m[r].size() + count > idx){
-			return m[r][idx - count];
+	return (run % 2 == 1);
+}
+
+/*
+Finds the first string literal at or after offset 'from' of the 'n' characters
+at 's', saving the offsets of its opening and closing quotes in 'q1' and 'q2'.
+Quotes escaped with a backslash (\") don't open or close a literal. Returns
+false if there is no complete literal.
+*/
+bool find_string_literal(const char* s, size_t n, size_t from, size_t& q1, size_t& q2){
+
+	q1 = from;
+	while (q1 < n && (s[q1] != '"' || is_escaped(s, q1, from))) q1++;
+	if (q1 >= n) return false;
+
+	q2 = q1 + 1;
+	while (q2 < n && (s[q2] != '"' || is_escaped(s, q2, q1+1))) q2++;
+
+	return (q2 < n);
+}
+
+/*
+Saves the 'n' characters at 's' - the text between the quotes of a string
+literal - in 'out' with escapes removed. Backslashes are only special before a
+quote or at the end of the text: there each pair stands for one backslash, and
+an odd one out escapes the quote. Other backslashes are kept as written.
+*/
+template<typename S>
+void unescape_string(const char* s, size_t n, S& out){
+
+	out.clear();
+	out.reserve(n);
+
+	size_t i = 0;
+	while (i < n){
+
+		if (s[i] != '\\'){
+			out.push_back(s[i]);
+			i++;
+			continue;
+		}
+
+		size_t run = 0;
+		while (i + run < n && s[i+run] == '\\') run++;
+
+		if (i + run < n && s[i+run] != '"'){ //Ordinary backslashes
+			out.append(s + i, run);
+			i += run;
+			continue;
+		}
+
+		out.append(run/2, '\\');
+		i += run;
+		if (run % 2 == 1 && i < n){ //Escaped quote
+			out.push_back('"');
+			i++;
+		}
+	}
+}
+
+/*
+Returns the string 'n' characters at 's' as a DDF string literal, quotes
+included. Quotes are escaped, and backslashes before a quote or at the end are
+doubled, so that unescape_string() gives back the same text.
+*/
+std::string escape_string(const char* s, size_t n){
+
+	std::string out;
+	out.reserve(n + 2);
+	out += '"';
+
+	size_t i = 0;
+	while (i < n){
+
+		size_t run = 0;
+		while (i + run < n && s[i+run] == '\\') run++;
+
+		if (i + run == n || s[i+run] == '"'){ //Run (possibly empty) before a quote or the end
+			out.append(2*run, '\\');
+			if (i + run < n) out += "\\\"";
+			i += run + 1;
 		}else{
-			count += m[r].size();
+			out.append(s + i, run + 1);
+			i += run + 1;
 		}
 	}
 
-	return ""; //Default return if out of bounds
+	out += '"';
+	return out;
 }
 
 /*
-Treats a 2D matrix as 1D, pretending each row is appended to the preceeding row.
-Returns true if the element at index 'idx' is actually the end of a row in the
-real 2D matrix.
+Returns true if the body of the inline matrix in 's', described by its
+structural index 'idx' (see simd_scan_structure), is a valid list of elements
+of 'type'. Walks the elements as index_to_vec/index_to_vec2D do - empty
+elements are skipped and the rest must convert - so it accepts exactly what
+DDFIO::load() accepts, without storing anything.
+*/
+bool is_matrix_body(const char* s, const DDFStructIndex& idx, char type){
+
+	return simd_for_each_element(s, idx, [&](size_t first, size_t last, bool) -> bool {
+		if (first == last) return true;
+		const char* e = s + first;
+		size_t len = last - first;
+		if (type == 'd'){ //As element_to_double - the element always ends at a separator, so strtod stops in time
+			char* end;
+			errno = 0;
+			strtod(e, &end);
+			return (end != e && end <= s + last && errno != ERANGE);
+		}
+		return (type == 'b') ? is_bool_word(e, len) : is_string_literal(e, len);
+	});
+}
 
-Also returns false if idx is out of bounds, or if any other error occurs.
+/*
+Returns true if the 'n' characters starting at 's' are a valid variable name.
+Same rules as DDFIO::isValidName.
 */
-bool DDFIO::isRowEnd(DDF2DItem m, size_t idx){
+bool is_valid_name(const char* s, size_t n){
 
-	size_t count = 0;
+	if (n < 1 || !isalpha(static_cast<unsigned char>(s[0]))) return false;
 
-	switch(m.type){
-		case('d'):
-			for (size_t r = 0 ; r < m.md2.size() ; r++){
-				if (m.md2[r].size() + count > idx){
-					return (idx == (count + m.md2[r].size()-1));
-				}else{
-					count += m.md2[r].size();
-				}
-			}
-			break;
-		case('b'):
-			for (size_t r = 0 ; r < m.mb2.size() ; r++){
-				if (m.mb2[r].size() + count > idx){
-					return (idx == (count + m.mb2[r].size()-1));
-				}else{
-					count += m.mb2[r].size();
-				}
-			}
-			break;
-		case('s'):
-			for (size_t r = 0 ; r < m.ms2.size() ; r++){
-				if (m.ms2[r].size() + count > idx){
-					return (idx == (count + m.ms2[r].size()-1));
-				}else{
-					count += m.ms2[r].size();
-				}
-			}
-			break;
-		default:
-			return false;
+	for (size_t i = 0 ; i < n ; i++){
+		if (isspace(static_cast<unsigned char>(s[i]))) return false;
 	}
 
-	return false; //Default return if out of bounds
+	return true;
+}
+
+/*
+Converts the element text [first, last) of 'line' to a double, the same way
+std::stod would (leading whitespace skipped, trailing characters ignored).
+Returns false instead of throwing if it isn't a number or is out of range.
+*/
+bool element_to_double(const std::string& line, size_t first, size_t last, double& out){
+
+	const char* start = line.c_str() + first;
+	char* end;
 
+	errno = 0;
+	out = strtod(start, &end);
+
+	return (end != start && end <= line.c_str() + last && errno != ERANGE);
 }
 
 /*
-Initializes the KTable for use in generating vertical DDF matrix statements.
+Converts the element text [first, last) of 'line' to a bool ('true' or
+'false', case-insensitive). Returns false if it is neither.
 */
-void DDFIO::init_ktable(KTable& kt){
+bool element_to_bool(const std::string& line, size_t first, size_t last, bool& out){
 
-	kt.table_title("");
-	kt.set(KTABLE_INTERWALLS, false);
-	kt.set(KTABLE_SIDEWALLS, false);
-	kt.set(KTABLE_TOPBOTTOMHBAR, false);
-	kt.set(KTABLE_HEADERINTERWALLS, false);
-	kt.set(KTABLE_HEADERHBAR, false);
-	kt.set(KTABLE_TITLEHBAR, false);
-	// kt.set(KTABLE_TITLEBAR, false); //TODO: KTable bug - if I turn title off, can't surpress preceeding ----s and on same line :\
-	// kt.set(KTABLE_INTERHBARS, false);
-	kt.alignh('l');
-	kt.alignc('l');
-	kt.alignt('l');
+	if (!is_bool_word(line.c_str() + first, last - first)) return false;
+
+	while (isspace(static_cast<unsigned char>(line[first]))) first++;
+	out = (tolower(static_cast<unsigned char>(line[first])) == 't');
 
+	return true;
 }
 
-//***************************************************************************//
-//**			NON-CLASS FUNCTION DEFINITIONS							   **//
-//***************************************************************************//
+/*
+Extracts the first string literal in the element text [first, last) of 'line',
+with escapes removed (see unescape_string). Returns false if there isn't one.
+*/
+template<typename S>
+bool element_to_string(const std::string& line, size_t first, size_t last, S& out){
 
+	size_t q1, q2;
+	if (!find_string_literal(line.c_str(), last, first, q1, q2)) return false;
 
+	unescape_string(line.c_str() + q1 + 1, q2 - q1 - 1, out);
 
-std::string bool_to_string(bool b){
-	return b? "true" : "false";
+	return true;
 }
 
 /*
-Accepts a string from a DDF inline variable statement and determines if it represents
-a 2D matrix by seeing if a semicolon appears before a closing square bracket.
+Parses the body of a 1D inline matrix from its structural index (see
+simd_scan_structure) directly into 'out'. The element count is known from the
+index, so 'out' is reserved once. 'convert' is one of the element_to_...
+functions. Returns false if any element fails to convert.
+
+Accepts the same text as the gstd::to_?vec functions used for short lines:
+empty elements (eg. in "[1,,2]" or "[]") are skipped, while elements of only
+whitespace fail to convert.
 */
-bool is_2d(std::string line){
+template<typename T, typename A, typename C>
+bool index_to_vec(const std::string& line, const DDFStructIndex& idx, C convert, std::vector<T, A>& out){
+
+	out.clear();
+	out.reserve(idx.commas + idx.semis + 1);
+
+	T val;
+	return simd_for_each_element(line.c_str(), idx, [&](size_t first, size_t last, bool) -> bool {
+		if (first == last) return true;
+		if (!convert(line, first, last, val)) return false;
+		out.push_back(val);
+		return true;
+	});
+}
 
-	//Find end brackets, find first semicolon
-	size_t end = line.find("]", 0);
-	size_t first_semi = line.find(";", 0);
+/*
+Parses the body of a 2D inline matrix from its structural index directly into
+'out', replacing its contents. Row lengths are counted from the index first, so
+each row is reserved once. Returns false if any element fails to convert.
 
-	//Not 2D matrix if no brackets or no semicolon
-	if (first_semi == std::string::npos || end == std::string::npos){
-		return false;
+As with gstd::to_?vec2D, empty rows (eg. in "[1;;2]" or "[1, 2;]") are dropped
+and empty elements skipped, so a row like "," becomes an empty row.
+*/
+template<typename T, typename A, typename B, typename C>
+bool index_to_vec2D(const std::string& line, const DDFStructIndex& idx, C convert, std::vector<std::vector<T, A>, B>& out){
+
+	//Count elements per row - only reads the index
+	std::vector<size_t> row_len;
+	row_len.reserve(idx.semis + 1);
+	size_t count = 0;
+	size_t row_start = idx.open + 1;
+	simd_for_each_element(line.c_str(), idx, [&](size_t first, size_t last, bool row_end) -> bool {
+		if (first != last) count++;
+		if (row_end){
+			if (last != row_start) row_len.push_back(count);
+			count = 0;
+			row_start = last + 1;
+		}
+		return true;
+	});
+
+	out.resize(row_len.size()); //Existing rows keep their buffers (see DDFIO::reuse)
+	for (size_t r = 0 ; r < row_len.size() ; r++){
+		out[r].clear();
+		out[r].reserve(row_len[r]);
 	}
 
-	return (first_semi < end);
+	T val;
+	size_t r = 0;
+	row_start = idx.open + 1;
+	return simd_for_each_element(line.c_str(), idx, [&](size_t first, size_t last, bool row_end) -> bool {
+		if (first != last){
+			if (!convert(line, first, last, val)) return false;
+			out[r].push_back(val);
+		}
+		if (row_end){
+			if (last != row_start) r++;
+			row_start = last + 1;
+		}
+		return true;
+	});
 }
 
 #endif
@@ -0,0 +1,589 @@
+#include "cppddf.hpp"
+#include "cppddf_c.h"
+
+/*
+Implementation of the C interface in cppddf_c.h. Each handle owns a DDFIO
+object plus the strings handed back to the caller, so their pointers stay
+valid after the call returns.
+*/
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+struct CDDF{
+	DDFIO io;
+	std::string text;		//Output of the last cddf_swrite()
+	std::string header;		//Copy returned by cddf_header()
+	std::string err_str;	//Message returned by cddf_err()
+};
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Saves the exception being handled in the error string of 'h'. Call from a
+catch(...) block - no exception may cross the C interface.
+*/
+static void cddf_catch(CDDF* h){
+
+	try{
+		throw;
+	}catch(const std::exception& e){
+		try{
+			h->err_str = std::string("Unexpected error: ") + e.what();
+		}catch(...){
+			h->err_str.clear();
+		}
+	}catch(...){
+		try{
+			h->err_str = "Unexpected error.";
+		}catch(...){
+			h->err_str.clear();
+		}
+	}
+}
+
+/*
+Looks up variable 'index' of 'h' and returns its payload, or NULL (setting the
+error string) if there is no such variable.
+*/
+static const DDFValue* cddf_value(CDDF* h, size_t index){
+
+	DDFVarInfo v;
+	if (!h->io.info(index, v)){
+		h->err_str = "Variable index " + std::to_string(index) + " out of range.";
+		return NULL;
+	}
+
+	return v.value;
+}
+
+/*
+Adds 'value' as variable 'name'. Returns 0 if the name is invalid or taken.
+*/
+template<typename T>
+static int cddf_add(CDDF* h, const char* name, const char* desc, const T& value){
+
+	std::string n = (name != NULL) ? name : "";
+	if (h->io.contains(n)){
+		h->err_str = "Variable '" + n + "' already exists.";
+		return 0;
+	}
+
+	h->io.add(value, n, (desc != NULL) ? desc : "");
+	if (!h->io.contains(n)){
+		h->err_str = "Invalid variable name '" + n + "'.";
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+Adds 'rows' x 'cols' elements from 'data' (row-major) as variable 'name', or
+a 1D matrix of 'cols' elements if 'rows' is zero. 'convert' turns one element
+of 'data' into the stored type.
+*/
+template<typename T, typename S, typename C>
+static int cddf_add_matrix(CDDF* h, const char* name, const char* desc, const S* data, size_t rows, size_t cols, C convert){
+
+	size_t n = (rows == 0) ? cols : rows*cols;
+	if (data == NULL && n > 0){
+		h->err_str = "No data given for variable.";
+		return 0;
+	}
+
+	if (rows == 0){
+		std::vector<T> m(cols);
+		for (size_t k = 0 ; k < cols ; k++){
+			m[k] = convert(data[k]);
+		}
+		return cddf_add(h, name, desc, m);
+	}
+
+	std::vector<std::vector<T> > m(rows, std::vector<T>(cols));
+	for (size_t r = 0 ; r < rows ; r++){
+		for (size_t k = 0 ; k < cols ; k++){
+			m[r][k] = convert(data[r*cols + k]);
+		}
+	}
+	return cddf_add(h, name, desc, m);
+}
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** HANDLES
+
+/*
+Creates an empty handle. Free it with cddf_destroy(). Returns NULL if out of
+memory.
+*/
+CDDF* cddf_create(void){
+
+	try{
+		return new CDDF;
+	}catch(...){
+		return NULL;
+	}
+}
+
+void cddf_destroy(CDDF* h){
+	delete h;
+}
+
+//***************************************************************************//
+//***************** FILE I/O
+
+/*
+Reads a DDF file into 'h'. Options are as for DDFIO::load.
+*/
+int cddf_load(CDDF* h, const char* fileIn, const char* options){
+
+	try{
+		h->err_str = "";
+		h->io.clear(); //Replace, don't append to, what was loaded before
+		if (!h->io.load(fileIn, (options != NULL) ? options : "")){
+			h->err_str = h->io.err();
+			if (h->err_str.length() == 0) h->err_str = "Failed to open or identify file '" + std::string(fileIn) + "'.";
+			return 0;
+		}
+
+		return 1;
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+/*
+Reads 'len' bytes of DDF text from 'data' into 'h'.
+*/
+int cddf_load_string(CDDF* h, const char* data, size_t len, const char* options){
+
+	try{
+		h->err_str = "";
+		h->io.clear();
+		if (!h->io.sload(std::string_view(data, len), (options != NULL) ? options : "")){
+			h->err_str = h->io.err();
+			if (h->err_str.length() == 0) h->err_str = "Failed to identify DDF data.";
+			return 0;
+		}
+
+		return 1;
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+/*
+Writes 'h' to a DDF file. Options are as for DDFIO::swrite.
+*/
+int cddf_write(CDDF* h, const char* fileOut, const char* options){
+
+	try{
+		h->err_str = "";
+		if (!h->io.write(fileOut, (options != NULL) ? options : "")){
+			h->err_str = "Failed to write file '" + std::string(fileOut) + "'.";
+			return 0;
+		}
+
+		return 1;
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+/*
+Returns 'h' as DDF text, and its length in 'len' (if not NULL). The text
+belongs to the handle and is replaced by the next call.
+*/
+const char* cddf_swrite(CDDF* h, const char* options, size_t* len){
+
+	try{
+		h->text = h->io.swrite("", (options != NULL) ? options : "");
+		if (len != NULL) *len = h->text.length();
+
+		return h->text.c_str();
+	}catch(...){
+		cddf_catch(h);
+		return NULL;
+	}
+}
+
+//***************************************************************************//
+//***************** STATUS
+
+/*
+Returns the error from the last failed call, or a blank string.
+*/
+const char* cddf_err(CDDF* h){
+	return h->err_str.c_str();
+}
+
+const char* cddf_header(CDDF* h){
+
+	try{
+		h->header = h->io.getHeader();
+		return h->header.c_str();
+	}catch(...){
+		cddf_catch(h);
+		return NULL;
+	}
+}
+
+double cddf_version(CDDF* h){
+
+	try{
+		return h->io.getVersion();
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+//***************************************************************************//
+//***************** VARIABLES
+
+void cddf_clear(CDDF* h){
+
+	try{
+		h->io.clear();
+	}catch(...){
+		cddf_catch(h);
+	}
+}
+
+size_t cddf_num_vars(CDDF* h){
+
+	try{
+		return h->io.numVar();
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+/*
+Returns the index of variable 'name', or CDDF_NPOS if there is none.
+*/
+size_t cddf_find(CDDF* h, const char* name){
+
+	try{
+		DDFVarInfo v;
+		if (name == NULL || !h->io.info(std::string(name), v)) return CDDF_NPOS;
+
+		return v.index;
+	}catch(...){
+		cddf_catch(h);
+		return CDDF_NPOS;
+	}
+}
+
+/*
+Describes variable 'index' in 'out'.
+*/
+int cddf_info(CDDF* h, size_t index, cddf_var* out){
+
+	try{
+		DDFVarInfo v;
+		if (!h->io.info(index, v)){
+			h->err_str = "Variable index " + std::to_string(index) + " out of range.";
+			return 0;
+		}
+
+		out->name = v.name.data();
+		out->name_len = v.name.length();
+		out->description = v.description.data();
+		out->description_len = v.description.length();
+		out->type = v.type;
+		out->dims = v.dims;
+		out->single = v.single;
+		out->rows = v.rows;
+		out->cols = v.cols;
+		out->elements = v.elements;
+
+		return 1;
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+/*
+Returns the number of elements in row 'row' of 2D matrix 'index', or of
+1D matrix 'index' if 'row' is 0. Returns 0 if there is no such row.
+*/
+size_t cddf_row_length(CDDF* h, size_t index, size_t row){
+
+	try{
+		DDFVarInfo v;
+		if (!h->io.info(index, v) || v.dims == 0) return 0;
+		if (v.dims == 1) return (row == 0) ? v.elements : 0;
+		if (row >= v.rows) return 0;
+
+		switch(v.value->index()){
+			case(DDF_MD2):
+				return std::get<DDF_MD2>(*v.value)[row].size();
+			case(DDF_MB2):
+				return std::get<DDF_MB2>(*v.value)[row].size();
+			case(DDF_MS2):
+				return std::get<DDF_MS2>(*v.value)[row].size();
+			case(DDF_MF2):
+				return std::get<DDF_MF2>(*v.value)[row].size();
+			default:
+				return 0;
+		}
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+//***************************************************************************//
+//***************** READ VALUES
+
+/*
+Reads the d variable 'index'.
+*/
+int cddf_get_double(CDDF* h, size_t index, double* out){
+
+	try{
+		const DDFValue* val = cddf_value(h, index);
+		if (val == NULL) return 0;
+
+		if (const double* d = std::get_if<DDF_D>(val)){
+			*out = *d;
+			return 1;
+		}
+
+		h->err_str = "Variable is not of type d.";
+		return 0;
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+/*
+Reads the b variable 'index' (1 for true, 0 for false).
+*/
+int cddf_get_bool(CDDF* h, size_t index, int* out){
+
+	try{
+		const DDFValue* val = cddf_value(h, index);
+		if (val == NULL) return 0;
+
+		if (const bool* b = std::get_if<DDF_B>(val)){
+			*out = *b ? 1 : 0;
+			return 1;
+		}
+
+		h->err_str = "Variable is not of type b.";
+		return 0;
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+/*
+Returns a string from variable 'index': the value of an s variable, element
+'col' of a 1D m<s> matrix, or element ['row']['col'] of a 2D one. Unused
+indices are ignored. Returns NULL if there is no such element.
+*/
+const char* cddf_get_string(CDDF* h, size_t index, size_t row, size_t col, size_t* len){
+
+	try{
+		const DDFValue* val = cddf_value(h, index);
+		if (val == NULL) return NULL;
+
+		const std::pmr::string* s = NULL;
+		if (const std::pmr::string* x = std::get_if<DDF_S>(val)){
+			s = x;
+		}else if (const std::pmr::vector<std::pmr::string>* ms = std::get_if<DDF_MS>(val)){
+			if (col < ms->size()) s = &(*ms)[col];
+		}else if (const std::pmr::vector<std::pmr::vector<std::pmr::string> >* ms2 = std::get_if<DDF_MS2>(val)){
+			if (row < ms2->size() && col < (*ms2)[row].size()) s = &(*ms2)[row][col];
+		}
+
+		if (s == NULL){
+			h->err_str = "No such string element.";
+			return NULL;
+		}
+
+		if (len != NULL) *len = s->length();
+		return s->c_str();
+	}catch(...){
+		cddf_catch(h);
+		return NULL;
+	}
+}
+
+/*
+Returns a pointer to the doubles of a 1D m<d> matrix ('row' = 0) or of one row
+of a 2D m<d> matrix, without copying, and their number in 'len'. Returns NULL
+if the variable isn't stored as doubles (see cddf_floats()).
+*/
+const double* cddf_doubles(CDDF* h, size_t index, size_t row, size_t* len){
+
+	try{
+		const DDFValue* val = cddf_value(h, index);
+		if (val == NULL) return NULL;
+
+		const std::pmr::vector<double>* v = NULL;
+		if (const std::pmr::vector<double>* md = std::get_if<DDF_MD>(val)){
+			if (row == 0) v = md;
+		}else if (const std::pmr::vector<std::pmr::vector<double> >* md2 = std::get_if<DDF_MD2>(val)){
+			if (row < md2->size()) v = &(*md2)[row];
+		}
+
+		if (v == NULL){
+			h->err_str = "No such row of doubles.";
+			return NULL;
+		}
+
+		*len = v->size();
+		return v->data();
+	}catch(...){
+		cddf_catch(h);
+		return NULL;
+	}
+}
+
+/*
+As cddf_doubles(), for m<d> matrices stored as floats.
+*/
+const float* cddf_floats(CDDF* h, size_t index, size_t row, size_t* len){
+
+	try{
+		const DDFValue* val = cddf_value(h, index);
+		if (val == NULL) return NULL;
+
+		const std::pmr::vector<float>* v = NULL;
+		if (const std::pmr::vector<float>* mf = std::get_if<DDF_MF>(val)){
+			if (row == 0) v = mf;
+		}else if (const std::pmr::vector<std::pmr::vector<float> >* mf2 = std::get_if<DDF_MF2>(val)){
+			if (row < mf2->size()) v = &(*mf2)[row];
+		}
+
+		if (v == NULL){
+			h->err_str = "No such row of floats.";
+			return NULL;
+		}
+
+		*len = v->size();
+		return v->data();
+	}catch(...){
+		cddf_catch(h);
+		return NULL;
+	}
+}
+
+/*
+Copies up to 'n' elements of a 1D m<b> matrix ('row' = 0) or one row of a 2D
+m<b> matrix into 'out' as 1s and 0s. m<b> data is bit-packed, so unlike
+cddf_doubles() this has to copy. Returns the number of elements in the row
+(call with 'n' = 0 to size the buffer), or 0 on error.
+*/
+size_t cddf_get_bools(CDDF* h, size_t index, size_t row, unsigned char* out, size_t n){
+
+	try{
+		const DDFValue* val = cddf_value(h, index);
+		if (val == NULL) return 0;
+
+		const std::pmr::vector<bool>* v = NULL;
+		if (const std::pmr::vector<bool>* mb = std::get_if<DDF_MB>(val)){
+			if (row == 0) v = mb;
+		}else if (const std::pmr::vector<std::pmr::vector<bool> >* mb2 = std::get_if<DDF_MB2>(val)){
+			if (row < mb2->size()) v = &(*mb2)[row];
+		}
+
+		if (v == NULL){
+			h->err_str = "No such row of bools.";
+			return 0;
+		}
+
+		for (size_t k = 0 ; k < v->size() && k < n ; k++){
+			out[k] = (*v)[k] ? 1 : 0;
+		}
+
+		return v->size();
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+//***************************************************************************//
+//***************** ADD VARIABLES
+
+int cddf_add_double(CDDF* h, const char* name, const char* desc, double x){
+
+	try{
+		return cddf_add(h, name, desc, x);
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+int cddf_add_bool(CDDF* h, const char* name, const char* desc, int x){
+
+	try{
+		return cddf_add(h, name, desc, (x != 0));
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+int cddf_add_string(CDDF* h, const char* name, const char* desc, const char* x){
+
+	try{
+		return cddf_add(h, name, desc, std::string((x != NULL) ? x : ""));
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+/*
+Adds a matrix from 'rows' x 'cols' row-major elements, or a 1D matrix of 'cols'
+elements if 'rows' is zero.
+*/
+int cddf_add_doubles(CDDF* h, const char* name, const char* desc, const double* data, size_t rows, size_t cols){
+
+	try{
+		return cddf_add_matrix<double>(h, name, desc, data, rows, cols, [](double x){ return x; });
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+int cddf_add_bools(CDDF* h, const char* name, const char* desc, const unsigned char* data, size_t rows, size_t cols){
+
+	try{
+		return cddf_add_matrix<bool>(h, name, desc, data, rows, cols, [](unsigned char x){ return (x != 0); });
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
+
+int cddf_add_strings(CDDF* h, const char* name, const char* desc, const char* const* data, size_t rows, size_t cols){
+
+	try{
+		return cddf_add_matrix<std::string>(h, name, desc, data, rows, cols, [](const char* x){ return std::string((x != NULL) ? x : ""); });
+	}catch(...){
+		cddf_catch(h);
+		return 0;
+	}
+}
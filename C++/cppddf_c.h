@@ -0,0 +1,106 @@
+#ifndef CPPDDF_C_H
+#define CPPDDF_C_H
+
+#include <stddef.h>
+
+/*
+C interface to the C++ DDF reader and writer, built as the shared library
+libcppddf (see 'make libcppddf'). It lets other languages (eg. Python through
+ctypes) use the C++ parser.
+
+Functions returning int return 1 on success and 0 on failure; the reason is
+available from cddf_err(). No C++ exception leaves the library: an unexpected
+one (eg. out of memory) fails the call the same way, with functions returning
+pointers giving NULL. Variables are addressed by their position in the file
+(0 to cddf_num_vars()-1), which cddf_find() looks up by name. cddf_load() and
+cddf_load_string() replace the handle's variables rather than add to them.
+
+Pointers returned into a handle's data stay valid until the handle is next
+modified (load, add, clear) or destroyed. Strings returned by the library are
+null-terminated, but may also contain null characters, so their lengths are
+given separately where it matters.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+typedef struct CDDF CDDF;
+
+#define CDDF_NPOS ((size_t)-1)
+
+/*
+Describes one variable. See DDFVarInfo.
+*/
+typedef struct{
+	const char* name;
+	size_t name_len;
+	const char* description;
+	size_t description_len;
+	char type;			//'d', 'b' or 's'
+	int dims;			//0 for non-matrix variables, else 1 or 2
+	int single;			//m<d> stored as float
+	size_t rows;
+	size_t cols;		//Longest row for ragged 2D matrices
+	size_t elements;
+}cddf_var;
+
+//***************************************************************************//
+//**			FUNCTION DECLARATIONS									   **//
+//***************************************************************************//
+
+//************ HANDLES
+
+CDDF* cddf_create(void);
+void cddf_destroy(CDDF* h);
+
+//************ FILE I/O
+
+int cddf_load(CDDF* h, const char* fileIn, const char* options);
+int cddf_load_string(CDDF* h, const char* data, size_t len, const char* options);
+int cddf_write(CDDF* h, const char* fileOut, const char* options);
+const char* cddf_swrite(CDDF* h, const char* options, size_t* len);
+
+//************ STATUS
+
+const char* cddf_err(CDDF* h);
+const char* cddf_header(CDDF* h);
+double cddf_version(CDDF* h);
+
+//************ VARIABLES
+
+void cddf_clear(CDDF* h);
+size_t cddf_num_vars(CDDF* h);
+size_t cddf_find(CDDF* h, const char* name);
+int cddf_info(CDDF* h, size_t index, cddf_var* out);
+size_t cddf_row_length(CDDF* h, size_t index, size_t row);
+
+//************ READ VALUES
+
+int cddf_get_double(CDDF* h, size_t index, double* out);
+int cddf_get_bool(CDDF* h, size_t index, int* out);
+const char* cddf_get_string(CDDF* h, size_t index, size_t row, size_t col, size_t* len);
+
+const double* cddf_doubles(CDDF* h, size_t index, size_t row, size_t* len);
+const float* cddf_floats(CDDF* h, size_t index, size_t row, size_t* len);
+size_t cddf_get_bools(CDDF* h, size_t index, size_t row, unsigned char* out, size_t n);
+
+//************ ADD VARIABLES
+
+int cddf_add_double(CDDF* h, const char* name, const char* desc, double x);
+int cddf_add_bool(CDDF* h, const char* name, const char* desc, int x);
+int cddf_add_string(CDDF* h, const char* name, const char* desc, const char* x);
+
+int cddf_add_doubles(CDDF* h, const char* name, const char* desc, const double* data, size_t rows, size_t cols);
+int cddf_add_bools(CDDF* h, const char* name, const char* desc, const unsigned char* data, size_t rows, size_t cols);
+int cddf_add_strings(CDDF* h, const char* name, const char* desc, const char* const* data, size_t rows, size_t cols);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
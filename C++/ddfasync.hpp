@@ -0,0 +1,406 @@
+#ifndef DDFASYNC_HPP
+#define DDFASYNC_HPP
+
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include "cppddf.hpp"
+#include "ddfpool.hpp"
+#include "ddfbatch.hpp"
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+	#if __has_include(<coroutine>)
+		#include <coroutine>
+		#define DDF_HAS_COROUTINES
+	#endif
+#endif
+
+/*
+Asynchronous load and write. Each call runs the file I/O and the parsing or
+formatting on a thread pool and hands back a std::future<DDFResult>. The loaded
+object only exists inside the result, and a written object is moved into the
+job and handed back in the result, so no DDFIO can be touched by the caller
+while a job is using it.
+
+With C++20 coroutines, awaitLoad()/awaitWrite() return awaitables that can be
+co_await'ed instead.
+*/
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+/*
+Called with the number of bytes processed so far and the total number of bytes
+(0 if unknown). Called from the worker thread.
+*/
+typedef std::function<void(size_t, size_t)> DDFProgressFn;
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+/*
+Shared flag used to cancel an asynchronous operation. Copies refer to the same
+flag, so keep one copy and pass another to the async call.
+*/
+class DDFCancelToken{
+public:
+
+	DDFCancelToken();
+
+	void cancel();
+	bool cancelled() const;
+
+private:
+
+	std::shared_ptr<std::atomic<bool> > flag;
+};
+
+/*
+Input stream buffer that reads from another stream buffer in chunks, reports
+the bytes read to a DDFProgressFn and reports end-of-file as soon as its
+DDFCancelToken is cancelled.
+*/
+class DDFProgressBuf : public std::streambuf{
+public:
+
+	DDFProgressBuf(std::streambuf* source, size_t total, DDFCancelToken token, DDFProgressFn progress);
+
+	bool cutShort() const;
+
+protected:
+
+	int_type underflow();
+
+private:
+
+	std::streambuf* src;
+	std::vector<char> buf;
+	size_t done;
+	size_t total_bytes;
+	DDFCancelToken tok;
+	DDFProgressFn prog;
+	bool source_end;	//Source has no more data
+	bool cut;			//Reported end-of-file early because of the token
+};
+
+#ifdef DDF_HAS_COROUTINES
+
+/*
+Awaitable returned by awaitLoad() and awaitWrite(). Suspending queues the job
+on the pool; the coroutine is resumed on the worker thread when the job ends.
+*/
+class DDFAwaitable{
+public:
+
+	DDFAwaitable(std::function<DDFResult()> job, DDFThreadPool* pool);
+
+	bool await_ready();
+	void await_suspend(std::coroutine_handle<> h);
+	DDFResult await_resume();
+
+private:
+
+	std::function<DDFResult()> job_fn;
+	DDFThreadPool* job_pool;
+	DDFResult result;
+	std::exception_ptr error; //Set if the job threw
+};
+
+#endif
+
+//***************************************************************************//
+//**			FUNCTION DECLARATIONS									   **//
+//***************************************************************************//
+
+std::future<DDFResult> loadAsync(std::string fileIn, std::string options="", DDFCancelToken token=DDFCancelToken(), DDFProgressFn progress=nullptr, DDFThreadPool* pool=nullptr);
+std::future<DDFResult> writeAsync(DDFIO ddf, std::string fileOut, std::string options="", DDFCancelToken token=DDFCancelToken(), DDFProgressFn progress=nullptr, DDFThreadPool* pool=nullptr);
+
+DDFResult loadJob(std::string fileIn, std::string options, DDFCancelToken token, DDFProgressFn progress);
+DDFResult writeJob(DDFIO& ddf, std::string fileOut, std::string options, DDFCancelToken token, DDFProgressFn progress);
+
+#ifdef DDF_HAS_COROUTINES
+DDFAwaitable awaitLoad(std::string fileIn, std::string options="", DDFCancelToken token=DDFCancelToken(), DDFProgressFn progress=nullptr, DDFThreadPool* pool=nullptr);
+DDFAwaitable awaitWrite(DDFIO ddf, std::string fileOut, std::string options="", DDFCancelToken token=DDFCancelToken(), DDFProgressFn progress=nullptr, DDFThreadPool* pool=nullptr);
+#endif
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** DDFCancelToken
+
+DDFCancelToken::DDFCancelToken() : flag(new std::atomic<bool>(false)){
+}
+
+/*
+Requests cancellation. The operation stops at its next chunk boundary.
+*/
+void DDFCancelToken::cancel(){
+	*flag = true;
+}
+
+/*
+Returns true if cancel() has been called on any copy of this token.
+*/
+bool DDFCancelToken::cancelled() const{
+	return *flag;
+}
+
+//***************************************************************************//
+//***************** DDFProgressBuf
+
+DDFProgressBuf::DDFProgressBuf(std::streambuf* source, size_t total, DDFCancelToken token, DDFProgressFn progress) : src(source), buf(1 << 16), done(0), total_bytes(total), tok(token), prog(progress), source_end(false), cut(false){
+	setg(buf.data(), buf.data(), buf.data());
+}
+
+/*
+Returns true if the reader saw end-of-file before the end of the source
+because the token was cancelled. A cancel that comes after the whole source
+was read doesn't count.
+*/
+bool DDFProgressBuf::cutShort() const{
+	return cut;
+}
+
+/*
+Refills the buffer from the source. Returns EOF at the end of the source or
+once the token is cancelled.
+*/
+DDFProgressBuf::int_type DDFProgressBuf::underflow(){
+
+	if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+	if (source_end) return traits_type::eof();
+
+	if (tok.cancelled()){
+		cut = true;
+		return traits_type::eof();
+	}
+
+	std::streamsize n = src->sgetn(buf.data(), buf.size());
+	if (n <= 0){
+		source_end = true;
+		return traits_type::eof();
+	}
+
+	done += n;
+	if (prog) prog(done, total_bytes);
+
+	setg(buf.data(), buf.data(), buf.data() + n);
+	return traits_type::to_int_type(*gptr());
+}
+
+//***************************************************************************//
+//***************** DDFAwaitable
+
+#ifdef DDF_HAS_COROUTINES
+
+DDFAwaitable::DDFAwaitable(std::function<DDFResult()> job, DDFThreadPool* pool) : job_fn(job), job_pool(pool){
+	if (job_pool == nullptr) job_pool = &DDFThreadPool::shared();
+}
+
+bool DDFAwaitable::await_ready(){
+	return false;
+}
+
+void DDFAwaitable::await_suspend(std::coroutine_handle<> h){
+	job_pool->submit([this, h](){
+		try{
+			result = job_fn();
+		}catch(...){
+			error = std::current_exception();
+		}
+		h.resume();
+	});
+}
+
+/*
+Returns the job's result, or rethrows the exception the job threw.
+*/
+DDFResult DDFAwaitable::await_resume(){
+	if (error) std::rethrow_exception(error);
+	return std::move(result);
+}
+
+#endif
+
+//***************************************************************************//
+//***************** ASYNC CALLS
+
+/*
+Loads 'fileIn' on a pool thread. Options are passed to DDFIO::load. 'progress'
+is called with the number of bytes read as the file is parsed. If 'pool' is
+null, the shared pool is used. If the job throws (eg. std::bad_alloc), the
+future rethrows it from get().
+*/
+std::future<DDFResult> loadAsync(std::string fileIn, std::string options, DDFCancelToken token, DDFProgressFn progress, DDFThreadPool* pool){
+
+	if (pool == nullptr) pool = &DDFThreadPool::shared();
+
+	std::shared_ptr<std::promise<DDFResult> > prom(new std::promise<DDFResult>);
+	std::future<DDFResult> fut = prom->get_future();
+
+	pool->submit([prom, fileIn, options, token, progress](){
+		try{
+			prom->set_value(loadJob(fileIn, options, token, progress));
+		}catch(...){
+			prom->set_exception(std::current_exception());
+		}
+	});
+
+	return fut;
+}
+
+/*
+Formats and writes 'ddf' to 'fileOut' on a pool thread. Options are passed to
+DDFIO::swrite. The object is handed back in the result's 'ddf' field - move it
+in (std::move) to avoid a copy. 'progress' is called with the number of bytes
+written. A cancelled write deletes the partially written file. As with
+loadAsync(), an exception thrown by the job is rethrown by the future.
+*/
+std::future<DDFResult> writeAsync(DDFIO ddf, std::string fileOut, std::string options, DDFCancelToken token, DDFProgressFn progress, DDFThreadPool* pool){
+
+	if (pool == nullptr) pool = &DDFThreadPool::shared();
+
+	std::shared_ptr<std::promise<DDFResult> > prom(new std::promise<DDFResult>);
+	std::future<DDFResult> fut = prom->get_future();
+
+	std::shared_ptr<DDFIO> obj(new DDFIO(std::move(ddf)));
+	pool->submit([prom, obj, fileOut, options, token, progress](){
+		try{
+			prom->set_value(writeJob(*obj, fileOut, options, token, progress));
+		}catch(...){
+			prom->set_exception(std::current_exception());
+		}
+	});
+
+	return fut;
+}
+
+#ifdef DDF_HAS_COROUTINES
+
+/*
+Coroutine version of loadAsync(): 'co_await awaitLoad(...)' yields the result.
+*/
+DDFAwaitable awaitLoad(std::string fileIn, std::string options, DDFCancelToken token, DDFProgressFn progress, DDFThreadPool* pool){
+	return DDFAwaitable([fileIn, options, token, progress](){
+		return loadJob(fileIn, options, token, progress);
+	}, pool);
+}
+
+/*
+Coroutine version of writeAsync(): 'co_await awaitWrite(...)' yields the result.
+*/
+DDFAwaitable awaitWrite(DDFIO ddf, std::string fileOut, std::string options, DDFCancelToken token, DDFProgressFn progress, DDFThreadPool* pool){
+	std::shared_ptr<DDFIO> obj(new DDFIO(std::move(ddf)));
+	return DDFAwaitable([obj, fileOut, options, token, progress](){
+		return writeJob(*obj, fileOut, options, token, progress);
+	}, pool);
+}
+
+#endif
+
+//***************************************************************************//
+//***************** JOBS
+
+/*
+Body of an asynchronous load. Reads and parses 'fileIn' in one pass through a
+DDFProgressBuf.
+*/
+DDFResult loadJob(std::string fileIn, std::string options, DDFCancelToken token, DDFProgressFn progress){
+
+	DDFResult res;
+	res.file = fileIn;
+	res.success = false;
+	res.cancelled = false;
+
+	std::filebuf fb;
+	if (fb.open(fileIn.c_str(), std::ios::in) == NULL){
+		res.err = "Failed to open file '" + fileIn + "'.";
+		return res;
+	}
+
+	DDFProgressBuf pb(&fb, fileSize(fileIn), token, progress);
+	std::istream in(&pb);
+
+	res.success = res.ddf.load(in, options);
+
+	//Cancellation looks like end-of-file to the parser - override its verdict,
+	//unless the whole file had already been read
+	if (pb.cutShort()){
+		res.success = false;
+		res.cancelled = true;
+		res.err = "Cancelled.";
+	}else if (!res.success){
+		res.err = res.ddf.err();
+		if (res.err.length() == 0) res.err = "Failed to open or identify file '" + fileIn + "'.";
+	}
+
+	if (!res.success) res.ddf.clear();
+
+	return res;
+}
+
+/*
+Body of an asynchronous write. Formats the file with DDFIO::swrite, then writes
+it in chunks, checking for cancellation between chunks. 'ddf' is moved into the
+result.
+*/
+DDFResult writeJob(DDFIO& ddf, std::string fileOut, std::string options, DDFCancelToken token, DDFProgressFn progress){
+
+	DDFResult res;
+	res.file = fileOut;
+	res.success = false;
+	res.cancelled = false;
+
+	std::string contents = ddf.swrite(fileOut, options);
+	res.ddf = std::move(ddf);
+
+	if (contents == ""){
+		res.err = "Failed to format file '" + fileOut + "'.";
+		return res;
+	}
+
+	std::ofstream out(fileOut);
+	if (!out.is_open()){
+		res.err = "Failed to open file '" + fileOut + "'.";
+		return res;
+	}
+
+	const size_t chunk = 1 << 16;
+	for (size_t pos = 0 ; pos < contents.length() ; pos += chunk){
+
+		if (token.cancelled()){
+			out.close();
+			std::remove(fileOut.c_str());
+			res.cancelled = true;
+			res.err = "Cancelled.";
+			return res;
+		}
+
+		size_t n = std::min(chunk, contents.length() - pos);
+		out.write(contents.data() + pos, n);
+		if (!out){
+			res.err = "Failed to write file '" + fileOut + "'.";
+			return res;
+		}
+
+		if (progress) progress(pos + n, contents.length());
+	}
+
+	out.close();
+	res.success = true;
+
+	return res;
+}
+
+#endif
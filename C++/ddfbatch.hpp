@@ -0,0 +1,205 @@
+#ifndef DDFBATCH_HPP
+#define DDFBATCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include "cppddf.hpp"
+#include "ddfpool.hpp"
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+/*
+Outcome of one file in a batch or asynchronous operation. For loads, 'ddf'
+holds the file's contents when 'success' is true. For batch writes, 'ddf' is
+left empty. 'err' contains the error message (same text as DDFIO::err()) when
+'success' is false. 'cancelled' is true if the operation was stopped by a
+DDFCancelToken.
+*/
+typedef struct{
+	std::string file;
+	DDFIO ddf;
+	bool success;
+	bool cancelled;
+	std::string err;
+}DDFResult;
+
+//***************************************************************************//
+//**			FUNCTION DECLARATIONS									   **//
+//***************************************************************************//
+
+std::vector<DDFResult> batchLoad(std::vector<std::string> files, std::string options="", DDFThreadPool* pool=nullptr);
+std::vector<DDFResult> batchLoad(std::string directory, std::string pattern, std::string options="", DDFThreadPool* pool=nullptr);
+std::vector<DDFResult> batchWrite(std::vector<DDFIO>& objects, std::vector<std::string> files, std::string options="", DDFThreadPool* pool=nullptr);
+
+std::vector<std::string> listFiles(std::string directory, std::string pattern);
+size_t fileSize(std::string file);
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+/*
+Loads every file in 'files' concurrently. Options are passed to DDFIO::load.
+Results are returned in the same order as 'files'.
+
+Files are started largest first so the big ones finish early, and idle workers
+steal queued files from busy ones, so a few huge files don't hold up the rest.
+If 'pool' is null, the shared pool is used.
+*/
+std::vector<DDFResult> batchLoad(std::vector<std::string> files, std::string options, DDFThreadPool* pool){
+
+	if (pool == nullptr) pool = &DDFThreadPool::shared();
+
+	std::vector<DDFResult> results(files.size());
+
+	//Order jobs by ascending file size - each worker takes its newest (so
+	//largest) file first
+	std::vector<std::pair<size_t, size_t> > order; //(size, index)
+	for (size_t i = 0 ; i < files.size() ; i++){
+		order.push_back(std::make_pair(fileSize(files[i]), i));
+	}
+	std::stable_sort(order.begin(), order.end(), [](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b){
+		return a.first < b.first;
+	});
+
+	//Queue one task per file
+	std::atomic<size_t> remaining(files.size());
+	for (size_t k = 0 ; k < order.size() ; k++){
+
+		size_t i = order[k].second;
+		DDFResult* res = &results[i];
+		std::string file = files[i];
+
+		pool->submit([res, file, options, &remaining](){
+
+			DDFTaskDone done(remaining);
+
+			res->file = file;
+			res->cancelled = false;
+			res->success = res->ddf.load(file, options);
+
+			if (!res->success){
+				res->err = res->ddf.err();
+				if (res->err.length() == 0) res->err = "Failed to open or identify file '" + file + "'.";
+				res->ddf.clear();
+			}
+		});
+	}
+
+	pool->wait(remaining);
+
+	return results;
+}
+
+/*
+Loads every file in 'directory' whose name matches the shell-style 'pattern'
+(eg. "*.ddf"). Results are sorted by file name. See batchLoad() above.
+*/
+std::vector<DDFResult> batchLoad(std::string directory, std::string pattern, std::string options, DDFThreadPool* pool){
+	return batchLoad(listFiles(directory, pattern), options, pool);
+}
+
+/*
+Writes objects[i] to files[i] concurrently. Options are passed to DDFIO::write.
+Returns one result per object, in order; 'ddf' is left empty in the results.
+*/
+std::vector<DDFResult> batchWrite(std::vector<DDFIO>& objects, std::vector<std::string> files, std::string options, DDFThreadPool* pool){
+
+	if (pool == nullptr) pool = &DDFThreadPool::shared();
+
+	std::vector<DDFResult> results(objects.size());
+
+	//Check for size mismatch
+	if (objects.size() != files.size()){
+		for (size_t i = 0 ; i < results.size() ; i++){
+			results[i].success = false;
+			results[i].cancelled = false;
+			results[i].err = "Number of objects and file names must match.";
+		}
+		return results;
+	}
+
+	std::atomic<size_t> remaining(objects.size());
+	for (size_t i = 0 ; i < objects.size() ; i++){
+
+		DDFResult* res = &results[i];
+		DDFIO* obj = &objects[i];
+		std::string file = files[i];
+
+		pool->submit([res, obj, file, options, &remaining](){
+
+			DDFTaskDone done(remaining);
+
+			res->file = file;
+			res->cancelled = false;
+			res->success = obj->write(file, options);
+			if (!res->success){
+				res->err = "Failed to write file '" + file + "'.";
+			}
+		});
+	}
+
+	pool->wait(remaining);
+
+	return results;
+}
+
+/*
+Returns the paths of the regular files in 'directory' whose names match the
+shell-style 'pattern', sorted by name. Returns an empty vector if the directory
+can't be opened.
+*/
+std::vector<std::string> listFiles(std::string directory, std::string pattern){
+
+	std::vector<std::string> files;
+
+	DIR* dir = opendir(directory.c_str());
+	if (dir == NULL){
+		return files;
+	}
+
+	//Make sure joining directory and name yields a valid path
+	if (directory.length() > 0 && directory[directory.length()-1] != '/'){
+		directory = directory + "/";
+	}
+
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL){
+
+		std::string name = entry->d_name;
+		if (fnmatch(pattern.c_str(), name.c_str(), 0) != 0) continue;
+
+		//Skip directories etc.
+		struct stat st;
+		if (stat((directory + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+		files.push_back(directory + name);
+	}
+	closedir(dir);
+
+	std::sort(files.begin(), files.end());
+
+	return files;
+}
+
+/*
+Returns the size of 'file' in bytes, or 0 if it can't be read.
+*/
+size_t fileSize(std::string file){
+
+	struct stat st;
+	if (stat(file.c_str(), &st) != 0){
+		return 0;
+	}
+
+	return st.st_size;
+}
+
+#endif
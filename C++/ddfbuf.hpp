@@ -0,0 +1,142 @@
+#ifndef DDFBUF_HPP
+#define DDFBUF_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <streambuf>
+#include <vector>
+
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+#define DDF_FD_BUFFER 65536 //Bytes read from a file descriptor at a time
+
+/*
+Stream buffers that let the parser, which reads from a std::istream, read
+directly from memory or from a file descriptor.
+
+	DDFMemoryBuf buf(data, len);
+	std::istream in(&buf);
+*/
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+/*
+Read-only stream buffer over a caller's memory. The data is not copied, so it
+must outlive the buffer.
+*/
+class DDFMemoryBuf : public std::streambuf{
+public:
+
+	DDFMemoryBuf(const char* data, size_t len);
+
+protected:
+
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which=std::ios_base::in);
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which=std::ios_base::in);
+};
+
+/*
+Stream buffer reading from a file descriptor such as a pipe or stdin (0). The
+descriptor is not closed.
+*/
+class DDFFileDescBuf : public std::streambuf{
+public:
+
+	DDFFileDescBuf(int fd);
+
+	int error() const;
+
+protected:
+
+	int_type underflow();
+
+private:
+
+	int fd;
+	int read_errno; //errno from a failed read(), 0 if none
+	std::vector<char> buffer;
+};
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** DDFMemoryBuf
+
+DDFMemoryBuf::DDFMemoryBuf(const char* data, size_t len){
+	char* p = const_cast<char*>(data); //Get area is never written through
+	setg(p, p, p + len);
+}
+
+/*
+Allows tellg() and seekg() on streams reading from memory.
+*/
+std::streambuf::pos_type DDFMemoryBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which){
+
+	if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+
+	off_type base = 0;
+	if (dir == std::ios_base::cur) base = gptr() - eback();
+	else if (dir == std::ios_base::end) base = egptr() - eback();
+
+	off_type target = base + off;
+	if (target < 0 || target > egptr() - eback()) return pos_type(off_type(-1));
+
+	setg(eback(), eback() + target, egptr());
+	return pos_type(target);
+}
+
+std::streambuf::pos_type DDFMemoryBuf::seekpos(pos_type pos, std::ios_base::openmode which){
+	return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+//***************************************************************************//
+//***************** DDFFileDescBuf
+
+DDFFileDescBuf::DDFFileDescBuf(int fd) : fd(fd), read_errno(0), buffer(DDF_FD_BUFFER){
+	setg(buffer.data(), buffer.data(), buffer.data());
+}
+
+/*
+Returns the errno value if reading stopped because of an error rather than end
+of file, else 0.
+*/
+int DDFFileDescBuf::error() const{
+	return read_errno;
+}
+
+/*
+Refills the buffer from the descriptor. Retries reads interrupted by signals.
+*/
+std::streambuf::int_type DDFFileDescBuf::underflow(){
+
+	if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+	while (true){
+
+#ifdef _WIN32
+		int n = _read(fd, buffer.data(), (unsigned int)buffer.size());
+#else
+		ssize_t n = read(fd, buffer.data(), buffer.size());
+#endif
+
+		if (n > 0){
+			setg(buffer.data(), buffer.data(), buffer.data() + n);
+			return traits_type::to_int_type(*gptr());
+		}
+
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) read_errno = errno;
+
+		return traits_type::eof();
+	}
+}
+
+#endif
@@ -0,0 +1,663 @@
+#ifndef DDFCSV_HPP
+#define DDFCSV_HPP
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cppddf.hpp"
+#include "ddfpool.hpp"
+
+#define DDF_CSV_CHUNK 1048576 //Bytes of CSV converted per task
+#define DDF_CSV_SAMPLE 1000 //Rows used to infer column types
+
+/*
+Converts CSV files to DDF without building the data in memory. The CSV is read
+in chunks that are converted to vertical block lines on the thread pool and
+written in order, so memory use is bounded by a few chunks per worker whatever
+the size of the file.
+
+	DDFCsvImporter csv;
+	csv.delimiter(';');
+	csv.types("d?s"); //First column m<d>, second inferred, third m<s>
+	if (!csv.convert("log.csv", "log.ddf")) std::cout << csv.err() << std::endl;
+	for (const DDFCsvColumn& c : csv.report()){
+		if (c.conflicts > 0) std::cout << c.name << ": " << c.conflicts << " bad values" << std::endl;
+	}
+
+The first row names the columns unless header(false) is set. Names that
+aren't valid DDF names are adjusted (eg. spaces become '_'), and the original
+names are then kept as descriptions. Column types not given explicitly are
+inferred from the first rows: m<d> if every non-empty field is a number, m<b>
+if every one is true/false, else m<s>.
+
+Fields that don't match their column's type, and missing fields, are counted
+per column in report(). They are written as nan (m<d>), false (m<b>) or ""
+(m<s>), unless strict(true) is set, in which case the conversion fails. A
+vertical block has no way to leave a gap, so empty fields in m<d> columns also
+become nan. Numbers are copied as written, not reformatted. Line breaks inside
+quoted fields are replaced by spaces, and double quotes in m<s> fields are
+escaped (\").
+*/
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+/*
+One column of an import, from DDFCsvImporter::report().
+*/
+typedef struct{
+	std::string name;			//Variable name in the DDF file
+	std::string header;			//Name in the CSV header
+	char type;					//'d', 'b' or 's'
+	bool inferred;				//Type was inferred rather than given
+	size_t conflicts;			//Fields that didn't match the type
+	size_t missing;				//Rows too short to have this column
+	size_t first_conflict;		//Line of the first conflict, 0 if none
+	std::string conflict_value;	//Text of the first conflict
+}DDFCsvColumn;
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+class DDFCsvImporter{
+public:
+
+	//************ INITIALIZERS
+
+	DDFCsvImporter();
+
+	//************ SETTINGS
+
+	void delimiter(char d);
+	void header(bool has_header);
+	void names(std::vector<std::string> n);
+	void types(std::string t);
+	void strict(bool enable=true);
+
+	//************ CONVERSION
+
+	bool convert(std::string csvIn, std::string ddfOut, DDFThreadPool* pool=nullptr);
+
+	//************ STATUS
+
+	std::vector<DDFCsvColumn> report() const;
+	size_t rows() const;
+	std::string err() const;
+
+private:
+
+	char delim;
+	bool has_header;
+	bool strict_mode;
+	std::vector<std::string> given_names;
+	std::string given_types;
+
+	std::vector<DDFCsvColumn> cols;
+	std::vector<DDFCsvColumn> blank; //Columns with zero counts - read by the pool, never changed during a conversion
+	size_t num_rows;
+
+	std::string err_str;
+
+	/*
+	One chunk of CSV and its converted lines, filled in on the pool.
+	*/
+	typedef struct{
+		std::string csv;
+		std::string ddf;
+		size_t first_line;
+		size_t rows;
+		std::vector<DDFCsvColumn> stats; //Only the counts are used
+		std::atomic<size_t> busy;
+	}DDFCsvChunk;
+
+	bool readChunk(std::ifstream& file, std::string& carry, std::string& out, bool& done);
+	void convertChunk(DDFCsvChunk& ch) const;
+	bool collect(DDFCsvChunk& ch, std::ofstream& out);
+	void setColumns(const std::vector<std::string>& head, const std::string& sample);
+};
+
+//***************************************************************************//
+//**			FUNCTION DECLARATIONS									   **//
+//***************************************************************************//
+
+bool csv_next_record(const char*& p, const char* end, char delim, std::vector<std::string>& fields, size_t& lines);
+std::string csv_valid_name(std::string name);
+char csv_field_type(const std::string& field);
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** INITIALIZERS
+
+DDFCsvImporter::DDFCsvImporter() : delim(','), has_header(true), strict_mode(false), num_rows(0){
+}
+
+//***************************************************************************//
+//***************** SETTINGS
+
+/*
+Sets the field delimiter (',' by default).
+*/
+void DDFCsvImporter::delimiter(char d){
+	delim = d;
+}
+
+/*
+Sets whether the first row holds the column names (true by default). Without a
+header, columns are named by names() or else c1, c2, ...
+*/
+void DDFCsvImporter::header(bool has_header){
+	this->has_header = has_header;
+}
+
+/*
+Overrides the column names, in order. Blank entries keep the header's name.
+*/
+void DDFCsvImporter::names(std::vector<std::string> n){
+	given_names = n;
+}
+
+/*
+Sets column types, one character per column: 'd', 'b' or 's', or any other
+character (eg. '?') to infer that column's type. Columns past the end of 't'
+are inferred.
+*/
+void DDFCsvImporter::types(std::string t){
+	given_types = t;
+}
+
+/*
+In strict mode a field that doesn't match its column's type, or a missing
+field, stops the conversion with an error.
+*/
+void DDFCsvImporter::strict(bool enable){
+	strict_mode = enable;
+}
+
+//***************************************************************************//
+//***************** CONVERSION
+
+/*
+Converts 'csvIn' to a DDF file 'ddfOut' holding one vertical block. Chunks are
+converted concurrently on 'pool' (the shared pool if null). Returns false and
+sets the error string on failure, and then removes 'ddfOut'.
+*/
+bool DDFCsvImporter::convert(std::string csvIn, std::string ddfOut, DDFThreadPool* pool){
+
+	err_str = "";
+	cols.clear();
+	num_rows = 0;
+
+	if (pool == nullptr) pool = &DDFThreadPool::shared();
+
+	std::ifstream file(csvIn.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open()){
+		err_str = "Failed to open file '" + csvIn + "'.";
+		return false;
+	}
+
+	//First chunk gives the header and the sample for type inference
+	std::string carry;
+	std::string first;
+	bool done = false;
+	if (!readChunk(file, carry, first, done)) return false;
+
+	const char* p = first.c_str();
+	const char* end = p + first.length();
+	std::vector<std::string> head;
+	size_t header_lines = 0;
+	if (!csv_next_record(p, end, delim, head, header_lines)){
+		err_str = "File '" + csvIn + "' is empty.";
+		return false;
+	}
+	if (!has_header){
+		for (size_t k = 0 ; k < head.size() ; k++){
+			head[k] = "c" + std::to_string(k+1);
+		}
+		p = first.c_str();
+		header_lines = 0;
+	}
+
+	setColumns(head, std::string(p, end));
+	blank = cols;
+
+	std::ofstream out(ddfOut.c_str(), std::ios::out | std::ios::binary);
+	if (!out.is_open()){
+		err_str = "Failed to open file '" + ddfOut + "'.";
+		return false;
+	}
+
+	//Declarations
+	std::string text = "#VERSION 2.0\n\n#VERTICAL\n";
+	std::string names;
+	std::string descs;
+	bool renamed = false;
+	for (size_t k = 0 ; k < cols.size() ; k++){
+		if (k != 0){
+			text += " ";
+			names += " ";
+			descs += " ";
+		}
+		text = text + "m<" + cols[k].type + ">";
+		names += cols[k].name;
+		descs = descs + "?" + cols[k].header;
+		if (cols[k].name != cols[k].header) renamed = true;
+	}
+	text = text + "\n" + names + "\n";
+	if (renamed) text = text + descs + "\n";
+	out << text;
+
+	//Convert chunks concurrently, keeping a few per worker in flight and
+	//writing them out in order
+	size_t slots = 2*pool->size() + 1;
+	std::vector<std::unique_ptr<DDFCsvChunk> > ring;
+	for (size_t i = 0 ; i < slots ; i++){
+		ring.push_back(std::unique_ptr<DDFCsvChunk>(new DDFCsvChunk));
+		ring[i]->busy = 0;
+	}
+
+	size_t next_line = 1 + header_lines;
+	size_t submitted = 0;
+	size_t written = 0;
+	bool ok = true;
+	std::string chunk = std::string(p, end);
+	while (true){
+
+		//Count lines so each chunk knows where it starts
+		size_t lines = 0;
+		for (size_t i = 0 ; i < chunk.length() ; i++){
+			if (chunk[i] == '\n') lines++;
+		}
+
+		DDFCsvChunk& ch = *ring[submitted % slots];
+		if (submitted >= slots){
+			pool->wait(ch.busy);
+			if (ok) ok = collect(ch, out);
+			written++;
+		}
+		if (!ok) break;
+
+		ch.csv.swap(chunk);
+		ch.first_line = next_line;
+		ch.busy = 1;
+		pool->submit([this, &ch](){
+			DDFTaskDone done(ch.busy);
+			convertChunk(ch);
+		});
+		submitted++;
+		next_line += lines;
+
+		if (done) break;
+		if (!readChunk(file, carry, chunk, done)){
+			ok = false;
+			break;
+		}
+	}
+
+	//Write the rest
+	while (written < submitted){
+		DDFCsvChunk& ch = *ring[written % slots];
+		pool->wait(ch.busy);
+		if (ok) ok = collect(ch, out);
+		written++;
+	}
+
+	if (ok){
+		out << "#VERTICAL\n";
+		if (!out.good()){
+			err_str = "Failed to write file '" + ddfOut + "'.";
+			ok = false;
+		}
+	}
+
+	if (!ok){ //Don't leave half a file behind
+		out.close();
+		std::remove(ddfOut.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+//***************************************************************************//
+//***************** STATUS
+
+/*
+Returns the columns of the last conversion, with their types and the number
+of fields that didn't match.
+*/
+std::vector<DDFCsvColumn> DDFCsvImporter::report() const{
+	return cols;
+}
+
+/*
+Returns the number of data rows converted.
+*/
+size_t DDFCsvImporter::rows() const{
+	return num_rows;
+}
+
+/*
+Returns the error status
+*/
+std::string DDFCsvImporter::err() const{
+	return err_str;
+}
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Reads about DDF_CSV_CHUNK bytes into 'out', ending at a line break outside
+quotes. The partial record after it is kept in 'carry' for the next call.
+Sets 'done' at the end of the file.
+*/
+bool DDFCsvImporter::readChunk(std::ifstream& file, std::string& carry, std::string& out, bool& done){
+
+	out.swap(carry);
+	carry.clear();
+
+	size_t have = out.length();
+	out.resize(have + DDF_CSV_CHUNK);
+	file.read(&out[have], DDF_CSV_CHUNK);
+	out.resize(have + file.gcount());
+
+	if (file.bad()){
+		err_str = "Failed to read CSV file.";
+		return false;
+	}
+
+	if (!file){ //Reached the end
+		done = true;
+		return true;
+	}
+
+	//Cut after the last line break that is outside quotes
+	bool quoted = false;
+	size_t cut = std::string::npos;
+	for (size_t i = 0 ; i < out.length() ; i++){
+		if (out[i] == '"') quoted = !quoted;
+		else if (out[i] == '\n' && !quoted) cut = i;
+	}
+
+	if (cut == std::string::npos){ //One huge record - keep reading
+		carry.swap(out);
+		return readChunk(file, carry, out, done);
+	}
+
+	carry.assign(out, cut+1, std::string::npos);
+	out.resize(cut+1);
+
+	return true;
+}
+
+/*
+Converts the CSV in 'ch.csv' to vertical block lines in 'ch.ddf', counting
+conflicts in 'ch.stats'. Runs on the pool, so it only reads the importer's
+settings.
+*/
+void DDFCsvImporter::convertChunk(DDFCsvChunk& ch) const{
+
+	ch.ddf.clear();
+	ch.ddf.reserve(ch.csv.length() + ch.csv.length()/4);
+	ch.rows = 0;
+	ch.stats = blank;
+
+	std::vector<std::string> fields;
+	std::string text; //Scratch copy of an m<s> field
+	const char* p = ch.csv.c_str();
+	const char* end = p + ch.csv.length();
+	size_t line = ch.first_line;
+
+	while (true){
+
+		size_t lines = 0;
+		size_t start_line = line;
+		if (!csv_next_record(p, end, delim, fields, lines)) break;
+		line += lines;
+
+		for (size_t k = 0 ; k < ch.stats.size() ; k++){
+
+			if (k != 0) ch.ddf += ' ';
+
+			DDFCsvColumn& c = ch.stats[k];
+			bool present = (k < fields.size());
+			const std::string empty;
+			const std::string& f = present ? fields[k] : empty;
+			bool good = present;
+
+			switch(c.type){
+				case('d'):
+					if (good && f.length() > 0){
+						const char* s = f.c_str();
+						char* stop;
+						errno = 0;
+						strtod(s, &stop);
+						good = (stop != s && *stop == '\0' && errno != ERANGE && !isspace((unsigned char)s[0]));
+					}
+					if (good && f.length() > 0) ch.ddf += f;
+					else ch.ddf += "nan";
+					break;
+				case('b'):
+					good = good && is_bool_word(f.c_str(), f.length());
+					ch.ddf += good ? f : "false";
+					break;
+				default:
+					text.assign(f);
+					for (char& x : text){
+						if (x == '\n' || x == '\r') x = ' ';
+					}
+					ch.ddf += escape_string(text.data(), text.length());
+					break;
+			}
+
+			if (!present){
+				c.missing++;
+			}else if (!good){
+				c.conflicts++;
+			}
+			if ((!present || !good) && c.first_conflict == 0){
+				c.first_conflict = start_line;
+				c.conflict_value = f;
+			}
+		}
+
+		ch.ddf += '\n';
+		ch.rows++;
+	}
+
+	ch.csv.clear();
+}
+
+/*
+Writes a converted chunk and adds its counts to the report. Returns false in
+strict mode if it had a conflict or a missing field.
+*/
+bool DDFCsvImporter::collect(DDFCsvChunk& ch, std::ofstream& out){
+
+	for (size_t k = 0 ; k < cols.size() ; k++){
+
+		const DDFCsvColumn& s = ch.stats[k];
+		if (s.first_conflict != 0 && cols[k].first_conflict == 0){
+			cols[k].first_conflict = s.first_conflict;
+			cols[k].conflict_value = s.conflict_value;
+		}
+		cols[k].conflicts += s.conflicts;
+		cols[k].missing += s.missing;
+
+		if (strict_mode && s.first_conflict != 0){
+			err_str = "Failed on line " + std::to_string(s.first_conflict) + ".\n\tColumn '" + cols[k].header + "': ";
+			if (s.conflicts > 0) err_str = err_str + "'" + s.conflict_value + "' is not a valid " + ((cols[k].type == 'd') ? "number." : "bool.");
+			else err_str += "Field is missing.";
+			return false;
+		}
+	}
+
+	out << ch.ddf;
+	num_rows += ch.rows;
+	ch.ddf.clear();
+
+	return true;
+}
+
+/*
+Sets the columns' names from the header and given names, and their types from
+the given types or by inference from the CSV text 'sample'.
+*/
+void DDFCsvImporter::setColumns(const std::vector<std::string>& head, const std::string& sample){
+
+	cols.resize(head.size());
+	for (size_t k = 0 ; k < head.size() ; k++){
+
+		DDFCsvColumn& c = cols[k];
+		c.header = (k < given_names.size() && given_names[k] != "") ? given_names[k] : head[k];
+		c.name = csv_valid_name(c.header);
+		c.conflicts = 0;
+		c.missing = 0;
+		c.first_conflict = 0;
+
+		char t = (k < given_types.length()) ? given_types[k] : '?';
+		c.inferred = (t != 'd' && t != 'b' && t != 's');
+		c.type = c.inferred ? '\0' : t;
+
+		//Make names unique
+		for (size_t j = 0 ; j < k ; j++){
+			if (cols[j].name != c.name) continue;
+			c.name = c.name + "_" + std::to_string(k+1);
+			j = (size_t)-1; //Check again from the start
+		}
+	}
+
+	//Infer the remaining types from the first rows
+	std::vector<std::string> fields;
+	const char* p = sample.c_str();
+	const char* end = p + sample.length();
+	size_t lines = 0;
+	for (size_t r = 0 ; r < DDF_CSV_SAMPLE && csv_next_record(p, end, delim, fields, lines) ; r++){
+		for (size_t k = 0 ; k < cols.size() && k < fields.size() ; k++){
+
+			if (!cols[k].inferred || fields[k].length() == 0) continue;
+
+			char t = csv_field_type(fields[k]);
+			if (cols[k].type == '\0') cols[k].type = t;
+			else if (cols[k].type != t) cols[k].type = 's';
+		}
+	}
+
+	for (size_t k = 0 ; k < cols.size() ; k++){
+		if (cols[k].type == '\0') cols[k].type = 's'; //No values to go by
+	}
+}
+
+/*
+Reads the next record from the CSV text at 'p' into 'fields', advancing 'p'.
+Handles quoted fields ("" for a quote) and \r\n line ends, and skips blank
+lines. Adds the number of line breaks passed to 'lines'. Returns false at the
+end of the text.
+*/
+bool csv_next_record(const char*& p, const char* end, char delim, std::vector<std::string>& fields, size_t& lines){
+
+	//Skip blank lines
+	while (p < end && (*p == '\n' || *p == '\r')){
+		if (*p == '\n') lines++;
+		p++;
+	}
+	if (p >= end) return false;
+
+	size_t n = 0;
+	while (true){
+
+		if (n == fields.size()) fields.push_back("");
+		std::string& f = fields[n++];
+		f.clear();
+
+		//Skip leading spaces before an opening quote
+		const char* q = p;
+		while (q < end && *q == ' ') q++;
+
+		if (q < end && *q == '"'){
+			p = q + 1;
+			while (p < end){
+				if (*p == '"'){
+					if (p+1 < end && p[1] == '"'){
+						f += '"';
+						p += 2;
+						continue;
+					}
+					p++;
+					break;
+				}
+				if (*p == '\n') lines++;
+				f += *p++;
+			}
+			while (p < end && *p != delim && *p != '\n') p++; //Ignore anything after the closing quote
+		}else{
+			const char* s = p;
+			while (p < end && *p != delim && *p != '\n') p++;
+			const char* e = p;
+			if (e > s && e[-1] == '\r') e--;
+			while (s < e && (*s == ' ' || *s == '\t')) s++;
+			while (e > s && (e[-1] == ' ' || e[-1] == '\t')) e--;
+			f.assign(s, e - s);
+		}
+
+		if (p < end && *p == delim){
+			p++;
+			continue;
+		}
+
+		if (p < end){ //Line break
+			lines++;
+			p++;
+		}
+		break;
+	}
+
+	fields.resize(n);
+	return true;
+}
+
+/*
+Turns a CSV column name into a valid DDF variable name: whitespace becomes '_'
+and names not starting with a letter get a 'c' in front.
+*/
+std::string csv_valid_name(std::string name){
+
+	for (size_t i = 0 ; i < name.length() ; i++){
+		if (isspace((unsigned char)name[i])) name[i] = '_';
+	}
+
+	if (name.length() == 0 || !isalpha((unsigned char)name[0])) name = "c" + name;
+
+	return name;
+}
+
+/*
+Returns the narrowest type that can hold a non-empty CSV field: 'b' for
+true/false, 'd' for numbers, else 's'.
+*/
+char csv_field_type(const std::string& field){
+
+	if (is_bool_word(field.c_str(), field.length())) return 'b';
+
+	const char* s = field.c_str();
+	char* stop;
+	errno = 0;
+	strtod(s, &stop);
+	if (stop != s && *stop == '\0' && errno != ERANGE && !isspace((unsigned char)s[0])) return 'd';
+
+	return 's';
+}
+
+#endif
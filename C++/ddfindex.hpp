@@ -0,0 +1,366 @@
+#ifndef DDFINDEX_HPP
+#define DDFINDEX_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "ddfstream.hpp"
+
+#define DDF_INDEX_STRIDE 4096 //Rows between index entries
+
+/*
+Sparse row index for random access into a vertical block. The index holds the
+stream position of every K-th data line, so reading rows [first, first+count)
+seeks to the nearest entry before 'first', skips at most K-1 lines without
+converting them and parses only the requested rows.
+
+	DDFRowIndex idx;
+	idx.open("log.ddf"); //Loads log.ddf.idx, or scans the file and saves it
+	DDFVerticalReader rd;
+	rd.open("log.ddf", 0, {"V"});
+	DDFBatch batch;
+	idx.read(rd, 9000000, 1000, batch);
+
+The index can be saved next to the file. It records the file's size and
+modification time (to the nanosecond where the file system keeps it) and is
+rejected by load() once the file has changed.
+*/
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+class DDFRowIndex{
+public:
+
+	//************ INITIALIZERS
+
+	DDFRowIndex();
+
+	//************ BUILDING
+
+	bool build(std::string fileIn, size_t block=0, size_t stride=DDF_INDEX_STRIDE);
+	bool open(std::string fileIn, size_t block=0, size_t stride=DDF_INDEX_STRIDE);
+
+	//************ PERSISTENCE
+
+	bool save(std::string indexFile="");
+	bool load(std::string fileIn, size_t block=0, std::string indexFile="");
+	bool upToDate() const;
+
+	//************ READING
+
+	bool read(DDFVerticalReader& rd, size_t first, size_t count, DDFBatch& batch);
+	bool seek(DDFVerticalReader& rd, size_t row);
+
+	size_t rows() const;
+	size_t stride() const;
+
+	std::string err() const;
+
+private:
+
+	std::string source;	//File the index describes
+	size_t block_num;
+	size_t every;		//Rows between entries
+	size_t num_rows;
+	std::vector<DDFStreamPos> marks; //marks[k] is the position of row k*every
+
+	uint64_t source_size;
+	int64_t source_time;
+	int64_t source_nsec;	//Nanoseconds part of the modification time
+
+	std::string err_str;
+
+	bool stamp(const std::string& fileIn, uint64_t& size, int64_t& mtime, int64_t& nsec) const;
+};
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** INITIALIZERS
+
+DDFRowIndex::DDFRowIndex() : block_num(0), every(DDF_INDEX_STRIDE), num_rows(0), source_size(0), source_time(0), source_nsec(0){
+}
+
+//***************************************************************************//
+//***************** BUILDING
+
+/*
+Scans vertical block 'block' of 'fileIn' and records the position of every
+'stride'-th data line. Values aren't converted, so this is much faster than
+loading the block. Returns false and sets the error string on failure.
+*/
+bool DDFRowIndex::build(std::string fileIn, size_t block, size_t stride){
+
+	err_str = "";
+	marks.clear();
+	num_rows = 0;
+
+	if (stride == 0) stride = 1;
+
+	if (!stamp(fileIn, source_size, source_time, source_nsec)){
+		err_str = "Failed to open file '" + fileIn + "'.";
+		return false;
+	}
+
+	DDFVerticalReader rd;
+	if (!rd.open(fileIn, block)){
+		err_str = rd.err();
+		return false;
+	}
+
+	while (!rd.eof()){
+
+		DDFStreamPos p = rd.tell();
+		size_t n = rd.skip(stride);
+		if (n == 0) break;
+
+		marks.push_back(p);
+		num_rows += n;
+	}
+
+	if (rd.err() != ""){
+		err_str = rd.err();
+		marks.clear();
+		num_rows = 0;
+		return false;
+	}
+
+	source = fileIn;
+	block_num = block;
+	every = stride;
+
+	return true;
+}
+
+/*
+Loads the saved index for 'fileIn' if there is an up to date one with the
+same stride, else builds the index and saves it next to the file. Failing to
+save (eg. in a read-only directory) is not an error. Returns true if the index
+is ready to use.
+*/
+bool DDFRowIndex::open(std::string fileIn, size_t block, size_t stride){
+
+	if (load(fileIn, block) && every == stride) return true;
+
+	if (!build(fileIn, block, stride)) return false;
+
+	save();
+	err_str = "";
+
+	return true;
+}
+
+//***************************************************************************//
+//***************** PERSISTENCE
+
+/*
+Saves the index as a DDF file, by default next to the data file as
+'<file>.idx'. Returns false and sets the error string on failure.
+*/
+bool DDFRowIndex::save(std::string indexFile){
+
+	if (source == ""){
+		err_str = "No index to save.";
+		return false;
+	}
+
+	if (indexFile == "") indexFile = source + ".idx";
+
+	std::ofstream out(indexFile.c_str(), std::ios::out | std::ios::binary);
+	if (!out.is_open()){
+		err_str = "Failed to open file '" + indexFile + "'.";
+		return false;
+	}
+
+	//Integers are written exactly, not through the double formatter
+	out << "#VERSION 2.0\n\n";
+	out << "d block " << block_num << "\n";
+	out << "d stride " << every << "\n";
+	out << "d rows " << num_rows << "\n";
+	out << "d size " << source_size << " ?Size of the data file in bytes\n";
+	out << "d mtime " << source_time << " ?Modification time of the data file\n";
+	out << "d mtime_ns " << source_nsec << " ?Nanoseconds part of the modification time\n\n";
+	out << "#VERTICAL\nm<d> m<d> m<d>\noffset line columns\n";
+	for (size_t k = 0 ; k < marks.size() ; k++){
+		out << marks[k].offset << " " << marks[k].line << " " << marks[k].columns << "\n";
+	}
+	out << "#VERTICAL\n";
+
+	if (!out.good()){
+		err_str = "Failed to write file '" + indexFile + "'.";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+Loads a saved index for block 'block' of 'fileIn' (by default from
+'<file>.idx'). Fails if the index is missing, is for another block, or the
+data file has changed since it was built.
+*/
+bool DDFRowIndex::load(std::string fileIn, size_t block, std::string indexFile){
+
+	err_str = "";
+	if (indexFile == "") indexFile = fileIn + ".idx";
+
+	DDFIO ddf;
+	if (!ddf.load(indexFile)){
+		err_str = "Failed to read index '" + indexFile + "'.";
+		return false;
+	}
+
+	double b, stride, rows, size, mtime, mtime_ns;
+	std::vector<double> offset, line, columns;
+	if (!ddf.get("block", b) || !ddf.get("stride", stride) || !ddf.get("rows", rows) || !ddf.get("size", size) || !ddf.get("mtime", mtime) || !ddf.get("mtime_ns", mtime_ns) || !ddf.get("offset", offset) || !ddf.get("line", line) || !ddf.get("columns", columns) || offset.size() != line.size() || offset.size() != columns.size() || stride < 1){
+		err_str = "Index '" + indexFile + "' is invalid.";
+		return false;
+	}
+
+	if ((size_t)b != block){
+		err_str = "Index '" + indexFile + "' is for another vertical block.";
+		return false;
+	}
+
+	uint64_t cur_size;
+	int64_t cur_time;
+	int64_t cur_nsec;
+	if (!stamp(fileIn, cur_size, cur_time, cur_nsec) || cur_size != (uint64_t)size || cur_time != (int64_t)mtime || cur_nsec != (int64_t)mtime_ns){
+		err_str = "Index '" + indexFile + "' is out of date.";
+		return false;
+	}
+
+	marks.resize(offset.size());
+	for (size_t k = 0 ; k < marks.size() ; k++){
+		marks[k].offset = (uint64_t)offset[k];
+		marks[k].line = (size_t)line[k];
+		marks[k].columns = (size_t)columns[k];
+	}
+
+	source = fileIn;
+	block_num = block;
+	every = (size_t)stride;
+	num_rows = (size_t)rows;
+	source_size = cur_size;
+	source_time = cur_time;
+	source_nsec = cur_nsec;
+
+	return true;
+}
+
+/*
+Returns true if the data file hasn't changed since the index was built.
+*/
+bool DDFRowIndex::upToDate() const{
+
+	uint64_t size;
+	int64_t mtime;
+	int64_t nsec;
+	if (source == "" || !stamp(source, size, mtime, nsec)) return false;
+
+	return (size == source_size && mtime == source_time && nsec == source_nsec);
+}
+
+//***************************************************************************//
+//***************** READING
+
+/*
+Reads rows [first, first+count) into 'batch' ('count' is cut short at the end
+of the block). 'rd' must be open on the indexed file and block; it may select
+any columns. Returns false if 'first' is past the last row or on error.
+*/
+bool DDFRowIndex::read(DDFVerticalReader& rd, size_t first, size_t count, DDFBatch& batch){
+
+	if (!seek(rd, first)) return false;
+
+	if (count > num_rows - first) count = num_rows - first;
+	if (!rd.next(batch, count)){
+		err_str = rd.err();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+Moves 'rd' to data line 'row', so the next call to rd.next() starts there.
+Returns false if 'row' is past the last row or on error.
+*/
+bool DDFRowIndex::seek(DDFVerticalReader& rd, size_t row){
+
+	err_str = "";
+
+	if (row >= num_rows){
+		err_str = "Row " + std::to_string(row) + " is past the end of the block (" + std::to_string(num_rows) + " rows).";
+		return false;
+	}
+
+	size_t k = row / every;
+	if (!rd.seek(marks[k])){
+		err_str = rd.err();
+		return false;
+	}
+
+	size_t gap = row - k*every;
+	if (rd.skip(gap) != gap){
+		err_str = (rd.err() != "") ? rd.err() : "File has changed since the index was built.";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+Returns the number of data lines in the block.
+*/
+size_t DDFRowIndex::rows() const{
+	return num_rows;
+}
+
+/*
+Returns the number of rows between index entries.
+*/
+size_t DDFRowIndex::stride() const{
+	return every;
+}
+
+/*
+Returns the error status
+*/
+std::string DDFRowIndex::err() const{
+	return err_str;
+}
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Gets the size and modification time of 'fileIn', the time split into seconds
+and nanoseconds (kept apart as the index stores them as doubles). A file
+rewritten within the same second is then still seen as changed. Returns false
+if it can't be read.
+*/
+bool DDFRowIndex::stamp(const std::string& fileIn, uint64_t& size, int64_t& mtime, int64_t& nsec) const{
+
+	struct stat st;
+	if (stat(fileIn.c_str(), &st) != 0) return false;
+
+	size = (uint64_t)st.st_size;
+	mtime = (int64_t)st.st_mtime;
+#ifdef __APPLE__
+	nsec = (int64_t)st.st_mtimespec.tv_nsec;
+#else
+	nsec = (int64_t)st.st_mtim.tv_nsec;
+#endif
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,561 @@
+#ifndef DDFLOGGER_HPP
+#define DDFLOGGER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "cppddf.hpp"
+
+/*
+Streams rows of data into the #VERTICAL block of a DDF file while they are
+being produced. The version, header and column declarations are written once
+by open(). After that, any number of threads call log() with one value per
+column. Rows go into a lock-free ring buffer, and a background thread formats
+and appends them in batches.
+
+After every batch the closing #VERTICAL statement is rewritten at the end of
+the data, so the file on disk is a complete, loadable DDF file between flushes.
+A crash loses at most the rows logged since the last flush.
+
+	DDFLogger lg;
+	lg.open("run.ddf", {"t", "V", "ok"}, "ddb", {"s", "volts", "in range"});
+	lg.log(0.001, 3.3, true);	//From any thread
+	lg.close();
+
+If the ring buffer is full, log() drops the row and returns false rather than
+blocking the caller - see dropped().
+*/
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+/*
+One value in a logged row. Only the field matching the column's type is used.
+*/
+typedef struct{
+	double d;
+	bool b;
+	std::string s;
+}DDFLogCell;
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+class DDFLogger{
+public:
+
+	//************ INITIALIZERS
+
+	DDFLogger();
+	~DDFLogger();
+
+	//************ FILE
+
+	bool open(std::string fileOut, std::vector<std::string> names, std::string types, std::vector<std::string> descriptions={}, std::string header="", size_t capacity=65536);
+	void close();
+	void flush();
+	bool isOpen();
+
+	//************ SETTINGS
+
+	void setFlushInterval(double seconds);
+	void setFlushSize(size_t rows);
+
+	//************ LOGGING
+
+	template<typename... T>
+	bool log(const T&... values);
+	bool logRow(const std::vector<double>& row);
+
+	//************ STATUS
+
+	size_t logged();
+	size_t dropped();
+	std::string err();
+
+private:
+
+	typedef struct{
+		std::atomic<size_t> seq; //Ring position this slot is ready for - see Vyukov's bounded queue
+		std::vector<DDFLogCell> cells;
+	}DDFLogSlot;
+
+	std::unique_ptr<DDFLogSlot[]> ring;
+	size_t ring_size; //Power of two
+	std::atomic<size_t> head; //Next position producers will claim
+	size_t tail; //Next position the flusher will read (flusher thread only)
+
+	std::string col_types;
+
+	std::fstream file;
+	std::streamoff data_end; //Where the closing #VERTICAL statement starts
+	std::string buffer; //Formatted rows waiting to be written (flusher thread only)
+
+	std::thread flusher;
+	std::mutex mtx;
+	std::condition_variable wake_cv; //Wakes the flusher
+	std::condition_variable done_cv; //Signals flush() that a batch was written
+	bool stopping;
+	bool flush_requested;
+	size_t num_written; //Rows written to the file
+
+	std::atomic<long long> interval_us;
+	std::atomic<size_t> flush_rows;
+	std::atomic<size_t> num_logged;
+	std::atomic<size_t> num_dropped;
+
+	std::string err_str;
+
+	DDFLogSlot* claim();
+	void publish(DDFLogSlot* slot);
+
+	void flushLoop();
+	size_t drain();
+	bool writeBatch();
+
+	static char cellType(bool x);
+	static char cellType(const std::string& x);
+	static char cellType(const char* x);
+	template<typename T>
+	static typename std::enable_if<std::is_arithmetic<T>::value, char>::type cellType(const T& x);
+
+	static void setCell(DDFLogCell& c, bool x);
+	static void setCell(DDFLogCell& c, const std::string& x);
+	static void setCell(DDFLogCell& c, const char* x);
+	template<typename T>
+	static typename std::enable_if<std::is_arithmetic<T>::value>::type setCell(DDFLogCell& c, const T& x);
+};
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** INITIALIZERS
+
+DDFLogger::DDFLogger() : ring_size(0), head(0), tail(0), data_end(0), stopping(false), flush_requested(false), num_written(0), interval_us(100000), flush_rows(1024), num_logged(0), num_dropped(0){
+}
+
+/*
+Closes the file, writing any rows still in the buffer.
+*/
+DDFLogger::~DDFLogger(){
+	close();
+}
+
+//***************************************************************************//
+//***************** FILE
+
+/*
+Creates 'fileOut' and writes the version statement, the header (if not blank)
+and the declarations of a vertical block with one column per name. 'types'
+holds one type character per column: 'd', 'b' or 's'. 'capacity' is the number
+of rows the ring buffer holds, rounded up to a power of two.
+
+The description line is always written so the block is valid before the first
+row arrives. Columns without a description use their name instead.
+
+Returns false and sets the error string on failure.
+*/
+bool DDFLogger::open(std::string fileOut, std::vector<std::string> names, std::string types, std::vector<std::string> descriptions, std::string header, size_t capacity){
+
+	close();
+
+	err_str = "";
+
+	//Check declarations
+	if (names.size() == 0 || names.size() != types.length()){
+		err_str = "Number of names and types must match and be at least one.";
+		return false;
+	}
+	if (descriptions.size() > 0 && descriptions.size() != names.size()){
+		err_str = "Number of descriptions must match number of names.";
+		return false;
+	}
+	for (size_t i = 0 ; i < names.size() ; i++){
+		if (!is_valid_name(names[i].c_str(), names[i].length())){
+			err_str = "Variable name '" + names[i] + "' is invalid.";
+			return false;
+		}
+		if (types[i] != 'd' && types[i] != 'b' && types[i] != 's'){
+			err_str = "Type '" + std::string(1, types[i]) + "' is invalid.";
+			return false;
+		}
+	}
+
+	file.open(fileOut.c_str(), std::ios::in | std::ios::out | std::ios::trunc);
+	if (!file.is_open()){
+		err_str = "Failed to open file '" + fileOut + "'.";
+		return false;
+	}
+
+	//Write preamble
+	std::string decl = "#VERSION " + std::to_string(CURRENT_VERSION) + "\n\n";
+	if (header.length() > 0){
+		decl = decl + "#HEADER\n" + header + "\n#HEADER\n\n";
+	}
+	decl = decl + "#VERTICAL\n";
+	std::string type_line, name_line, desc_line;
+	for (size_t i = 0 ; i < names.size() ; i++){
+		std::string d = (descriptions.size() > 0) ? descriptions[i] : "";
+		if (d.length() == 0 || d.find("?") != std::string::npos) d = names[i];
+		type_line = type_line + (i == 0 ? "" : "\t") + "m<" + types[i] + ">";
+		name_line = name_line + (i == 0 ? "" : "\t") + names[i];
+		desc_line = desc_line + (i == 0 ? "" : "\t") + "?" + d;
+	}
+	decl = decl + type_line + "\n" + name_line + "\n" + desc_line + "\n";
+
+	file << decl;
+	data_end = file.tellp();
+	file << "#VERTICAL\n";
+	file.flush();
+	if (!file){
+		err_str = "Failed to write file '" + fileOut + "'.";
+		file.close();
+		return false;
+	}
+
+	//Allocate ring buffer
+	ring_size = 1;
+	while (ring_size < capacity) ring_size <<= 1;
+	ring.reset(new DDFLogSlot[ring_size]);
+	for (size_t i = 0 ; i < ring_size ; i++){
+		ring[i].seq = i;
+		ring[i].cells.resize(names.size());
+	}
+	head = 0;
+	tail = 0;
+	col_types = types;
+	num_logged = 0;
+	num_written = 0;
+	num_dropped = 0;
+
+	//Start flusher
+	stopping = false;
+	flush_requested = false;
+	flusher = std::thread(&DDFLogger::flushLoop, this);
+
+	return true;
+}
+
+/*
+Writes all buffered rows, stops the flusher and closes the file. Make sure no
+other thread is still calling log().
+*/
+void DDFLogger::close(){
+
+	if (!flusher.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	wake_cv.notify_one();
+	flusher.join();
+
+	file.close();
+	ring.reset();
+	ring_size = 0;
+}
+
+/*
+Writes all rows logged so far to disk before returning.
+*/
+void DDFLogger::flush(){
+
+	if (!flusher.joinable()) return;
+
+	std::unique_lock<std::mutex> lock(mtx);
+	size_t target = num_logged; //Rows published before this call
+	flush_requested = true;
+	wake_cv.notify_one();
+	done_cv.wait(lock, [this, target](){ return num_written >= target || stopping; });
+}
+
+/*
+Returns true if a file is open for logging.
+*/
+bool DDFLogger::isOpen(){
+	return flusher.joinable();
+}
+
+//***************************************************************************//
+//***************** SETTINGS
+
+/*
+Sets the longest time rows wait in the buffer before being written. Default
+0.1 s.
+*/
+void DDFLogger::setFlushInterval(double seconds){
+	interval_us = static_cast<long long>(seconds * 1e6);
+}
+
+/*
+Sets the number of buffered rows that triggers a write before the flush
+interval is up. Default 1024.
+*/
+void DDFLogger::setFlushSize(size_t rows){
+	flush_rows = (rows < 1) ? 1 : rows;
+}
+
+//***************************************************************************//
+//***************** LOGGING
+
+/*
+Logs one row. Takes one value per column: numbers for m<d> columns, bools for
+m<b> columns and strings for m<s> columns. Strings must not contain double
+quotes or newlines. Safe to call from any number of threads.
+
+Returns false if the row doesn't match the columns, no file is open, or the
+buffer is full (the row is dropped and counted by dropped()).
+*/
+template<typename... T>
+bool DDFLogger::log(const T&... values){
+
+	if (sizeof...(T) != col_types.length()) return false;
+
+	//Check types before claiming a slot
+	const char given[] = {cellType(values)..., '\0'};
+	if (col_types.compare(given) != 0) return false;
+
+	DDFLogSlot* slot = claim();
+	if (slot == NULL) return false;
+
+	size_t col = 0;
+	int expand[] = {(setCell(slot->cells[col++], values), 0)...};
+	(void)expand;
+
+	publish(slot);
+
+	return true;
+}
+
+/*
+Logs one row of a log whose columns are all m<d>. See log().
+*/
+bool DDFLogger::logRow(const std::vector<double>& row){
+
+	if (row.size() != col_types.length() || col_types.find_first_not_of('d') != std::string::npos) return false;
+
+	DDFLogSlot* slot = claim();
+	if (slot == NULL) return false;
+
+	for (size_t i = 0 ; i < row.size() ; i++){
+		slot->cells[i].d = row[i];
+	}
+
+	publish(slot);
+
+	return true;
+}
+
+//***************************************************************************//
+//***************** STATUS
+
+/*
+Returns the number of rows accepted since open().
+*/
+size_t DDFLogger::logged(){
+	return num_logged;
+}
+
+/*
+Returns the number of rows dropped because the buffer was full.
+*/
+size_t DDFLogger::dropped(){
+	return num_dropped;
+}
+
+/*
+Returns the error status. Write errors in the background thread are reported
+here and stop the log.
+*/
+std::string DDFLogger::err(){
+	std::lock_guard<std::mutex> lock(mtx);
+	return err_str;
+}
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Claims the next free slot of the ring buffer for a producer. Returns NULL if
+the buffer is full or not open. Lock-free: producers race for positions with a
+compare-and-swap on 'head', and each slot's sequence number says whether the
+flusher has finished with it.
+*/
+DDFLogger::DDFLogSlot* DDFLogger::claim(){
+
+	if (ring_size == 0) return NULL;
+
+	size_t pos = head.load(std::memory_order_relaxed);
+	while (true){
+
+		DDFLogSlot* slot = &ring[pos & (ring_size-1)];
+		size_t seq = slot->seq.load(std::memory_order_acquire);
+
+		if (seq == pos){ //Slot free - try to take it
+			if (head.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) return slot;
+		}else if (seq < pos){ //Slot still holds an unwritten row - buffer full
+			num_dropped++;
+			return NULL;
+		}else{ //Another producer took this position
+			pos = head.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+/*
+Hands a filled slot to the flusher. Wakes it early once enough rows are
+waiting.
+*/
+void DDFLogger::publish(DDFLogSlot* slot){
+
+	size_t pos = slot->seq.load(std::memory_order_relaxed);
+	slot->seq.store(pos+1, std::memory_order_release);
+
+	size_t n = ++num_logged;
+	if (n % flush_rows == 0){
+		{ std::lock_guard<std::mutex> lock(mtx); } //So the flusher can't miss the wake-up between checking and waiting
+		wake_cv.notify_one();
+	}
+}
+
+/*
+Body of the flusher thread. Writes a batch every flush interval, when enough
+rows are waiting, on flush() and on close().
+*/
+void DDFLogger::flushLoop(){
+
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true){
+
+		wake_cv.wait_for(lock, std::chrono::microseconds(interval_us.load()), [this](){
+			return stopping || flush_requested || num_logged - num_written >= flush_rows;
+		});
+		bool stop = stopping;
+		flush_requested = false;
+
+		//Format and write without holding the lock
+		lock.unlock();
+		size_t n = drain();
+		bool ok = writeBatch();
+		lock.lock();
+
+		if (!ok && err_str.length() == 0){
+			err_str = "Failed to write log file.";
+		}
+
+		if (ok) num_written += n;
+		done_cv.notify_all();
+
+		if (stop || !ok) break;
+	}
+
+	//Refuse further rows once writing has failed
+	stopping = true;
+	done_cv.notify_all();
+}
+
+/*
+Formats every row that is ready into 'buffer' and frees its slot. Returns the
+number of rows formatted.
+*/
+size_t DDFLogger::drain(){
+
+	size_t n = 0;
+	while (true){
+
+		DDFLogSlot* slot = &ring[tail & (ring_size-1)];
+		if (slot->seq.load(std::memory_order_acquire) != tail+1) break; //Not yet published
+
+		for (size_t i = 0 ; i < slot->cells.size() ; i++){
+			if (i != 0) buffer += "\t";
+			switch(col_types[i]){
+				case('d'):
+					buffer += gstd::to_gstring(slot->cells[i].d);
+					break;
+				case('b'):
+					buffer += bool_to_string(slot->cells[i].b);
+					break;
+				default:
+					buffer += escape_string(slot->cells[i].s.data(), slot->cells[i].s.length());
+					break;
+			}
+		}
+		buffer += "\n";
+
+		slot->seq.store(tail + ring_size, std::memory_order_release); //Free for the producer one lap ahead
+		tail++;
+		n++;
+	}
+
+	return n;
+}
+
+/*
+Writes the formatted rows over the old closing statement, then writes a new
+closing statement after them. Returns false on a write error.
+*/
+bool DDFLogger::writeBatch(){
+
+	if (buffer.length() == 0) return true;
+
+	size_t rows_len = buffer.length();
+	buffer += "#VERTICAL\n"; //One write, so the block is only open for as long as the write takes
+
+	file.seekp(data_end);
+	file.write(buffer.data(), buffer.length());
+	file.flush();
+	data_end += rows_len;
+
+	buffer.clear();
+
+	return static_cast<bool>(file);
+}
+
+char DDFLogger::cellType(bool){
+	return 'b';
+}
+
+char DDFLogger::cellType(const std::string&){
+	return 's';
+}
+
+char DDFLogger::cellType(const char*){
+	return 's';
+}
+
+template<typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, char>::type DDFLogger::cellType(const T&){
+	return 'd';
+}
+
+void DDFLogger::setCell(DDFLogCell& c, bool x){
+	c.b = x;
+}
+
+void DDFLogger::setCell(DDFLogCell& c, const std::string& x){
+	c.s.assign(x); //Reuses the slot's capacity - no allocation once warmed up
+}
+
+void DDFLogger::setCell(DDFLogCell& c, const char* x){
+	c.s.assign(x);
+}
+
+template<typename T>
+typename std::enable_if<std::is_arithmetic<T>::value>::type DDFLogger::setCell(DDFLogCell& c, const T& x){
+	c.d = static_cast<double>(x);
+}
+
+#endif
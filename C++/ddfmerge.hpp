@@ -0,0 +1,585 @@
+#ifndef DDFMERGE_HPP
+#define DDFMERGE_HPP
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ddfpool.hpp"
+#include "ddfstream.hpp"
+
+#define DDF_MERGE_ROWS 65536 //Rows per batch when merging
+
+/*
+Concatenates the same vertical columns from an ordered list of files (eg. one
+log per day) without loading any of them in full. Each file is streamed in
+batches, so memory use is bounded by two batches whatever the number or size
+of the files.
+
+	DDFMerge mg;
+	mg.open(listFiles("logs", "2024-05-*.ddf"), {"t", "V"});
+	mg.write("may.ddf"); //One vertical block holding t and V for the month
+
+	mg.open(files, {"V"});
+	std::vector<double> V;
+	mg.read("V", V); //Or the column in memory
+
+open() reads the declarations of every file concurrently and fails unless all
+of them have the selected columns, with the same types. While one batch is
+being written or copied, the next is read on the thread pool.
+
+Columns of 2D matrices (rows ended by ';') stay 2D; each file's last row is
+kept separate from the next file's first. Columns that end before the rest of
+the block are only allowed in the last file, since otherwise the merged
+columns would no longer line up.
+*/
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+class DDFMerge{
+public:
+
+	//************ INITIALIZERS
+
+	DDFMerge();
+	~DDFMerge();
+
+	//************ FILES
+
+	bool open(std::vector<std::string> files, std::vector<std::string> columns, size_t block=0, DDFThreadPool* pool=nullptr);
+	void close();
+
+	//************ READING
+
+	bool next(DDFBatch& batch, size_t rows=DDF_MERGE_ROWS);
+	size_t file() const;
+
+	bool write(std::string fileOut, size_t rows=DDF_MERGE_ROWS);
+	bool read(std::string column, std::vector<double>& out, size_t rows=DDF_MERGE_ROWS);
+	bool read(std::string column, std::vector<bool>& out, size_t rows=DDF_MERGE_ROWS);
+	bool read(std::string column, std::vector<std::string>& out, size_t rows=DDF_MERGE_ROWS);
+
+	//************ STATUS
+
+	std::vector<std::string> names() const;
+	std::string types() const;
+	std::string err() const;
+
+private:
+
+	std::vector<std::string> sources;
+	std::vector<std::string> selection;
+	size_t block_num;
+	DDFThreadPool* workers;
+
+	std::vector<std::string> col_names;
+	std::vector<std::string> col_descs;
+	std::string col_types;
+
+	DDFVerticalReader rd;
+	size_t current;		//File 'rd' is reading
+	size_t batch_file;	//File the last batch from next() came from
+
+	DDFBatch ahead;		//Batch being read in the background
+	size_t ahead_rows;
+	size_t ahead_file;
+	bool ahead_ok;
+	std::string ahead_err;
+	std::atomic<size_t> in_flight;
+
+	std::string err_str;
+
+	bool fill(DDFBatch& batch, size_t rows, size_t& fileIdx, std::string& errOut);
+	void prefetch(size_t rows);
+	void finish();
+	size_t findColumn(std::string column, char type);
+};
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** INITIALIZERS
+
+DDFMerge::DDFMerge() : block_num(0), workers(nullptr), current(0), batch_file(0), ahead_rows(0), ahead_file(0), ahead_ok(false), in_flight(0){
+}
+
+DDFMerge::~DDFMerge(){
+	finish();
+}
+
+//***************************************************************************//
+//***************** FILES
+
+/*
+Checks that vertical block 'block' of every file in 'files' has the columns
+named in 'columns' (every column of the first file's block if empty) with
+matching types, then gets ready to read them in order. Descriptions are taken
+from the first file. If 'pool' is null, the shared pool is used.
+
+Returns false and sets the error string on failure.
+*/
+bool DDFMerge::open(std::vector<std::string> files, std::vector<std::string> columns, size_t block, DDFThreadPool* pool){
+
+	close();
+
+	if (files.size() == 0){
+		err_str = "No files to merge.";
+		return false;
+	}
+
+	if (pool == nullptr) pool = &DDFThreadPool::shared();
+	workers = pool;
+
+	//First file decides the columns and types
+	if (!rd.open(files[0], block, columns)){
+		err_str = files[0] + ": " + rd.err();
+		return false;
+	}
+	col_names = rd.names();
+	col_descs = rd.descriptions();
+	col_types = rd.types();
+	rd.close();
+
+	//Check the declarations of the others concurrently
+	std::vector<std::string> problems(files.size());
+	std::atomic<size_t> remaining(files.size()-1);
+	for (size_t i = 1 ; i < files.size() ; i++){
+
+		std::string* problem = &problems[i];
+		std::string file = files[i];
+		std::vector<std::string> want = col_names;
+		std::string types = col_types;
+
+		pool->submit([problem, file, want, types, block, &remaining](){
+
+			DDFTaskDone done(remaining);
+
+			DDFVerticalReader check;
+			if (!check.open(file, block, want)){
+				*problem = file + ": " + check.err();
+			}else if (check.types() != types){
+				std::string got = check.types();
+				for (size_t k = 0 ; k < want.size() ; k++){
+					if (got[k] == types[k]) continue;
+					*problem = file + ": Column '" + want[k] + "' is m<" + got[k] + "> but m<" + types[k] + "> in the first file.";
+					break;
+				}
+			}
+		});
+	}
+	pool->wait(remaining);
+
+	for (size_t i = 1 ; i < files.size() ; i++){
+		if (problems[i] != ""){
+			err_str = problems[i];
+			col_names.clear();
+			col_descs.clear();
+			col_types = "";
+			return false;
+		}
+	}
+
+	sources = files;
+	selection = col_names;
+	block_num = block;
+	current = 0;
+
+	if (!rd.open(sources[0], block_num, selection)){
+		err_str = sources[0] + ": " + rd.err();
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+Stops merging and closes the open file.
+*/
+void DDFMerge::close(){
+
+	finish();
+
+	rd.close();
+	sources.clear();
+	selection.clear();
+	col_names.clear();
+	col_descs.clear();
+	col_types = "";
+	current = 0;
+	batch_file = 0;
+	ahead_rows = 0;
+	err_str = "";
+}
+
+//***************************************************************************//
+//***************** READING
+
+/*
+Reads up to 'rows' rows into 'batch', moving on to the next file at the end of
+each one. A batch never holds rows from two files; file() tells which file it
+came from. Returns false once every file has been read, or on error (then
+err() is not blank). The next batch is read ahead, so the first batch after
+changing 'rows' still has the old size.
+*/
+bool DDFMerge::next(DDFBatch& batch, size_t rows){
+
+	if (sources.size() == 0) return false;
+
+	//Take the batch read in the background, if any
+	finish();
+	bool ok;
+	if (ahead_rows != 0){
+		std::swap(batch, ahead);
+		batch_file = ahead_file;
+		ok = ahead_ok;
+		err_str = ahead_err;
+	}else{
+		ok = fill(batch, rows, batch_file, err_str);
+	}
+	ahead_rows = 0;
+
+	if (ok) prefetch(rows);
+
+	return ok;
+}
+
+/*
+Returns the position in the file list of the file the last batch came from.
+*/
+size_t DDFMerge::file() const{
+	return batch_file;
+}
+
+/*
+Writes the merged columns to 'fileOut' as a single vertical block. Returns
+false and sets the error string on failure, and then removes 'fileOut'.
+*/
+bool DDFMerge::write(std::string fileOut, size_t rows){
+
+	if (sources.size() == 0){
+		err_str = "No files to merge.";
+		return false;
+	}
+
+	std::ofstream out(fileOut.c_str(), std::ios::out | std::ios::binary);
+	if (!out.is_open()){
+		err_str = "Failed to open file '" + fileOut + "'.";
+		return false;
+	}
+
+	//Declarations
+	std::string text = "#VERSION 2.0\n\n#VERTICAL\n";
+	std::string names;
+	std::string descs;
+	bool all_descr_blank = true;
+	for (size_t k = 0 ; k < col_names.size() ; k++){
+		if (k != 0){
+			text += " ";
+			names += " ";
+			descs += " ";
+		}
+		text = text + "m<" + col_types[k] + ">";
+		names += col_names[k];
+		descs = descs + "?" + col_descs[k];
+		if (col_descs[k] != "") all_descr_blank = false;
+	}
+	text = text + "\n" + names + "\n";
+	if (!all_descr_blank) text = text + descs + "\n";
+
+	//The last row of each file is held back until the next file starts, so
+	//2D columns can be given the ';' that ends their last row
+	std::vector<std::string> held;
+	std::vector<bool> is_2d(col_names.size(), false); //Saw a ';' in the current file
+	size_t held_file = 0;
+	size_t file_rows = 0;
+	std::vector<size_t> file_counts(col_names.size(), 0);
+
+	DDFBatch batch;
+	bool have_batch = next(batch, rows);
+	while (true){
+
+		bool new_file = (!have_batch || batch.rows() == 0 || batch_file != held_file);
+
+		if (new_file && held.size() > 0){
+
+			//Every column must run the full length of all but the last file
+			if (have_batch){
+				for (size_t k = 0 ; k < col_names.size() ; k++){
+					if (file_counts[k] == file_rows) continue;
+					err_str = sources[held_file] + ": Column '" + col_names[k] + "' ends before the end of the block. Only the last file may have shorter columns.";
+					out.close();
+					std::remove(fileOut.c_str());
+					return false;
+				}
+				for (size_t k = 0 ; k < held.size() ; k++){
+					if (is_2d[k] && held[k].back() != ';') held[k] += ";";
+				}
+			}
+
+			for (size_t k = 0 ; k < held.size() ; k++){
+				if (k != 0) text += " ";
+				text += held[k];
+			}
+			text += "\n";
+			held.clear();
+		}
+
+		if (new_file){
+			is_2d.assign(col_names.size(), false);
+			file_rows = 0;
+			file_counts.assign(col_names.size(), 0);
+		}
+
+		out << text;
+		text.clear();
+
+		if (!have_batch) break;
+		held_file = batch_file;
+
+		//Format rows, holding back the batch's last one
+		for (size_t r = 0 ; r < batch.rows() ; r++){
+
+			if (held.size() > 0){
+				for (size_t k = 0 ; k < held.size() ; k++){
+					if (k != 0) text += " ";
+					text += held[k];
+				}
+				text += "\n";
+				held.clear();
+			}
+
+			bool ended = false;
+			for (size_t k = 0 ; k < col_names.size() ; k++){
+
+				size_t count;
+				switch(col_types[k]){
+					case('d'):
+						count = batch.doubles(k).size();
+						break;
+					case('b'):
+						count = batch.bools(k).size();
+						break;
+					default:
+						count = batch.strings(k).size();
+						break;
+				}
+				if (r >= count){ //Column has ended
+					ended = true;
+					continue;
+				}
+
+				if (ended){
+					err_str = sources[batch_file] + ": Column '" + col_names[k] + "' continues after an earlier selected column ended.";
+					out.close();
+					std::remove(fileOut.c_str());
+					return false;
+				}
+
+				std::string cell;
+				switch(col_types[k]){
+					case('d'):
+						cell = element_string(batch.doubles(k)[r]);
+						break;
+					case('b'):
+						cell = element_string(batch.bools(k)[r]);
+						break;
+					default:
+						cell = element_string(batch.strings(k)[r]);
+						break;
+				}
+				if (batch.rowEnds(k)[r]){
+					cell += ";";
+					is_2d[k] = true;
+				}
+				held.push_back(cell);
+				file_counts[k]++;
+			}
+
+			file_rows++;
+		}
+
+		have_batch = next(batch, rows);
+	}
+
+	if (err_str != ""){ //Don't leave half a merge behind
+		out.close();
+		std::remove(fileOut.c_str());
+		return false;
+	}
+
+	out << "#VERTICAL\n";
+
+	if (!out.good()){
+		err_str = "Failed to write file '" + fileOut + "'.";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+Appends every remaining value of the m<d> column 'column' to 'out'. Returns
+false and sets the error string on failure.
+*/
+bool DDFMerge::read(std::string column, std::vector<double>& out, size_t rows){
+
+	size_t k = findColumn(column, 'd');
+	if (k == DDF_NPOS) return false;
+
+	DDFBatch batch;
+	while (next(batch, rows)){
+		DDFSpan<double> v = batch.doubles(k);
+		out.insert(out.end(), v.begin(), v.end());
+	}
+
+	return (err_str == "");
+}
+
+/*
+Appends every remaining value of the m<b> column 'column' to 'out'.
+*/
+bool DDFMerge::read(std::string column, std::vector<bool>& out, size_t rows){
+
+	size_t k = findColumn(column, 'b');
+	if (k == DDF_NPOS) return false;
+
+	DDFBatch batch;
+	while (next(batch, rows)){
+		DDFSpan<bool> v = batch.bools(k);
+		out.insert(out.end(), v.begin(), v.end());
+	}
+
+	return (err_str == "");
+}
+
+/*
+Appends every remaining value of the m<s> column 'column' to 'out'.
+*/
+bool DDFMerge::read(std::string column, std::vector<std::string>& out, size_t rows){
+
+	size_t k = findColumn(column, 's');
+	if (k == DDF_NPOS) return false;
+
+	DDFBatch batch;
+	while (next(batch, rows)){
+		DDFSpan<std::string> v = batch.strings(k);
+		out.insert(out.end(), v.begin(), v.end());
+	}
+
+	return (err_str == "");
+}
+
+//***************************************************************************//
+//***************** STATUS
+
+/*
+Returns the names of the merged columns.
+*/
+std::vector<std::string> DDFMerge::names() const{
+	return col_names;
+}
+
+/*
+Returns the type characters of the merged columns.
+*/
+std::string DDFMerge::types() const{
+	return col_types;
+}
+
+/*
+Returns the error status
+*/
+std::string DDFMerge::err() const{
+	return err_str;
+}
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Reads the next batch from the current file, opening the next file when it
+runs out. Sets 'fileIdx' to the file the batch came from and 'errOut' on
+error.
+*/
+bool DDFMerge::fill(DDFBatch& batch, size_t rows, size_t& fileIdx, std::string& errOut){
+
+	while (current < sources.size()){
+
+		if (rd.next(batch, rows)){
+			fileIdx = current;
+			return true;
+		}
+
+		if (rd.err() != ""){
+			errOut = sources[current] + ": " + rd.err();
+			current = sources.size();
+			return false;
+		}
+
+		current++;
+		if (current == sources.size()){
+			rd.close();
+			break;
+		}
+
+		if (!rd.open(sources[current], block_num, selection)){
+			errOut = sources[current] + ": " + rd.err();
+			current = sources.size();
+			return false;
+		}
+	}
+
+	return false;
+}
+
+/*
+Starts reading the next batch on the thread pool.
+*/
+void DDFMerge::prefetch(size_t rows){
+
+	if (current >= sources.size()) return;
+
+	ahead_rows = rows;
+	ahead_err = "";
+	in_flight = 1;
+	workers->submit([this, rows](){
+		DDFTaskDone done(in_flight);
+		ahead_ok = fill(ahead, rows, ahead_file, ahead_err);
+	});
+}
+
+/*
+Waits for a background read to finish.
+*/
+void DDFMerge::finish(){
+	if (workers != nullptr) workers->wait(in_flight);
+}
+
+/*
+Returns the index of merged column 'column', or DDF_NPOS (and sets the error
+string) if there is none or it isn't of type 'type'.
+*/
+size_t DDFMerge::findColumn(std::string column, char type){
+
+	size_t k = 0;
+	while (k < col_names.size() && col_names[k] != column) k++;
+	if (k == col_names.size()){
+		err_str = "Column '" + column + "' is not being merged.";
+		return DDF_NPOS;
+	}
+	if (col_types[k] != type){
+		err_str = "Column '" + column + "' is m<" + col_types[k] + ">, not m<" + type + ">.";
+		return DDF_NPOS;
+	}
+
+	return k;
+}
+
+#endif
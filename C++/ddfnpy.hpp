@@ -0,0 +1,524 @@
+#ifndef DDFNPY_HPP
+#define DDFNPY_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "cppddf.hpp"
+#include "ddfstream.hpp"
+
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+/*
+Exchange of m<d> and m<b> matrices with NumPy's .npy format, so data can be
+handed to Python without going through text.
+
+	saveNpy(ddf, "Vout", "Vout.npy", err);				//From a loaded DDFIO
+	streamNpy("log.ddf", "V", "V.npy", err);			//From a vertical block, streamed
+	loadNpy(ddf, "Vout.npy", "Vout", err);				//Into a DDFIO
+
+	>>> V = numpy.load("V.npy", mmap_mode="r")
+
+Arrays are written in C order as float64 ('<f8'), or float32 ('<f4') for
+matrices stored in single precision, or bool ('|b1'). 1D matrices become 1D
+arrays and 2D matrices 2D arrays; ragged 2D matrices can't be exported. Values
+are copied bit for bit, so a round trip gives back exactly the same data.
+
+loadNpy() memory-maps the file and copies the array once into the DDFIO's
+storage. float32 arrays are kept in single precision (see
+DDFIO::storeAsFloat()).
+*/
+
+#define DDF_NPY_HEADER 128 //Header size reserved by streamNpy(), so the shape can be filled in afterwards
+#define DDF_NPY_ROWS 65536 //Rows per batch in streamNpy()
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+/*
+Contents of a .npy header.
+*/
+typedef struct{
+	std::string descr;		//eg. "<f8"
+	bool fortran_order;
+	std::vector<size_t> shape;
+	size_t data_offset;		//Bytes before the array data
+}DDFNpyHeader;
+
+//***************************************************************************//
+//**			FUNCTION DECLARATIONS									   **//
+//***************************************************************************//
+
+bool saveNpy(const DDFIO& ddf, std::string varName, std::string fileOut, std::string& err);
+bool streamNpy(std::string fileIn, std::string column, std::string fileOut, std::string& err, size_t block=0);
+bool loadNpy(DDFIO& ddf, std::string fileIn, std::string varName, std::string& err, std::string desc="");
+
+std::string npy_header(std::string descr, const std::vector<size_t>& shape, size_t min_len=0);
+bool npy_parse_header(const char* data, size_t len, DDFNpyHeader& out);
+bool npy_fits(const std::vector<size_t>& shape, size_t avail, size_t& elements);
+template<typename T>
+void npy_add(DDFIO& ddf, const char* p, size_t rows, size_t cols, bool two_d, const std::string& varName, const std::string& desc);
+bool npy_little_endian();
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+/*
+Writes the m<d> or m<b> matrix 'varName' of 'ddf' to 'fileOut' as a .npy file.
+Doubles and floats are written straight from the variable's storage. Returns
+false and sets 'err' on failure.
+*/
+bool saveNpy(const DDFIO& ddf, std::string varName, std::string fileOut, std::string& err){
+
+	DDFVarInfo v;
+	if (!ddf.info(varName, v)){
+		err = "Variable '" + varName + "' not found.";
+		return false;
+	}
+	if (v.dims == 0 || v.type == 's'){
+		err = "Only m<d> and m<b> matrices can be saved as .npy.";
+		return false;
+	}
+	if (v.dims == 2 && v.elements != v.rows * v.cols){
+		err = "Matrix '" + varName + "' has rows of different lengths.";
+		return false;
+	}
+	if (!npy_little_endian()){
+		err = "Writing .npy files is only supported on little-endian machines.";
+		return false;
+	}
+
+	std::vector<size_t> shape;
+	if (v.dims == 2) shape.push_back(v.rows);
+	shape.push_back((v.dims == 2) ? v.cols : v.elements);
+
+	std::string descr = (v.type == 'b') ? "|b1" : (v.single ? "<f4" : "<f8");
+
+	std::ofstream out(fileOut.c_str(), std::ios::out | std::ios::binary);
+	if (!out.is_open()){
+		err = "Failed to open file '" + fileOut + "'.";
+		return false;
+	}
+	out << npy_header(descr, shape);
+
+	const DDFValue& val = *v.value;
+	std::vector<unsigned char> bytes; //For bools, which std::vector packs
+	switch(val.index()){
+		case(DDF_MD):{
+			const std::pmr::vector<double>& m = std::get<DDF_MD>(val);
+			out.write((const char*)m.data(), m.size()*sizeof(double));
+			break;}
+		case(DDF_MF):{
+			const std::pmr::vector<float>& m = std::get<DDF_MF>(val);
+			out.write((const char*)m.data(), m.size()*sizeof(float));
+			break;}
+		case(DDF_MD2):
+			for (const std::pmr::vector<double>& row : std::get<DDF_MD2>(val)){
+				out.write((const char*)row.data(), row.size()*sizeof(double));
+			}
+			break;
+		case(DDF_MF2):
+			for (const std::pmr::vector<float>& row : std::get<DDF_MF2>(val)){
+				out.write((const char*)row.data(), row.size()*sizeof(float));
+			}
+			break;
+		case(DDF_MB):
+			bytes.assign(std::get<DDF_MB>(val).begin(), std::get<DDF_MB>(val).end());
+			out.write((const char*)bytes.data(), bytes.size());
+			break;
+		case(DDF_MB2):
+			for (const std::pmr::vector<bool>& row : std::get<DDF_MB2>(val)){
+				bytes.assign(row.begin(), row.end());
+				out.write((const char*)bytes.data(), bytes.size());
+			}
+			break;
+	}
+
+	if (!out.good()){
+		err = "Failed to write file '" + fileOut + "'.";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+Writes the m<d> or m<b> column 'column' of vertical block 'block' of 'fileIn'
+to 'fileOut' as a .npy file, streaming it so the column never has to fit in
+memory. A column holding a 2D matrix (rows ended by ';') is written as a 2D
+array if its rows are all the same length. Returns false and sets 'err' on
+failure.
+*/
+bool streamNpy(std::string fileIn, std::string column, std::string fileOut, std::string& err, size_t block){
+
+	if (!npy_little_endian()){
+		err = "Writing .npy files is only supported on little-endian machines.";
+		return false;
+	}
+
+	DDFVerticalReader rd;
+	if (!rd.open(fileIn, block, {column})){
+		err = rd.err();
+		return false;
+	}
+
+	char type = rd.types()[0];
+	if (type == 's'){
+		err = "Only m<d> and m<b> columns can be saved as .npy.";
+		return false;
+	}
+	std::string descr = (type == 'b') ? "|b1" : "<f8";
+
+	std::ofstream out(fileOut.c_str(), std::ios::out | std::ios::binary);
+	if (!out.is_open()){
+		err = "Failed to open file '" + fileOut + "'.";
+		return false;
+	}
+
+	//Leave room for the header, which is written once the shape is known
+	out << std::string(DDF_NPY_HEADER, ' ');
+
+	size_t count = 0;
+	size_t rows = 0;
+	size_t cols = 0;		//Length of the first row
+	size_t row_len = 0;		//Elements in the current row
+	bool rectangular = true;
+
+	DDFBatch batch;
+	std::vector<unsigned char> bytes;
+	while (rd.next(batch, DDF_NPY_ROWS)){
+
+		if (type == 'd'){
+			DDFSpan<double> v = batch.doubles(0);
+			out.write((const char*)v.data(), v.size()*sizeof(double));
+		}else{
+			DDFSpan<bool> v = batch.bools(0);
+			bytes.assign(v.begin(), v.end());
+			out.write((const char*)bytes.data(), bytes.size());
+		}
+
+		DDFSpan<bool> ends = batch.rowEnds(0);
+		for (size_t i = 0 ; i < ends.size() ; i++){
+			row_len++;
+			if (!ends[i]) continue;
+			if (rows == 0) cols = row_len;
+			else if (row_len != cols) rectangular = false;
+			rows++;
+			row_len = 0;
+		}
+		count += ends.size();
+	}
+
+	if (rd.err() != ""){
+		err = rd.err();
+		out.close();
+		std::remove(fileOut.c_str());
+		return false;
+	}
+
+	//Elements after the last ';' form the last row
+	if (rows > 0 && row_len > 0){
+		if (row_len != cols) rectangular = false;
+		rows++;
+	}
+
+	if (!rectangular){
+		err = "Column '" + column + "' has rows of different lengths.";
+		out.close();
+		std::remove(fileOut.c_str());
+		return false;
+	}
+
+	std::vector<size_t> shape;
+	if (rows > 0){
+		shape.push_back(rows);
+		shape.push_back(cols);
+	}else{
+		shape.push_back(count);
+	}
+
+	out.seekp(0);
+	out << npy_header(descr, shape, DDF_NPY_HEADER);
+
+	if (!out.good()){
+		err = "Failed to write file '" + fileOut + "'.";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+Reads a 1D or 2D float64, float32 or bool array from the .npy file 'fileIn'
+and adds it to 'ddf' as the matrix 'varName'. The file is memory-mapped rather
+than read into a buffer. Returns false and sets 'err' on failure.
+*/
+bool loadNpy(DDFIO& ddf, std::string fileIn, std::string varName, std::string& err, std::string desc){
+
+	if (ddf.contains(varName)){
+		err = "Variable '" + varName + "' already exists.";
+		return false;
+	}
+
+	//Map the file
+#ifdef _WIN32
+	std::ifstream file(fileIn.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open()){
+		err = "Failed to open file '" + fileIn + "'.";
+		return false;
+	}
+	std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	const char* data = contents.data();
+	size_t len = contents.size();
+#else
+	int fd = open(fileIn.c_str(), O_RDONLY);
+	if (fd < 0){
+		err = "Failed to open file '" + fileIn + "'.";
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0){
+		err = "Failed to read file '" + fileIn + "'.";
+		::close(fd);
+		return false;
+	}
+	size_t len = st.st_size;
+
+	void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED){
+		err = "Failed to map file '" + fileIn + "'.";
+		return false;
+	}
+	const char* data = (const char*)map;
+#endif
+
+	DDFNpyHeader h;
+	bool ok = npy_parse_header(data, len, h);
+
+	size_t elements = 0;
+	size_t width = (h.descr == "<f8") ? 8 : ((h.descr == "<f4") ? 4 : 1);
+
+	if (!ok){
+		err = "File '" + fileIn + "' is not a .npy file.";
+	}else if (h.descr != "<f8" && h.descr != "<f4" && h.descr != "|b1"){
+		err = "Unsupported .npy type '" + h.descr + "'. Only float64, float32 and bool arrays can be loaded.";
+		ok = false;
+	}else if (!npy_little_endian() && h.descr != "|b1"){
+		err = "Reading .npy files is only supported on little-endian machines.";
+		ok = false;
+	}else if (h.fortran_order && h.shape.size() == 2){
+		err = "Fortran-ordered arrays aren't supported.";
+		ok = false;
+	}else if (h.shape.size() != 1 && h.shape.size() != 2){
+		err = "Only 1D and 2D arrays can be loaded.";
+		ok = false;
+	}else if (!npy_fits(h.shape, (len - h.data_offset)/width, elements)){
+		err = "File '" + fileIn + "' is truncated.";
+		ok = false;
+	}
+
+	if (ok){
+
+		const char* p = data + h.data_offset;
+		size_t rows = (h.shape.size() == 2) ? h.shape[0] : 1;
+		size_t cols = h.shape.back();
+
+		if (h.descr == "|b1"){
+			if (h.shape.size() == 1){
+				std::pmr::vector<bool> m(cols, ddf.resource());
+				for (size_t j = 0 ; j < cols ; j++) m[j] = (p[j] != 0);
+				ddf.add(std::move(m), varName, desc);
+			}else{
+				std::pmr::vector<std::pmr::vector<bool> > m(rows, ddf.resource());
+				for (size_t i = 0 ; i < rows ; i++){
+					m[i].resize(cols);
+					for (size_t j = 0 ; j < cols ; j++) m[i][j] = (p[i*cols + j] != 0);
+				}
+				ddf.add(std::move(m), varName, desc);
+			}
+		}else if (h.descr == "<f4"){
+			ddf.storeAsFloat(varName); //Set first, so add() keeps the floats
+			npy_add<float>(ddf, p, rows, cols, h.shape.size() == 2, varName, desc);
+		}else{
+			npy_add<double>(ddf, p, rows, cols, h.shape.size() == 2, varName, desc);
+		}
+
+		if (!ddf.contains(varName)){
+			err = "Invalid variable name '" + varName + "'.";
+			ok = false;
+		}
+	}
+
+#ifndef _WIN32
+	munmap(map, len);
+#endif
+
+	return ok;
+}
+
+/*
+Returns the .npy version 1.0 preamble and header for an array of type 'descr'
+and shape 'shape', padded with spaces to a multiple of 64 bytes and to at least
+'min_len' bytes.
+*/
+std::string npy_header(std::string descr, const std::vector<size_t>& shape, size_t min_len){
+
+	std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+	for (size_t i = 0 ; i < shape.size() ; i++){
+		if (i != 0) dict += ", ";
+		dict += std::to_string(shape[i]);
+	}
+	if (shape.size() == 1) dict += ",";
+	dict += "), }";
+
+	size_t total = 10 + dict.length() + 1; //Preamble, dictionary and '\n'
+	if (total < min_len) total = min_len;
+	total = (total + 63) / 64 * 64;
+	dict += std::string(total - 10 - dict.length() - 1, ' ') + "\n";
+
+	std::string out = "\x93NUMPY";
+	out += '\x01';
+	out += '\x00';
+	out += (char)(dict.length() & 0xFF);
+	out += (char)((dict.length() >> 8) & 0xFF);
+
+	return out + dict;
+}
+
+/*
+Reads the header of the .npy data 'data' (version 1.x, 2.x or 3.x). Returns
+false if it isn't a valid .npy header.
+*/
+bool npy_parse_header(const char* data, size_t len, DDFNpyHeader& out){
+
+	if (len < 10 || memcmp(data, "\x93NUMPY", 6) != 0) return false;
+
+	unsigned char major = data[6];
+	size_t hlen;
+	size_t pre;
+	if (major == 1){
+		hlen = (unsigned char)data[8] | ((size_t)(unsigned char)data[9] << 8);
+		pre = 10;
+	}else if (major == 2 || major == 3){
+		if (len < 12) return false;
+		hlen = 0;
+		for (int i = 3 ; i >= 0 ; i--) hlen = (hlen << 8) | (unsigned char)data[8+i];
+		pre = 12;
+	}else{
+		return false;
+	}
+	if (pre + hlen > len) return false;
+
+	std::string dict(data + pre, hlen);
+	out.data_offset = pre + hlen;
+
+	//descr
+	size_t k = dict.find("'descr'");
+	if (k == std::string::npos) return false;
+	size_t q1 = dict.find('\'', dict.find(':', k));
+	size_t q2 = (q1 == std::string::npos) ? q1 : dict.find('\'', q1+1);
+	if (q2 == std::string::npos) return false;
+	out.descr = dict.substr(q1+1, q2-q1-1);
+	if (out.descr == "=f8" || out.descr == "=f4") out.descr[0] = npy_little_endian() ? '<' : '>';
+	if (out.descr == "?" || out.descr == "|?" || out.descr == "b1") out.descr = "|b1";
+
+	//fortran_order
+	k = dict.find("'fortran_order'");
+	if (k == std::string::npos) return false;
+	k = dict.find_first_not_of(" :", k + 15);
+	out.fortran_order = (k != std::string::npos && dict.compare(k, 4, "True") == 0);
+
+	//shape
+	k = dict.find("'shape'");
+	size_t lp = (k == std::string::npos) ? k : dict.find('(', k);
+	size_t rp = (lp == std::string::npos) ? lp : dict.find(')', lp);
+	if (rp == std::string::npos) return false;
+	out.shape.clear();
+	const char* s = dict.c_str() + lp + 1;
+	const char* end = dict.c_str() + rp;
+	while (s < end){
+		char* next;
+		unsigned long long n = strtoull(s, &next, 10);
+		if (next == s){
+			s++;
+			continue;
+		}
+		out.shape.push_back((size_t)n);
+		s = next;
+	}
+
+	return true;
+}
+
+/*
+Sets 'elements' to the number of elements in an array of shape 'shape'.
+Returns false if there are more than 'avail', checking each step so the
+product can't overflow.
+*/
+bool npy_fits(const std::vector<size_t>& shape, size_t avail, size_t& elements){
+
+	elements = 0;
+	for (size_t i = 0 ; i < shape.size() ; i++){
+		if (shape[i] == 0) return true;
+	}
+
+	elements = 1;
+	for (size_t i = 0 ; i < shape.size() ; i++){
+		if (elements > avail / shape[i]) return false;
+		elements *= shape[i];
+	}
+
+	return true;
+}
+
+/*
+Adds the 'rows' x 'cols' array of T at 'p' (a 1D array of 'cols' elements if
+'two_d' is false) to 'ddf' as the matrix 'varName'. Each row is copied straight
+from 'p' into a matrix built on the object's memory resource, so add() takes
+it over without another copy.
+*/
+template<typename T>
+void npy_add(DDFIO& ddf, const char* p, size_t rows, size_t cols, bool two_d, const std::string& varName, const std::string& desc){
+
+	if (!two_d){
+		std::pmr::vector<T> m(cols, ddf.resource());
+		if (cols > 0) memcpy(m.data(), p, cols*sizeof(T));
+		ddf.add(std::move(m), varName, desc);
+		return;
+	}
+
+	std::pmr::vector<std::pmr::vector<T> > m(rows, ddf.resource());
+	for (size_t i = 0 ; i < rows ; i++){
+		m[i].resize(cols);
+		if (cols > 0) memcpy(m[i].data(), p + i*cols*sizeof(T), cols*sizeof(T));
+	}
+	ddf.add(std::move(m), varName, desc);
+}
+
+/*
+Returns true if the machine stores numbers little-endian, as the .npy files
+written here do.
+*/
+bool npy_little_endian(){
+	uint16_t x = 1;
+	unsigned char b;
+	memcpy(&b, &x, 1);
+	return (b == 1);
+}
+
+#endif
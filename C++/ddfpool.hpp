@@ -0,0 +1,317 @@
+#ifndef DDFPOOL_HPP
+#define DDFPOOL_HPP
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+/*
+Work-stealing thread pool. Each worker owns a deque of tasks. A worker pops
+new work from the back of its own deque and, when that runs dry, steals from
+the front of the other workers' deques. This keeps every core busy when the
+tasks are very uneven in size (eg. a few huge files among many small ones).
+
+Tasks submitted from outside the pool are dealt round-robin to the workers.
+Tasks submitted from inside a worker go to that worker's own deque. Since a
+worker takes its newest task first, submit a batch smallest first to have the
+biggest tasks started first.
+*/
+class DDFThreadPool{
+public:
+
+	//************ INITIALIZERS
+
+	DDFThreadPool(size_t threads=0);
+	~DDFThreadPool();
+
+	//************ TASKS
+
+	void submit(std::function<void()> task);
+	void wait();
+	void wait(std::atomic<size_t>& remaining);
+
+	size_t size();
+
+	static DDFThreadPool& shared();
+
+private:
+
+	typedef struct{
+		std::mutex mtx;
+		std::deque<std::function<void()> > tasks;
+	}DDFWorkQueue;
+
+	std::vector<std::unique_ptr<DDFWorkQueue> > queues;
+	std::vector<std::thread> workers;
+
+	std::mutex wake_mtx;
+	std::condition_variable wake_cv; //Signals workers that work was added or pool is stopping
+	std::condition_variable idle_cv; //Signals wait() that pending reached zero
+
+	std::atomic<size_t> pending; //Tasks submitted but not yet finished
+	std::atomic<size_t> next_queue; //Round-robin counter for external submissions
+	bool stopping;
+
+	void workerLoop(size_t id);
+	void helpUntil(std::function<bool()> done);
+	bool takeTask(size_t id, std::function<void()>& task);
+	void runTask(std::function<void()>& task);
+
+	static DDFThreadPool*& currentPool();
+	static size_t& currentWorker();
+};
+
+/*
+Counts a task of a group as finished when it goes out of scope. Declare one at
+the top of each task whose group is waited on with wait(remaining), so the
+wait returns even if the task throws.
+
+	pool.submit([&remaining](){
+		DDFTaskDone done(remaining);
+		...
+	});
+*/
+class DDFTaskDone{
+public:
+	DDFTaskDone(std::atomic<size_t>& remaining) : count(remaining){}
+	~DDFTaskDone(){ count--; }
+private:
+	std::atomic<size_t>& count;
+};
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** INITIALIZERS
+
+/*
+Starts the pool. If 'threads' is zero, one worker is started per hardware
+thread.
+*/
+DDFThreadPool::DDFThreadPool(size_t threads){
+
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+
+	pending = 0;
+	next_queue = 0;
+	stopping = false;
+
+	for (size_t i = 0 ; i < threads ; i++){
+		queues.push_back(std::unique_ptr<DDFWorkQueue>(new DDFWorkQueue));
+	}
+
+	for (size_t i = 0 ; i < threads ; i++){
+		workers.push_back(std::thread(&DDFThreadPool::workerLoop, this, i));
+	}
+}
+
+/*
+Finishes all queued tasks, then stops and joins the workers.
+*/
+DDFThreadPool::~DDFThreadPool(){
+
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lock(wake_mtx);
+		stopping = true;
+	}
+	wake_cv.notify_all();
+
+	for (size_t i = 0 ; i < workers.size() ; i++){
+		workers[i].join();
+	}
+}
+
+//***************************************************************************//
+//***************** TASKS
+
+/*
+Adds a task to the pool.
+*/
+void DDFThreadPool::submit(std::function<void()> task){
+
+	//Pick queue - own queue if called from one of this pool's workers
+	size_t q;
+	if (currentPool() == this){
+		q = currentWorker();
+	}else{
+		q = next_queue++ % queues.size();
+	}
+
+	pending++;
+	{
+		std::lock_guard<std::mutex> lock(queues[q]->mtx);
+		queues[q]->tasks.push_back(task);
+	}
+
+	{ //Lock so a worker can't miss the notification between its check and its wait
+		std::lock_guard<std::mutex> lock(wake_mtx);
+	}
+	wake_cv.notify_one();
+}
+
+/*
+Blocks until every submitted task has finished. The calling thread helps by
+running queued tasks while it waits. Must not be called from inside a task,
+as that task counts as unfinished - use wait(remaining) there instead.
+*/
+void DDFThreadPool::wait(){
+	assert(currentPool() != this);
+	helpUntil([this]{ return pending == 0; });
+}
+
+/*
+Blocks until 'remaining' reaches zero. Lets a caller wait for its own group of
+tasks (each task decrements the counter when done, see DDFTaskDone) without
+waiting on other users of a shared pool. Safe to call from inside a task.
+*/
+void DDFThreadPool::wait(std::atomic<size_t>& remaining){
+	helpUntil([&remaining]{ return remaining == 0; });
+}
+
+/*
+Returns the number of worker threads.
+*/
+size_t DDFThreadPool::size(){
+	return workers.size();
+}
+
+/*
+Returns a process-wide pool sized to the hardware. Used by default wherever a
+pool is optional.
+*/
+DDFThreadPool& DDFThreadPool::shared(){
+	static DDFThreadPool pool;
+	return pool;
+}
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Main loop of worker 'id'. Runs tasks until the pool is stopped.
+*/
+void DDFThreadPool::workerLoop(size_t id){
+
+	currentPool() = this;
+	currentWorker() = id;
+
+	std::function<void()> task;
+	while (true){
+
+		if (takeTask(id, task)){
+			runTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wake_mtx);
+		if (stopping) break;
+		wake_cv.wait_for(lock, std::chrono::milliseconds(10));
+		if (stopping && pending == 0) break;
+	}
+
+	currentPool() = nullptr;
+}
+
+/*
+Runs queued tasks on the calling thread until 'done' returns true.
+*/
+void DDFThreadPool::helpUntil(std::function<bool()> done){
+
+	size_t id = (currentPool() == this) ? currentWorker() : 0;
+
+	std::function<void()> task;
+	while (!done()){
+
+		if (takeTask(id, task)){
+			runTask(task);
+			continue;
+		}
+
+		//Nothing left to steal - remaining tasks are running elsewhere
+		std::unique_lock<std::mutex> lock(wake_mtx);
+		idle_cv.wait_for(lock, std::chrono::milliseconds(1), done);
+	}
+}
+
+/*
+Takes the next task for worker 'id': newest task from its own deque, else the
+oldest task from another worker's deque. Returns false if all deques are empty.
+*/
+bool DDFThreadPool::takeTask(size_t id, std::function<void()>& task){
+
+	//Check own queue (LIFO - keeps recently touched data in cache)
+	{
+		std::lock_guard<std::mutex> lock(queues[id]->mtx);
+		if (!queues[id]->tasks.empty()){
+			task = std::move(queues[id]->tasks.back());
+			queues[id]->tasks.pop_back();
+			return true;
+		}
+	}
+
+	//Steal from others (FIFO - takes the work the owner will reach last)
+	for (size_t k = 1 ; k < queues.size() ; k++){
+		size_t victim = (id + k) % queues.size();
+		std::lock_guard<std::mutex> lock(queues[victim]->mtx);
+		if (!queues[victim]->tasks.empty()){
+			task = std::move(queues[victim]->tasks.front());
+			queues[victim]->tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+Runs a task and updates the pending count. Exceptions are swallowed so one bad
+task can't take down the pool - tasks should report their own errors.
+*/
+void DDFThreadPool::runTask(std::function<void()>& task){
+
+	try{
+		task();
+	}catch(...){
+	}
+	task = nullptr;
+
+	if (--pending == 0){
+		std::lock_guard<std::mutex> lock(wake_mtx);
+		idle_cv.notify_all();
+	}
+}
+
+/*
+Pool that owns the calling thread, or nullptr if it is not a pool worker.
+*/
+DDFThreadPool*& DDFThreadPool::currentPool(){
+	static thread_local DDFThreadPool* pool = nullptr;
+	return pool;
+}
+
+/*
+Index of the calling worker thread within currentPool().
+*/
+size_t& DDFThreadPool::currentWorker(){
+	static thread_local size_t id = 0;
+	return id;
+}
+
+#endif
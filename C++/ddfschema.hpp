@@ -0,0 +1,827 @@
+#ifndef DDFSCHEMA_HPP
+#define DDFSCHEMA_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "cppddf.hpp"
+
+/*
+Compile-time schema binding. Declares how the variables of a DDF file map onto
+the members of a C++ struct, then loads and writes that struct directly:
+
+	struct Run{
+		double x;
+		std::vector<double> Vout;
+		std::vector<std::vector<double> > V2d;
+	};
+
+	auto schema = ddfSchema(
+		ddfField("X", &Run::x, "I am a description"),
+		ddfField("Vout", &Run::Vout),
+		ddfField("Vec_2D", &Run::V2d)
+	);
+
+	Run r;
+	if (!schema.load("run.ddf", r)) std::cout << schema.err() << std::endl;
+
+Member types are checked at compile time - they must be double, bool,
+std::string, or a 1D or 2D std::vector of those. The loader looks fields up by
+a name hash computed at compile time and parses each value straight into its
+member, without going through DDFIO's item structs. Variables in the file that
+aren't in the schema are skipped; fields missing from the file are an error.
+*/
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+/*
+FNV-1a hash of a null-terminated string. constexpr, so field name hashes are
+computed at compile time.
+*/
+constexpr uint64_t ddf_hash(const char* s, uint64_t h=14695981039346656037ULL){
+	return (*s == '\0') ? h : ddf_hash(s+1, (h ^ static_cast<unsigned char>(*s)) * 1099511628211ULL);
+}
+
+/*
+FNV-1a hash of 'n' characters, for names found at runtime. Matches ddf_hash().
+*/
+uint64_t ddf_hash_n(const char* s, size_t n){
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0 ; i < n ; i++){
+		h = (h ^ static_cast<unsigned char>(s[i])) * 1099511628211ULL;
+	}
+	return h;
+}
+
+/*
+Maps a member type to its DDF type character and number of dimensions. Only
+the specializations below exist - any other member type fails to compile.
+*/
+template<typename M>
+struct DDFTypeOf{
+	static_assert(sizeof(M) == 0, "DDF schema members must be double, bool, std::string, or a 1D/2D std::vector of these.");
+};
+
+template<> struct DDFTypeOf<double>{ static const char type = 'd'; static const int dims = 0; };
+template<> struct DDFTypeOf<bool>{ static const char type = 'b'; static const int dims = 0; };
+template<> struct DDFTypeOf<std::string>{ static const char type = 's'; static const int dims = 0; };
+template<> struct DDFTypeOf<std::vector<double> >{ static const char type = 'd'; static const int dims = 1; };
+template<> struct DDFTypeOf<std::vector<bool> >{ static const char type = 'b'; static const int dims = 1; };
+template<> struct DDFTypeOf<std::vector<std::string> >{ static const char type = 's'; static const int dims = 1; };
+template<> struct DDFTypeOf<std::vector<std::vector<double> > >{ static const char type = 'd'; static const int dims = 2; };
+template<> struct DDFTypeOf<std::vector<std::vector<bool> > >{ static const char type = 'b'; static const int dims = 2; };
+template<> struct DDFTypeOf<std::vector<std::vector<std::string> > >{ static const char type = 's'; static const int dims = 2; };
+
+/*
+One entry of a schema: a DDF variable name, its hash, the struct member it maps
+to and an optional description (written by DDFSchema::write).
+*/
+template<typename S, typename M>
+struct DDFField{
+	const char* name;
+	uint64_t hash;
+	M S::* member;
+	const char* desc;
+
+	static_assert(DDFTypeOf<M>::dims >= 0, "Unsupported member type."); //Fires DDFTypeOf's assert for bad types
+};
+
+/*
+Converts element text to a value - overloaded on the destination type so the
+template loaders can pick the right conversion.
+*/
+struct DDFElementTo{
+	bool operator()(const std::string& line, size_t first, size_t last, double& out) const { return element_to_double(line, first, last, out); }
+	bool operator()(const std::string& line, size_t first, size_t last, bool& out) const { return element_to_bool(line, first, last, out); }
+	bool operator()(const std::string& line, size_t first, size_t last, std::string& out) const { return element_to_string(line, first, last, out); }
+};
+
+/*
+The statement currently being loaded, handed to the schema_read() overloads.
+*/
+typedef struct{
+	const std::string* line;
+	const std::vector<DDFToken>* words;
+	DDFStructIndex* sidx;
+	std::string err; //Set on failure
+}DDFSchemaStatement;
+
+/*
+Receives one element of a vertical column: (line, first, last, row_end).
+*/
+typedef std::function<bool(const std::string&, size_t, size_t, bool)> DDFColumnSink;
+
+//***************************************************************************//
+//**			FUNCTION DECLARATIONS									   **//
+//***************************************************************************//
+
+bool schema_read(DDFSchemaStatement& st, double& out);
+bool schema_read(DDFSchemaStatement& st, bool& out);
+bool schema_read(DDFSchemaStatement& st, std::string& out);
+template<typename T>
+bool schema_read(DDFSchemaStatement& st, std::vector<T>& out);
+template<typename T>
+bool schema_read(DDFSchemaStatement& st, std::vector<std::vector<T> >& out);
+
+DDFColumnSink schema_sink(double& out);
+DDFColumnSink schema_sink(bool& out);
+DDFColumnSink schema_sink(std::string& out);
+template<typename T>
+DDFColumnSink schema_sink(std::vector<T>& out);
+template<typename T>
+DDFColumnSink schema_sink(std::vector<std::vector<T> >& out);
+
+std::string schema_format(double x);
+std::string schema_format(bool x);
+std::string schema_format(const std::string& x);
+template<typename T>
+std::string schema_format(const std::vector<T>& x);
+template<typename T>
+std::string schema_format(const std::vector<std::vector<T> >& x);
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+template<typename S, typename... Fields>
+class DDFSchema{
+public:
+
+	//************ INITIALIZERS
+
+	DDFSchema(Fields... f);
+
+	//************ FILE I/O
+
+	bool load(std::string fileIn, S& out);
+	bool load(std::istream& file, S& out);
+	std::string swrite(const S& in, std::string options="");
+	bool write(std::string fileOut, const S& in, std::string options="");
+
+	//************ STATUS
+
+	std::string getHeader();
+	std::string err();
+
+private:
+
+	std::tuple<Fields...> fields;
+	uint64_t hashes[sizeof...(Fields)]; //Field name hashes, in field order
+
+	std::string header;
+	std::string err_str;
+
+	size_t findField(const char* name, size_t len);
+	const char* fieldName(size_t idx);
+
+	//Visit field 'idx' with a functor - unrolled at compile time
+	template<size_t I, typename V>
+	typename std::enable_if<(I == sizeof...(Fields)), bool>::type visit(size_t idx, V& v);
+	template<size_t I, typename V>
+	typename std::enable_if<(I < sizeof...(Fields)), bool>::type visit(size_t idx, V& v);
+
+	//Functors passed to visit()
+	struct ReadInline{
+		S* obj;
+		DDFSchemaStatement* st;
+		char type;
+		template<typename M> bool operator()(DDFField<S, M>& f);
+	};
+	struct MakeSink{
+		S* obj;
+		char type;
+		DDFColumnSink sink;
+		std::string err;
+		template<typename M> bool operator()(DDFField<S, M>& f);
+	};
+	struct Write{
+		const S* obj;
+		std::string* out;
+		std::string term_char;
+		bool show_descriptions;
+		template<typename M> bool operator()(DDFField<S, M>& f);
+	};
+	struct Name{
+		const char* name;
+		template<typename M> bool operator()(DDFField<S, M>& f);
+	};
+};
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** BUILDERS
+
+/*
+Declares a schema field mapping DDF variable 'name' to struct member 'member'.
+*/
+template<typename S, typename M>
+constexpr DDFField<S, M> ddfField(const char* name, M S::* member, const char* desc=""){
+	return DDFField<S, M>{name, ddf_hash(name), member, desc};
+}
+
+/*
+Builds a schema from a list of ddfField()s. The struct type is deduced from
+the member pointers.
+*/
+template<typename S, typename... M>
+DDFSchema<S, DDFField<S, M>...> ddfSchema(DDFField<S, M>... fields){
+	return DDFSchema<S, DDFField<S, M>...>(fields...);
+}
+
+//***************************************************************************//
+//***************** INITIALIZERS
+
+template<typename S, typename... Fields>
+DDFSchema<S, Fields...>::DDFSchema(Fields... f) : fields(f...){
+
+	//Copy hashes into a flat array for fast lookup
+	uint64_t h[] = {f.hash...};
+	for (size_t i = 0 ; i < sizeof...(Fields) ; i++){
+		hashes[i] = h[i];
+	}
+}
+
+//***************************************************************************//
+//***************** FILE I/O
+
+/*
+Loads a DDF file into 'out'. Returns true if successful, else false (see
+err()). Members of 'out' not yet assigned when an error occurs keep their old
+values.
+*/
+template<typename S, typename... Fields>
+bool DDFSchema<S, Fields...>::load(std::string fileIn, S& out){
+
+	std::ifstream file(fileIn.c_str());
+	if (!file.is_open()){
+		err_str = "Failed to open file '" + fileIn + "'.";
+		return false;
+	}
+
+	return load(file, out);
+}
+
+/*
+Loads a DDF file from a stream into 'out'. See load() above.
+*/
+template<typename S, typename... Fields>
+bool DDFSchema<S, Fields...>::load(std::istream& file, S& out){
+
+	err_str = "";
+	header = "";
+
+	std::vector<bool> found(sizeof...(Fields), false);
+
+	std::string line;
+	std::vector<DDFToken> words;
+	DDFStructIndex sidx;
+	size_t lineNum = 0;
+
+	while (getline(file, line)){
+
+		lineNum++;
+
+		tokenize_line(line.c_str(), line.length(), ";[]", words);
+		if (words.size() < 1) continue; //Skip blank lines
+
+		if (token_is(words[0], "#VERSION")){
+
+			double version = (words.size() == 2) ? strtod(words[1].p, NULL) : 0;
+			if (version < 2 || version >= 3){
+				err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tUnsupported version statement.";
+				return false;
+			}
+
+		}else if (token_is(words[0], "#HEADER")){
+
+			size_t openedOnLine = lineNum;
+			bool foundHeader = false;
+			while (getline(file, line)){
+				lineNum++;
+				tokenize_line(line.c_str(), line.length(), "", words);
+				if (words.size() < 1) continue;
+				if (token_is(words[0], "#HEADER")){
+					foundHeader = true;
+					break;
+				}
+				header = (header.length() == 0) ? line : header + "\n" + line;
+			}
+
+			if (!foundHeader){
+				err_str = "Failed on line " + std::to_string(openedOnLine) + ".\n\tFailed to find closing #HEADER statement.";
+				return false;
+			}
+
+		}else if (words[0].len >= 2 && words[0].p[0] == '/' && words[0].p[1] == '/'){ //Comment
+
+			continue;
+
+		}else if (token_is(words[0], "d") || token_is(words[0], "b") || token_is(words[0], "s") || (words[0].len == 4 && words[0].p[0] == 'm' && words[0].p[1] == '<' && words[0].p[3] == '>')){
+
+			if (words.size() < 3){
+				err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tInsufficient number of tokens for inline variable statement.";
+				return false;
+			}
+
+			//Dispatch on name hash - skip variables not in the schema
+			size_t idx = findField(words[1].p, words[1].len);
+			if (idx == DDF_NPOS) continue;
+
+			DDFSchemaStatement st;
+			st.line = &line;
+			st.words = &words;
+			st.sidx = &sidx;
+
+			ReadInline reader;
+			reader.obj = &out;
+			reader.st = &st;
+			reader.type = (words[0].len == 1) ? 0 : words[0].p[2]; //0 for flat variables
+
+			if (!visit<0>(idx, reader)){
+				err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + std::string(words[1].p, words[1].len) + "': " + st.err;
+				return false;
+			}
+
+			found[idx] = true;
+
+		}else if (token_is(words[0], "#VERTICAL")){
+
+			size_t openedOnLine = lineNum;
+
+			//Read declaration lines: types, names, optional descriptions
+			std::vector<std::string> decl;
+			std::vector<size_t> decl_lines;
+			bool foundBlock = false;
+			bool in_data = false;
+
+			std::vector<DDFColumnSink> sinks;
+			size_t max_allowed = 0;
+
+			while (getline(file, line)){
+
+				lineNum++;
+
+				tokenize_line(line.c_str(), line.length(), "", words, true);
+				if (words.size() < 1) continue;
+				if (words[0].len >= 2 && words[0].p[0] == '/' && words[0].p[1] == '/') continue;
+
+				if (token_is(words[0], "#VERTICAL")){
+					foundBlock = true;
+					break;
+				}
+
+				//Drop trailing comment tokens
+				for (size_t i = 0 ; i < words.size() ; i++){
+					if (words[i].len >= 2 && words[i].p[0] == '/' && words[i].p[1] == '/'){
+						words.resize(i);
+						break;
+					}
+				}
+
+				if (!in_data){
+
+					//Descriptions are optional - the 3rd line is data if it doesn't start with '?'
+					if (decl.size() == 2 && line.find_first_not_of(" \t") != std::string::npos && line[line.find_first_not_of(" \t")] == '?'){
+						decl.push_back(line);
+						decl_lines.push_back(lineNum);
+						continue;
+					}
+
+					if (decl.size() >= 2){
+						in_data = true;
+					}else{
+
+						decl.push_back(line);
+						decl_lines.push_back(lineNum);
+						if (decl.size() < 2) continue;
+
+						//Names read - build one sink per column. Columns count
+						//as found even if the block has no rows
+						std::vector<DDFToken> types, names;
+						tokenize_line(decl[0].c_str(), decl[0].length(), "", types);
+						tokenize_line(decl[1].c_str(), decl[1].length(), "", names);
+						if (types.size() != names.size()){
+							err_str = "Failed on line " + std::to_string(decl_lines[0]) + ".\n\tNumber of type declarations, names, and descriptions (if present) must match.";
+							return false;
+						}
+
+						sinks.resize(names.size());
+						for (size_t i = 0 ; i < names.size() ; i++){
+
+							size_t idx = findField(names[i].p, names[i].len);
+							if (idx == DDF_NPOS) continue; //Column not in schema - ignored
+
+							MakeSink maker;
+							maker.obj = &out;
+							maker.type = (types[i].len == 4) ? types[i].p[2] : '?';
+							if (!visit<0>(idx, maker)){
+								err_str = "Failed on line " + std::to_string(decl_lines[0]) + ".\n\tFor variable '" + fieldName(idx) + "': " + maker.err;
+								return false;
+							}
+							sinks[i] = maker.sink;
+							found[idx] = true;
+						}
+
+						max_allowed = names.size();
+						continue;
+					}
+				}
+
+				//Data line
+				if (words.size() > max_allowed){
+					err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tToo many characters detected.";
+					return false;
+				}
+				max_allowed = words.size();
+
+				for (size_t i = 0 ; i < words.size() ; i++){
+
+					if (!sinks[i]) continue;
+
+					size_t first = words[i].idx;
+					size_t last = first + words[i].len;
+					bool row_end = (line[last-1] == ';');
+					if (row_end) last--;
+
+					if (!sinks[i](line, first, last, row_end)){
+						err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tFailed to convert '" + line.substr(first, last-first) + "'.";
+						return false;
+					}
+				}
+			}
+
+			if (!foundBlock){
+				err_str = "Failed on line " + std::to_string(openedOnLine) + ".\n\tFailed to find closing #VERTICAL statement.";
+				return false;
+			}
+
+		}else{
+			err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tUnidentified token '" + std::string(words[0].p, words[0].len) + "'";
+			return false;
+		}
+	}
+
+	//Check every field was present
+	for (size_t i = 0 ; i < found.size() ; i++){
+		if (!found[i]){
+			err_str = "Variable '" + std::string(fieldName(i)) + "' not found in file.";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+Formats 'in' as a DDF file and returns it as a string. Every field is written
+as an inline statement, in schema order, with the same number formatting as
+DDFIO::swrite.
+
+Options: (Order does not matter. Case-sensitive)
+	;: Terminate variable statements with the optional semicolon
+	u: Undocumented - variable descriptions are not printed
+*/
+template<typename S, typename... Fields>
+std::string DDFSchema<S, Fields...>::swrite(const S& in, std::string options){
+
+	std::string ddf = "#VERSION " + std::to_string(CURRENT_VERSION) + "\n";
+	if (header.length() > 0){
+		ddf += "#HEADER\n" + header + "\n#HEADER\n";
+	}
+
+	Write writer;
+	writer.obj = &in;
+	writer.out = &ddf;
+	writer.term_char = (options.find(";") != std::string::npos) ? ";" : "";
+	writer.show_descriptions = (options.find("u") == std::string::npos);
+
+	for (size_t i = 0 ; i < sizeof...(Fields) ; i++){
+		visit<0>(i, writer);
+	}
+
+	return ddf;
+}
+
+/*
+Writes 'in' to a DDF file. Returns true if successful. See swrite() for options.
+*/
+template<typename S, typename... Fields>
+bool DDFSchema<S, Fields...>::write(std::string fileOut, const S& in, std::string options){
+
+	std::ofstream out(fileOut);
+	if (!out.is_open()){
+		err_str = "Failed to open file '" + fileOut + "'.";
+		return false;
+	}
+
+	out << swrite(in, options);
+
+	return true;
+}
+
+//***************************************************************************//
+//***************** STATUS
+
+/*
+Returns the header of the last file loaded.
+*/
+template<typename S, typename... Fields>
+std::string DDFSchema<S, Fields...>::getHeader(){
+	return header;
+}
+
+/*
+Returns the error status
+*/
+template<typename S, typename... Fields>
+std::string DDFSchema<S, Fields...>::err(){
+	return err_str;
+}
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Returns the index of the field named by the 'len' characters at 'name', or
+DDF_NPOS if there is none. Compares hashes first, names only on a hash match.
+*/
+template<typename S, typename... Fields>
+size_t DDFSchema<S, Fields...>::findField(const char* name, size_t len){
+
+	uint64_t h = ddf_hash_n(name, len);
+	for (size_t i = 0 ; i < sizeof...(Fields) ; i++){
+		if (hashes[i] != h) continue;
+		const char* fn = fieldName(i);
+		if (strlen(fn) == len && memcmp(fn, name, len) == 0) return i;
+	}
+
+	return DDF_NPOS;
+}
+
+/*
+Returns the DDF name of field 'idx'.
+*/
+template<typename S, typename... Fields>
+const char* DDFSchema<S, Fields...>::fieldName(size_t idx){
+	Name v;
+	v.name = "";
+	visit<0>(idx, v);
+	return v.name;
+}
+
+template<typename S, typename... Fields>
+template<size_t I, typename V>
+typename std::enable_if<(I == sizeof...(Fields)), bool>::type DDFSchema<S, Fields...>::visit(size_t, V&){
+	return false;
+}
+
+template<typename S, typename... Fields>
+template<size_t I, typename V>
+typename std::enable_if<(I < sizeof...(Fields)), bool>::type DDFSchema<S, Fields...>::visit(size_t idx, V& v){
+	if (idx == I) return v(std::get<I>(fields));
+	return visit<I+1>(idx, v);
+}
+
+/*
+Parses the current inline statement into the field's member after checking
+that the declared type matches the member's type.
+*/
+template<typename S, typename... Fields>
+template<typename M>
+bool DDFSchema<S, Fields...>::ReadInline::operator()(DDFField<S, M>& f){
+
+	char expected = DDFTypeOf<M>::type;
+	bool is_matrix = (type != 0);
+	char declared = is_matrix ? type : st->words->at(0).p[0];
+
+	if (declared != expected || is_matrix != (DDFTypeOf<M>::dims > 0)){
+		st->err = std::string("Type in file doesn't match schema (expected ") + (DDFTypeOf<M>::dims > 0 ? "m<" : "") + expected + (DDFTypeOf<M>::dims > 0 ? ">" : "") + ").";
+		return false;
+	}
+
+	return schema_read(*st, obj->*(f.member));
+}
+
+/*
+Creates the column sink for a vertical column bound to the field's member.
+*/
+template<typename S, typename... Fields>
+template<typename M>
+bool DDFSchema<S, Fields...>::MakeSink::operator()(DDFField<S, M>& f){
+
+	if (DDFTypeOf<M>::dims == 0 || type != DDFTypeOf<M>::type){
+		err = "Type in file doesn't match schema.";
+		return false;
+	}
+
+	sink = schema_sink(obj->*(f.member));
+	return true;
+}
+
+/*
+Appends the field's statement to the output.
+*/
+template<typename S, typename... Fields>
+template<typename M>
+bool DDFSchema<S, Fields...>::Write::operator()(DDFField<S, M>& f){
+
+	if (DDFTypeOf<M>::dims == 0){
+		*out += std::string(1, DDFTypeOf<M>::type) + " ";
+	}else{
+		*out += std::string("m<") + DDFTypeOf<M>::type + "> ";
+	}
+
+	*out += f.name;
+	*out += " " + schema_format(obj->*(f.member)) + term_char;
+	if (show_descriptions && f.desc[0] != '\0') *out += std::string(" ?") + f.desc;
+	*out += "\n";
+
+	return true;
+}
+
+template<typename S, typename... Fields>
+template<typename M>
+bool DDFSchema<S, Fields...>::Name::operator()(DDFField<S, M>& f){
+	name = f.name;
+	return true;
+}
+
+//***************************************************************************//
+//**			NON-CLASS FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+//***************** READING INLINE STATEMENTS
+
+bool schema_read(DDFSchemaStatement& st, double& out){
+	const DDFToken& w = st.words->at(2);
+	if (!element_to_double(*st.line, w.idx, w.idx + w.len, out)){
+		st.err = "Failed to interpret '" + std::string(w.p, w.len) + "' as a double.";
+		return false;
+	}
+	return true;
+}
+
+bool schema_read(DDFSchemaStatement& st, bool& out){
+	const DDFToken& w = st.words->at(2);
+	if (!element_to_bool(*st.line, w.idx, w.idx + w.len, out)){
+		st.err = "Failed to interpret '" + std::string(w.p, w.len) + "' as a bool.";
+		return false;
+	}
+	return true;
+}
+
+/*
+Reads the string literal following the variable name, up to the next unescaped
+quote.
+*/
+bool schema_read(DDFSchemaStatement& st, std::string& out){
+
+	const std::string& line = *st.line;
+	if (!element_to_string(line, st.words->at(1).idx + st.words->at(1).len, line.length(), out)){
+		st.err = "Failed to interpret '" + std::string(st.words->at(2).p, st.words->at(2).len) + "' as a string.";
+		return false;
+	}
+
+	return true;
+}
+
+template<typename T>
+bool schema_read(DDFSchemaStatement& st, std::vector<T>& out){
+
+	simd_scan_structure(st.line->c_str(), st.line->length(), *st.sidx);
+
+	if (st.sidx->open == DDF_NPOS || st.sidx->close == DDF_NPOS){
+		st.err = "Failed to find square brackets.";
+		return false;
+	}
+	if (st.sidx->semis > 0){
+		st.err = "Schema expects a 1D matrix but file contains a 2D matrix.";
+		return false;
+	}
+	if (!index_to_vec(*st.line, *st.sidx, DDFElementTo(), out)){
+		st.err = "Failed to interpret matrix elements.";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+Reads a 2D matrix. A 1D matrix in the file is accepted as a single row.
+*/
+template<typename T>
+bool schema_read(DDFSchemaStatement& st, std::vector<std::vector<T> >& out){
+
+	simd_scan_structure(st.line->c_str(), st.line->length(), *st.sidx);
+
+	if (st.sidx->open == DDF_NPOS || st.sidx->close == DDF_NPOS){
+		st.err = "Failed to find square brackets.";
+		return false;
+	}
+	if (!index_to_vec2D(*st.line, *st.sidx, DDFElementTo(), out)){
+		st.err = "Failed to interpret matrix elements.";
+		return false;
+	}
+
+	return true;
+}
+
+//***************** READING VERTICAL COLUMNS
+
+//Flat members can't be vertical columns - MakeSink rejects them before these are used
+DDFColumnSink schema_sink(double&){ return DDFColumnSink(); }
+DDFColumnSink schema_sink(bool&){ return DDFColumnSink(); }
+DDFColumnSink schema_sink(std::string&){ return DDFColumnSink(); }
+
+/*
+Sink that appends each element to a 1D member.
+*/
+template<typename T>
+DDFColumnSink schema_sink(std::vector<T>& out){
+
+	out.clear();
+	std::vector<T>* dst = &out;
+
+	return [dst](const std::string& line, size_t first, size_t last, bool) -> bool {
+		T val;
+		if (!DDFElementTo()(line, first, last, val)) return false;
+		dst->push_back(val);
+		return true;
+	};
+}
+
+/*
+Sink that appends each element to the last row of a 2D member, starting a new
+row after each element that ends with a semicolon.
+*/
+template<typename T>
+DDFColumnSink schema_sink(std::vector<std::vector<T> >& out){
+
+	out.clear();
+	std::vector<std::vector<T> >* dst = &out;
+	std::shared_ptr<bool> new_row(new bool(true));
+
+	return [dst, new_row](const std::string& line, size_t first, size_t last, bool row_end) -> bool {
+		T val;
+		if (!DDFElementTo()(line, first, last, val)) return false;
+		if (*new_row) dst->push_back(std::vector<T>());
+		dst->back().push_back(val);
+		*new_row = row_end;
+		return true;
+	};
+}
+
+//***************** WRITING
+
+std::string schema_format(double x){
+	return gstd::to_gstring(x);
+}
+
+std::string schema_format(bool x){
+	return bool_to_string(x);
+}
+
+std::string schema_format(const std::string& x){
+	return escape_string(x.data(), x.length());
+}
+
+template<typename T>
+std::string schema_format(const std::vector<T>& x){
+
+	std::string s = "[";
+	for (size_t k = 0 ; k < x.size() ; k++){
+		if (k != 0) s += ", ";
+		s += schema_format(static_cast<T>(x[k])); //Cast unpacks std::vector<bool> references
+	}
+
+	return s + "]";
+}
+
+template<typename T>
+std::string schema_format(const std::vector<std::vector<T> >& x){
+
+	std::string s = "[";
+	for (size_t k = 0 ; k < x.size() ; k++){
+		if (k != 0) s += "; ";
+		for (size_t j = 0 ; j < x[k].size() ; j++){
+			if (j != 0) s += ", ";
+			s += schema_format(static_cast<T>(x[k][j]));
+		}
+	}
+
+	return s + "]";
+}
+
+#endif
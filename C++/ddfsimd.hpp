@@ -0,0 +1,533 @@
+#ifndef DDFSIMD_HPP
+#define DDFSIMD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+#endif
+
+/*
+Vectorized kernels that run directly on contiguous DDF data or text. The
+instruction set is chosen at compile time: AVX2 if the compiler targets it (eg.
+-mavx2 or -march=native), else SSE2 on any x86-64, else plain scalar code. All
+three paths give identical results except for the rounding of 'sum' and 'mean',
+which are accumulated in several lanes.
+*/
+
+const size_t DDF_NPOS = static_cast<size_t>(-1);
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+/*
+Result of a fused reduction. Every field is computed in the same single pass
+over the data.
+
+NaN elements are included in 'sum' and 'mean' (making them NaN) but ignored by
+min/max/argmin/argmax. argmin and argmax give the first matching index, or
+DDF_NPOS if there is no non-NaN element.
+*/
+typedef struct{
+	size_t count; //Number of elements
+	double sum;
+	double mean;
+	double min;
+	double max;
+	size_t argmin;
+	size_t argmax;
+	size_t count_over; //Number of elements greater than the threshold
+}DDFStats;
+
+/*
+Structural index of one line of DDF text, built by simd_scan_structure().
+
+'pos' lists, in order, the offsets of every '[', ']', ',' and ';' outside
+string literals, and every '"' not escaped by a backslash (\"). Scanning stops
+at the first '//' outside a string literal, whose offset is saved in 'comment'.
+
+'open' and 'close' are the offsets of the first '[' and the first ']' after it
+(outside string literals), and 'commas' and 'semis' count the separators
+between them. All offsets are DDF_NPOS if not found.
+*/
+typedef struct{
+	std::vector<size_t> pos;
+	size_t open;
+	size_t close;
+	size_t commas;
+	size_t semis;
+	size_t comment;
+}DDFStructIndex;
+
+//***************************************************************************//
+//**			FUNCTION DECLARATIONS									   **//
+//***************************************************************************//
+
+DDFStats simd_reduce(const double* data, size_t n, double threshold=0);
+DDFStats simd_reduce(const float* data, size_t n, double threshold=0);
+void simd_merge_stats(DDFStats& a, const DDFStats& b, size_t offset);
+
+void simd_scan_structure(const char* s, size_t n, DDFStructIndex& idx);
+void simd_char_masks(const char* block, uint64_t* masks);
+uint64_t simd_escaped_mask(uint64_t backslash, uint64_t& prev_escaped);
+uint64_t simd_prefix_xor(uint64_t x);
+size_t simd_ctz(uint64_t x);
+
+template<typename F>
+bool simd_for_each_element(const char* s, const DDFStructIndex& idx, F fn);
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+/*
+Computes count, sum, mean, min, max, argmin, argmax and the number of elements
+greater than 'threshold' for 'n' doubles starting at 'data', in one pass.
+*/
+DDFStats simd_reduce(const double* data, size_t n, double threshold){
+
+	DDFStats st;
+	st.count = n;
+	st.sum = 0;
+	st.min = std::numeric_limits<double>::infinity();
+	st.max = -std::numeric_limits<double>::infinity();
+	st.argmin = DDF_NPOS;
+	st.argmax = DDF_NPOS;
+	st.count_over = 0;
+
+	size_t i = 0;
+
+#if defined(__AVX2__)
+
+	if (n >= 4){
+
+		__m256d vsum = _mm256_setzero_pd();
+		__m256d vmin = _mm256_set1_pd(st.min);
+		__m256d vmax = _mm256_set1_pd(st.max);
+		__m256d vimin = _mm256_set1_pd(-1);
+		__m256d vimax = _mm256_set1_pd(-1);
+		__m256d vidx = _mm256_set_pd(3, 2, 1, 0);
+		__m256d vstep = _mm256_set1_pd(4);
+		__m256d vthr = _mm256_set1_pd(threshold);
+		__m256i vcnt = _mm256_setzero_si256();
+
+		for (; i+4 <= n ; i += 4){
+
+			__m256d v = _mm256_loadu_pd(data + i);
+
+			vsum = _mm256_add_pd(vsum, v);
+
+			__m256d lt = _mm256_cmp_pd(v, vmin, _CMP_LT_OQ);
+			vmin = _mm256_blendv_pd(vmin, v, lt);
+			vimin = _mm256_blendv_pd(vimin, vidx, lt);
+
+			__m256d gt = _mm256_cmp_pd(v, vmax, _CMP_GT_OQ);
+			vmax = _mm256_blendv_pd(vmax, v, gt);
+			vimax = _mm256_blendv_pd(vimax, vidx, gt);
+
+			//Compare mask is all ones (-1) per lane, so subtracting counts matches
+			__m256d over = _mm256_cmp_pd(v, vthr, _CMP_GT_OQ);
+			vcnt = _mm256_sub_epi64(vcnt, _mm256_castpd_si256(over));
+
+			vidx = _mm256_add_pd(vidx, vstep);
+		}
+
+		//Collapse lanes
+		double lsum[4], lmin[4], lmax[4], limin[4], limax[4];
+		int64_t lcnt[4];
+		_mm256_storeu_pd(lsum, vsum);
+		_mm256_storeu_pd(lmin, vmin);
+		_mm256_storeu_pd(lmax, vmax);
+		_mm256_storeu_pd(limin, vimin);
+		_mm256_storeu_pd(limax, vimax);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lcnt), vcnt);
+
+		for (size_t l = 0 ; l < 4 ; l++){
+			st.sum += lsum[l];
+			st.count_over += lcnt[l];
+			if (limin[l] >= 0 && (st.argmin == DDF_NPOS || lmin[l] < st.min || (lmin[l] == st.min && limin[l] < st.argmin))){
+				st.min = lmin[l];
+				st.argmin = limin[l];
+			}
+			if (limax[l] >= 0 && (st.argmax == DDF_NPOS || lmax[l] > st.max || (lmax[l] == st.max && limax[l] < st.argmax))){
+				st.max = lmax[l];
+				st.argmax = limax[l];
+			}
+		}
+	}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+	if (n >= 2){
+
+		__m128d vsum = _mm_setzero_pd();
+		__m128d vmin = _mm_set1_pd(st.min);
+		__m128d vmax = _mm_set1_pd(st.max);
+		__m128d vimin = _mm_set1_pd(-1);
+		__m128d vimax = _mm_set1_pd(-1);
+		__m128d vidx = _mm_set_pd(1, 0);
+		__m128d vstep = _mm_set1_pd(2);
+		__m128d vthr = _mm_set1_pd(threshold);
+		__m128i vcnt = _mm_setzero_si128();
+
+		for (; i+2 <= n ; i += 2){
+
+			__m128d v = _mm_loadu_pd(data + i);
+
+			vsum = _mm_add_pd(vsum, v);
+
+			//SSE2 has no blend - select with and/andnot/or
+			__m128d lt = _mm_cmplt_pd(v, vmin);
+			vmin = _mm_or_pd(_mm_and_pd(lt, v), _mm_andnot_pd(lt, vmin));
+			vimin = _mm_or_pd(_mm_and_pd(lt, vidx), _mm_andnot_pd(lt, vimin));
+
+			__m128d gt = _mm_cmpgt_pd(v, vmax);
+			vmax = _mm_or_pd(_mm_and_pd(gt, v), _mm_andnot_pd(gt, vmax));
+			vimax = _mm_or_pd(_mm_and_pd(gt, vidx), _mm_andnot_pd(gt, vimax));
+
+			//Compare mask is all ones (-1) per lane, so subtracting counts matches
+			__m128d over = _mm_cmpgt_pd(v, vthr);
+			vcnt = _mm_sub_epi64(vcnt, _mm_castpd_si128(over));
+
+			vidx = _mm_add_pd(vidx, vstep);
+		}
+
+		//Collapse lanes
+		double lsum[2], lmin[2], lmax[2], limin[2], limax[2];
+		int64_t lcnt[2];
+		_mm_storeu_pd(lsum, vsum);
+		_mm_storeu_pd(lmin, vmin);
+		_mm_storeu_pd(lmax, vmax);
+		_mm_storeu_pd(limin, vimin);
+		_mm_storeu_pd(limax, vimax);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lcnt), vcnt);
+
+		for (size_t l = 0 ; l < 2 ; l++){
+			st.sum += lsum[l];
+			st.count_over += lcnt[l];
+			if (limin[l] >= 0 && (st.argmin == DDF_NPOS || lmin[l] < st.min || (lmin[l] == st.min && limin[l] < st.argmin))){
+				st.min = lmin[l];
+				st.argmin = limin[l];
+			}
+			if (limax[l] >= 0 && (st.argmax == DDF_NPOS || lmax[l] > st.max || (lmax[l] == st.max && limax[l] < st.argmax))){
+				st.max = lmax[l];
+				st.argmax = limax[l];
+			}
+		}
+	}
+
+#endif
+
+	//Scalar tail (or whole array if no SIMD available)
+	for (; i < n ; i++){
+		double v = data[i];
+		st.sum += v;
+		if (v < st.min){
+			st.min = v;
+			st.argmin = i;
+		}
+		if (v > st.max){
+			st.max = v;
+			st.argmax = i;
+		}
+		if (v > threshold) st.count_over++;
+	}
+
+	//Comparisons above are strict, so +/-inf elements are only caught here
+	if (st.argmin == DDF_NPOS){
+		for (size_t k = 0 ; k < n ; k++){
+			if (data[k] == st.min){
+				st.argmin = k;
+				break;
+			}
+		}
+	}
+	if (st.argmax == DDF_NPOS){
+		for (size_t k = 0 ; k < n ; k++){
+			if (data[k] == st.max){
+				st.argmax = k;
+				break;
+			}
+		}
+	}
+
+	//No non-NaN elements
+	if (st.argmin == DDF_NPOS) st.min = std::numeric_limits<double>::quiet_NaN();
+	if (st.argmax == DDF_NPOS) st.max = std::numeric_limits<double>::quiet_NaN();
+
+	st.mean = (n > 0) ? st.sum/n : std::numeric_limits<double>::quiet_NaN();
+
+	return st;
+}
+
+/*
+Same as above for single precision data. The floats are widened a block at a
+time into a buffer on the stack, and the blocks merged.
+*/
+DDFStats simd_reduce(const float* data, size_t n, double threshold){
+
+	const size_t block = 1024;
+	double buf[block];
+
+	DDFStats st = simd_reduce(static_cast<const double*>(NULL), 0, threshold);
+	for (size_t i = 0 ; i < n ; i += block){
+		size_t len = std::min(block, n - i);
+		for (size_t k = 0 ; k < len ; k++){
+			buf[k] = data[i+k];
+		}
+		simd_merge_stats(st, simd_reduce(buf, len, threshold), i);
+	}
+
+	return st;
+}
+
+/*
+Merges the reduction 'b' into 'a', as if b's elements were appended to a's.
+'offset' is the index of b's first element in the combined data, and is added
+to b's argmin/argmax. Used to combine the rows of a 2D matrix.
+*/
+void simd_merge_stats(DDFStats& a, const DDFStats& b, size_t offset){
+
+	if (b.argmin != DDF_NPOS && (a.argmin == DDF_NPOS || b.min < a.min)){
+		a.min = b.min;
+		a.argmin = b.argmin + offset;
+	}
+	if (b.argmax != DDF_NPOS && (a.argmax == DDF_NPOS || b.max > a.max)){
+		a.max = b.max;
+		a.argmax = b.argmax + offset;
+	}
+
+	a.count += b.count;
+	a.sum += b.sum;
+	a.count_over += b.count_over;
+	a.mean = (a.count > 0) ? a.sum/a.count : std::numeric_limits<double>::quiet_NaN();
+}
+
+/*
+Builds the structural index (see DDFStructIndex) of 'n' characters of text in
+one pass, 64 bytes at a time, in the style of simdjson's stage 1:
+
+1. Compare each block against the characters of interest, giving one 64-bit
+   mask per character.
+2. Find quotes escaped by an odd run of backslashes and drop them.
+3. A prefix-XOR of the remaining quotes gives the mask of bytes inside string
+   literals (carried between blocks).
+4. Keep the separators outside strings and append their offsets to idx.pos.
+
+'idx.pos' keeps its capacity between calls, so scanning many lines with the
+same index doesn't allocate once it has grown.
+*/
+void simd_scan_structure(const char* s, size_t n, DDFStructIndex& idx){
+
+	idx.pos.clear();
+	idx.open = DDF_NPOS;
+	idx.close = DDF_NPOS;
+	idx.commas = 0;
+	idx.semis = 0;
+	idx.comment = DDF_NPOS;
+
+	uint64_t prev_escaped = 0;
+	uint64_t prev_in_string = 0;
+	uint64_t prev_slash = 0;
+
+	uint64_t m[7]; //'"', '\\', '[', ']', ',', ';', '/'
+	char tail[64];
+
+	for (size_t base = 0 ; base < n ; base += 64){
+
+		//Pad last block with spaces
+		const char* blk = s + base;
+		if (n - base < 64){
+			memset(tail, ' ', 64);
+			memcpy(tail, s + base, n - base);
+			blk = tail;
+		}
+
+		simd_char_masks(blk, m);
+
+		uint64_t escaped = simd_escaped_mask(m[1], prev_escaped);
+		uint64_t quotes = m[0] & ~escaped;
+		uint64_t in_string = simd_prefix_xor(quotes) ^ prev_in_string;
+		prev_in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+		uint64_t outside = ~in_string;
+
+		uint64_t structural = ((m[2] | m[3] | m[4] | m[5]) & outside) | quotes;
+
+		//Second slash of a '//' pair outside strings starts a comment
+		uint64_t comment = m[6] & ((m[6] << 1) | prev_slash) & outside;
+		prev_slash = m[6] >> 63;
+		if (comment != 0){
+			size_t k = simd_ctz(comment);
+			idx.comment = base + k - 1;
+			structural &= (k > 1) ? ((uint64_t(1) << (k-1)) - 1) : 0;
+		}
+
+		//Save offsets of set bits
+		while (structural != 0){
+			idx.pos.push_back(base + simd_ctz(structural));
+			structural &= structural - 1;
+		}
+
+		if (idx.comment != DDF_NPOS) break;
+	}
+
+	//Locate brackets and count separators between them
+	for (size_t i = 0 ; i < idx.pos.size() ; i++){
+		char c = s[idx.pos[i]];
+		if (idx.open == DDF_NPOS){
+			if (c == '[') idx.open = idx.pos[i];
+			continue;
+		}
+		if (c == ']'){
+			idx.close = idx.pos[i];
+			break;
+		}
+		if (c == ',') idx.commas++;
+		if (c == ';') idx.semis++;
+	}
+}
+
+/*
+Sets masks[0..6] to the bit masks of the 64-byte block's '"', '\\', '[', ']',
+',', ';' and '/' characters. Bit i corresponds to block[i].
+*/
+void simd_char_masks(const char* block, uint64_t* masks){
+
+	static const char chars[7] = {'"', '\\', '[', ']', ',', ';', '/'};
+
+#if defined(__AVX2__)
+
+	__m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+	__m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+	for (size_t c = 0 ; c < 7 ; c++){
+		__m256i v = _mm256_set1_epi8(chars[c]);
+		uint64_t l = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v)));
+		uint64_t h = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v)));
+		masks[c] = l | (h << 32);
+	}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+	__m128i q[4];
+	for (size_t k = 0 ; k < 4 ; k++){
+		q[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16*k));
+	}
+	for (size_t c = 0 ; c < 7 ; c++){
+		__m128i v = _mm_set1_epi8(chars[c]);
+		uint64_t m = 0;
+		for (size_t k = 0 ; k < 4 ; k++){
+			m |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(q[k], v)))) << (16*k);
+		}
+		masks[c] = m;
+	}
+
+#else
+
+	for (size_t c = 0 ; c < 7 ; c++){
+		masks[c] = 0;
+	}
+	for (size_t i = 0 ; i < 64 ; i++){
+		for (size_t c = 0 ; c < 7 ; c++){
+			if (block[i] == chars[c]) masks[c] |= uint64_t(1) << i;
+		}
+	}
+
+#endif
+}
+
+/*
+Returns the mask of characters escaped by a backslash, given the mask of
+backslashes. A run of backslashes escapes the next character only if the run
+has odd length. 'prev_escaped' carries an escape over from the previous block.
+(Branch-free method from simdjson.)
+*/
+uint64_t simd_escaped_mask(uint64_t backslash, uint64_t& prev_escaped){
+
+	const uint64_t even_bits = 0x5555555555555555ULL;
+
+	backslash &= ~prev_escaped;
+	uint64_t follows_escape = (backslash << 1) | prev_escaped;
+
+	uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+	uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+	prev_escaped = (sequences_starting_on_even_bits < odd_sequence_starts) ? 1 : 0; //Carry out
+
+	uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+	return (even_bits ^ invert_mask) & follows_escape;
+}
+
+/*
+Returns x with each bit replaced by the XOR of itself and all lower bits. For a
+mask of quotes, this sets the bits inside each quoted string.
+*/
+uint64_t simd_prefix_xor(uint64_t x){
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+	return x;
+}
+
+/*
+Returns the index of the lowest set bit. x must not be zero.
+*/
+size_t simd_ctz(uint64_t x){
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(x);
+#else
+	size_t i = 0;
+	while ((x & 1) == 0){
+		x >>= 1;
+		i++;
+	}
+	return i;
+#endif
+}
+
+/*
+Walks the elements between the brackets of the structural index 'idx' of text
+'s', calling fn(first, last, row_end) for each, where [first, last) are the
+offsets of the element's text and 'row_end' is true if a semicolon or the
+closing bracket follows it. Stops and returns false as soon as fn returns false.
+
+An empty body (no separators, only whitespace) still yields one empty element;
+the caller decides whether that is an empty matrix.
+*/
+template<typename F>
+bool simd_for_each_element(const char* s, const DDFStructIndex& idx, F fn){
+
+	if (idx.open == DDF_NPOS || idx.close == DDF_NPOS) return false;
+
+	size_t first = idx.open + 1;
+	size_t i = 0;
+	while (i < idx.pos.size() && idx.pos[i] <= idx.open) i++; //Skip to body
+
+	for (; i < idx.pos.size() ; i++){
+
+		size_t p = idx.pos[i];
+		char c = s[p];
+
+		//Elements end at separators and the closing bracket
+		if (p != idx.close && c != ',' && c != ';') continue;
+
+		if (!fn(first, p, p == idx.close || c == ';')) return false;
+		first = p + 1;
+
+		if (p == idx.close) break;
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef DDFSNAPSHOT_HPP
+#define DDFSNAPSHOT_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "cppddf.hpp"
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+	#define DDF_ATOMIC_SHARED_PTR
+#endif
+
+/*
+Immutable snapshots for sharing one set of DDF data between many threads.
+
+A DDFSnapshot is a reference-counted pointer to a const DDFIO. Only const
+methods (get(), contains(), names(), ...) can be called through it, and none of
+those modify the object, so any number of threads can read one snapshot
+without locks.
+
+A DDFSnapshotHolder publishes the current snapshot. reload() loads a new file
+into a fresh object and swaps it in atomically, RCU-style. Readers that already
+hold the old snapshot keep using it, and it is freed when the last of them lets
+go.
+
+	DDFSnapshotHolder calib;
+	calib.reload("calibration.ddf");
+
+	//Request threads
+	DDFSnapshot snap = calib.get();
+	double gain;
+	snap->get("gain", gain);
+*/
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+typedef std::shared_ptr<const DDFIO> DDFSnapshot;
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+class DDFSnapshotHolder{
+public:
+
+	//************ INITIALIZERS
+
+	DDFSnapshotHolder();
+	DDFSnapshotHolder(DDFSnapshot initial);
+
+	//************ READERS
+
+	DDFSnapshot get() const;
+
+	//************ WRITERS
+
+	void publish(DDFSnapshot snap);
+	bool reload(std::string fileIn, std::string options="");
+
+	std::string err();
+
+private:
+
+#ifdef DDF_ATOMIC_SHARED_PTR
+	std::atomic<DDFSnapshot> current;
+#else
+	DDFSnapshot current; //Only accessed through std::atomic_load() and std::atomic_store()
+#endif
+
+	std::mutex reload_mtx; //Serializes writers - readers never take it
+	std::string err_str; //Guarded by reload_mtx
+};
+
+//***************************************************************************//
+//**			FUNCTION DECLARATIONS									   **//
+//***************************************************************************//
+
+bool loadSnapshot(std::string fileIn, DDFSnapshot& out, std::string& err, std::string options="");
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** INITIALIZERS
+
+/*
+Starts with an empty snapshot, so get() never returns null.
+*/
+DDFSnapshotHolder::DDFSnapshotHolder() : current(std::make_shared<const DDFIO>()){
+}
+
+DDFSnapshotHolder::DDFSnapshotHolder(DDFSnapshot initial) : current(initial ? initial : std::make_shared<const DDFIO>()){
+}
+
+//***************************************************************************//
+//***************** READERS
+
+/*
+Returns the current snapshot. Never blocks on a reload in progress. Keep the
+returned pointer for as long as a consistent view is needed - the snapshot it
+points to never changes.
+*/
+DDFSnapshot DDFSnapshotHolder::get() const{
+#ifdef DDF_ATOMIC_SHARED_PTR
+	return current.load(std::memory_order_acquire);
+#else
+	return std::atomic_load(&current);
+#endif
+}
+
+//***************************************************************************//
+//***************** WRITERS
+
+/*
+Replaces the current snapshot. Readers calling get() afterwards see 'snap';
+readers holding the old snapshot are unaffected.
+*/
+void DDFSnapshotHolder::publish(DDFSnapshot snap){
+
+	if (!snap) snap = std::make_shared<const DDFIO>();
+
+#ifdef DDF_ATOMIC_SHARED_PTR
+	current.store(snap, std::memory_order_release);
+#else
+	std::atomic_store(&current, snap);
+#endif
+}
+
+/*
+Loads 'fileIn' into a new snapshot and publishes it. Options are passed to
+DDFIO::load. If loading fails the current snapshot stays in place and the
+error is available from err(). Returns true if successful.
+*/
+bool DDFSnapshotHolder::reload(std::string fileIn, std::string options){
+
+	std::lock_guard<std::mutex> lock(reload_mtx);
+
+	DDFSnapshot snap;
+	if (!loadSnapshot(fileIn, snap, err_str, options)) return false;
+
+	publish(snap);
+	err_str = "";
+
+	return true;
+}
+
+/*
+Returns the error from the last failed reload(), or a blank string if the last
+reload succeeded.
+*/
+std::string DDFSnapshotHolder::err(){
+	std::lock_guard<std::mutex> lock(reload_mtx);
+	return err_str;
+}
+
+//***************************************************************************//
+//**			NON-CLASS FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Loads 'fileIn' into a new immutable snapshot saved in 'out'. Options are passed
+to DDFIO::load. Returns false and saves the error message in 'err' on failure.
+*/
+bool loadSnapshot(std::string fileIn, DDFSnapshot& out, std::string& err, std::string options){
+
+	std::shared_ptr<DDFIO> ddf = std::make_shared<DDFIO>();
+	if (!ddf->load(fileIn, options)){
+		err = ddf->err();
+		if (err.length() == 0) err = "Failed to open or identify file '" + fileIn + "'.";
+		return false;
+	}
+
+	out = ddf; //Const from here on
+	return true;
+}
+
+#endif
@@ -0,0 +1,847 @@
+#ifndef DDFSTREAM_HPP
+#define DDFSTREAM_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cppddf.hpp"
+
+/*
+Out-of-core reading of vertical blocks. DDFVerticalReader streams through one
+#VERTICAL block and hands back the data in batches of N rows, so files far
+larger than memory can be processed. Memory use is bounded by the batch size.
+
+	DDFVerticalReader rd;
+	rd.open("log.ddf", 0, {"t", "V"}); //First vertical block, two columns
+	DDFBatch batch;
+	while (rd.next(batch, 65536)){
+		DDFSpan<double> V = batch.doubles(batch.column("V"));
+		for (size_t i = 0 ; i < V.size() ; i++) ...
+	}
+	if (rd.err() != "") std::cout << rd.err() << std::endl;
+
+tell() returns a position that can be saved (eg. to disk) and passed to seek()
+later to carry on from the same row.
+
+In follow mode the reader tails a file that another process is still writing.
+A block without its closing #VERTICAL statement is not an error: next() returns
+the complete lines written so far and leaves a partly written last line for
+the next call, which picks up from there. A closing #VERTICAL statement at the
+very end of the file is taken as provisional, since writers like DDFLogger
+write over it with the next rows. Turn follow mode off to read it as the end.
+
+	rd.open("live.ddf");
+	rd.follow();
+	while (!rd.eof()){
+		if (rd.next(batch, 65536)) plot(batch);
+		else if (rd.err() != "") break;
+		else sleep(1); //Nothing new yet
+	}
+*/
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+/*
+Read-only view of 'size()' contiguous values. Valid until the batch it came
+from is refilled.
+*/
+template<typename T>
+class DDFSpan{
+public:
+
+	DDFSpan();
+	DDFSpan(const T* p, size_t n);
+
+	const T* data() const;
+	size_t size() const;
+	bool empty() const;
+	const T& operator[](size_t i) const;
+
+	const T* begin() const;
+	const T* end() const;
+
+private:
+
+	const T* ptr;
+	size_t len;
+};
+
+/*
+Position within a vertical block, from DDFVerticalReader::tell().
+*/
+typedef struct{
+	uint64_t offset;	//Byte offset of the next data line
+	size_t line;		//Line number of the next data line (for error messages)
+	size_t columns;		//Columns still present - later columns may end early
+}DDFStreamPos;
+
+/*
+One column of a batch. Only the buffer matching 'type' is used. Buffers keep
+their capacity between batches.
+*/
+typedef struct{
+	std::string name;
+	std::string description;
+	char type;
+	size_t count; //Values in this batch - shorter columns may have fewer than the batch's rows
+
+	std::vector<double> d;
+	std::unique_ptr<bool[]> b;
+	std::vector<std::string> s;
+	std::unique_ptr<bool[]> row_end; //True where a 2D column's row ended (trailing ';')
+	size_t capacity; //Size of 'b' and 'row_end'
+}DDFBatchColumn;
+
+//***************************************************************************//
+//**			CLASS DEFINITIONS									   **//
+//***************************************************************************//
+
+/*
+Rows from a vertical block, filled by DDFVerticalReader::next().
+*/
+class DDFBatch{
+public:
+
+	DDFBatch();
+
+	size_t rows() const;
+	size_t columns() const;
+	size_t column(std::string name) const;
+
+	std::string name(size_t col) const;
+	char type(size_t col) const;
+
+	DDFSpan<double> doubles(size_t col) const;
+	DDFSpan<bool> bools(size_t col) const;
+	DDFSpan<std::string> strings(size_t col) const;
+	DDFSpan<bool> rowEnds(size_t col) const;
+
+private:
+
+	friend class DDFVerticalReader;
+
+	std::vector<DDFBatchColumn> cols;
+	size_t num_rows;
+};
+
+class DDFVerticalReader{
+public:
+
+	//************ INITIALIZERS
+
+	DDFVerticalReader();
+
+	//************ FILE
+
+	bool open(std::string fileIn, size_t block=0, std::vector<std::string> columns={});
+	void close();
+
+	//************ READING
+
+	bool next(DDFBatch& batch, size_t rows);
+	size_t skip(size_t rows);
+	bool eof() const;
+
+	void follow(bool enable=true);
+
+	DDFStreamPos tell() const;
+	bool seek(DDFStreamPos pos);
+
+	//************ STATUS
+
+	std::vector<std::string> names() const;
+	std::vector<std::string> descriptions() const;
+	std::string types() const;
+	std::string err() const;
+
+private:
+
+	std::ifstream file;
+
+	std::vector<std::string> all_names;
+	std::vector<std::string> all_descs;
+	std::string all_types;
+
+	std::vector<size_t> selected; //Block column of each output column
+	std::vector<size_t> slot; //Output column of each block column, or DDF_NPOS
+
+	DDFStreamPos pos;
+	DDFStreamPos start; //Position of the first data line
+	bool at_end;
+	bool follow_mode; //See follow()
+
+	std::vector<DDFToken> words;
+	std::string line;
+
+	std::string err_str;
+
+	bool readDeclarations(size_t block, size_t& lineNum);
+	bool readLine(std::streamoff& line_start, bool& waiting);
+	bool provisionalEnd(std::streamoff line_start);
+	void prepare(DDFBatch& batch, size_t rows);
+};
+
+//***************************************************************************//
+//**			FUNCTION DEFINITIONS									   **//
+//***************************************************************************//
+
+//***************************************************************************//
+//***************** DDFSpan
+
+template<typename T>
+DDFSpan<T>::DDFSpan() : ptr(NULL), len(0){
+}
+
+template<typename T>
+DDFSpan<T>::DDFSpan(const T* p, size_t n) : ptr(p), len(n){
+}
+
+template<typename T>
+const T* DDFSpan<T>::data() const{
+	return ptr;
+}
+
+template<typename T>
+size_t DDFSpan<T>::size() const{
+	return len;
+}
+
+template<typename T>
+bool DDFSpan<T>::empty() const{
+	return len == 0;
+}
+
+template<typename T>
+const T& DDFSpan<T>::operator[](size_t i) const{
+	return ptr[i];
+}
+
+template<typename T>
+const T* DDFSpan<T>::begin() const{
+	return ptr;
+}
+
+template<typename T>
+const T* DDFSpan<T>::end() const{
+	return ptr + len;
+}
+
+//***************************************************************************//
+//***************** DDFBatch
+
+DDFBatch::DDFBatch() : num_rows(0){
+}
+
+/*
+Returns the number of data lines in the batch.
+*/
+size_t DDFBatch::rows() const{
+	return num_rows;
+}
+
+/*
+Returns the number of columns in the batch.
+*/
+size_t DDFBatch::columns() const{
+	return cols.size();
+}
+
+/*
+Returns the index of the column called 'name', or DDF_NPOS if there is none.
+*/
+size_t DDFBatch::column(std::string name) const{
+
+	for (size_t i = 0 ; i < cols.size() ; i++){
+		if (cols[i].name == name) return i;
+	}
+
+	return DDF_NPOS;
+}
+
+std::string DDFBatch::name(size_t col) const{
+	return (col < cols.size()) ? cols[col].name : "";
+}
+
+/*
+Returns the type character ('d', 'b' or 's') of a column, or '\0' if out of range.
+*/
+char DDFBatch::type(size_t col) const{
+	return (col < cols.size()) ? cols[col].type : '\0';
+}
+
+/*
+Returns the values of an m<d> column. Returns an empty span if the column
+doesn't exist or has another type.
+*/
+DDFSpan<double> DDFBatch::doubles(size_t col) const{
+	if (col >= cols.size() || cols[col].type != 'd') return DDFSpan<double>();
+	return DDFSpan<double>(cols[col].d.data(), cols[col].count);
+}
+
+/*
+Returns the values of an m<b> column. Returns an empty span if the column
+doesn't exist or has another type.
+*/
+DDFSpan<bool> DDFBatch::bools(size_t col) const{
+	if (col >= cols.size() || cols[col].type != 'b') return DDFSpan<bool>();
+	return DDFSpan<bool>(cols[col].b.get(), cols[col].count);
+}
+
+/*
+Returns the values of an m<s> column. Returns an empty span if the column
+doesn't exist or has another type.
+*/
+DDFSpan<std::string> DDFBatch::strings(size_t col) const{
+	if (col >= cols.size() || cols[col].type != 's') return DDFSpan<std::string>();
+	return DDFSpan<std::string>(cols[col].s.data(), cols[col].count);
+}
+
+/*
+Returns one flag per value of a column, true where the value ended a row of a
+2D matrix (was followed by a semicolon).
+*/
+DDFSpan<bool> DDFBatch::rowEnds(size_t col) const{
+	if (col >= cols.size()) return DDFSpan<bool>();
+	return DDFSpan<bool>(cols[col].row_end.get(), cols[col].count);
+}
+
+//***************************************************************************//
+//***************** DDFVerticalReader - INITIALIZERS
+
+DDFVerticalReader::DDFVerticalReader() : at_end(true), follow_mode(false){
+	pos.offset = 0;
+	pos.line = 0;
+	pos.columns = 0;
+	start = pos;
+}
+
+//***************************************************************************//
+//***************** DDFVerticalReader - FILE
+
+/*
+Opens 'fileIn' and reads the declarations of vertical block number 'block'
+(counting from 0). Only the columns named in 'columns' are read, in that
+order; if it is empty, every column is read.
+
+Returns false and sets the error string on failure.
+*/
+bool DDFVerticalReader::open(std::string fileIn, size_t block, std::vector<std::string> columns){
+
+	close();
+	err_str = "";
+
+	file.open(fileIn.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open()){
+		err_str = "Failed to open file '" + fileIn + "'.";
+		return false;
+	}
+
+	size_t lineNum = 0;
+	if (!readDeclarations(block, lineNum)){
+		close();
+		return false;
+	}
+
+	//Map selected columns
+	slot.assign(all_names.size(), DDF_NPOS);
+	if (columns.size() == 0){
+		for (size_t i = 0 ; i < all_names.size() ; i++){
+			selected.push_back(i);
+		}
+	}else{
+		for (size_t c = 0 ; c < columns.size() ; c++){
+			size_t i = 0;
+			while (i < all_names.size() && all_names[i] != columns[c]) i++;
+			if (i == all_names.size()){
+				err_str = "Column '" + columns[c] + "' not found in vertical block.";
+				close();
+				return false;
+			}
+			selected.push_back(i);
+		}
+	}
+	for (size_t k = 0 ; k < selected.size() ; k++){
+		slot[selected[k]] = k;
+	}
+
+	pos.offset = file.tellg();
+	pos.line = lineNum + 1;
+	pos.columns = all_names.size();
+	start = pos;
+	at_end = false;
+
+	return true;
+}
+
+/*
+Closes the file.
+*/
+void DDFVerticalReader::close(){
+
+	if (file.is_open()) file.close();
+	file.clear();
+
+	all_names.clear();
+	all_descs.clear();
+	all_types = "";
+	selected.clear();
+	slot.clear();
+	at_end = true;
+}
+
+//***************************************************************************//
+//***************** DDFVerticalReader - READING
+
+/*
+Reads up to 'rows' data lines into 'batch'. Returns false once the end of the
+block has been reached and there is nothing left to return, or on error (then
+err() is not blank).
+*/
+bool DDFVerticalReader::next(DDFBatch& batch, size_t rows){
+
+	prepare(batch, rows);
+	if (at_end || rows == 0) return false;
+
+	if (follow_mode){ //Check the file wasn't truncated or replaced while we waited
+		file.clear();
+		file.seekg(0, std::ios::end);
+		if (file.tellg() < (std::streamoff)pos.offset){
+			err_str = "File was truncated while being followed.";
+			at_end = true;
+			return false;
+		}
+		file.seekg(pos.offset);
+	}
+
+	while (batch.num_rows < rows){
+
+		std::streamoff line_start;
+		bool waiting;
+		if (!readLine(line_start, waiting)){
+			if (waiting) break; //Rest hasn't been written yet
+			err_str = "Failed on line " + std::to_string(pos.line) + ".\n\tFailed to find closing #VERTICAL statement.";
+			at_end = true;
+			return false;
+		}
+
+		tokenize_line(line.c_str(), line.length(), "", words, true);
+
+		//Drop trailing comment
+		for (size_t i = 0 ; i < words.size() ; i++){
+			if (words[i].len >= 2 && words[i].p[0] == '/' && words[i].p[1] == '/'){
+				words.resize(i);
+				break;
+			}
+		}
+
+		if (words.size() == 0){ //Blank or comment line
+			pos.line++;
+			continue;
+		}
+
+		if (token_is(words[0], "#VERTICAL")){
+			pos.offset = line_start;
+			if (!provisionalEnd(line_start)) at_end = true;
+			break;
+		}
+
+		if (words.size() > pos.columns){
+			err_str = "Failed on line " + std::to_string(pos.line) + ".\n\tToo many characters detected.";
+			at_end = true;
+			return false;
+		}
+		pos.columns = words.size();
+
+		//Convert selected tokens
+		for (size_t i = 0 ; i < words.size() ; i++){
+
+			size_t k = slot[i];
+			if (k == DDF_NPOS) continue;
+
+			DDFBatchColumn& c = batch.cols[k];
+			size_t first = words[i].idx;
+			size_t last = first + words[i].len;
+			bool row_end = (line[last-1] == ';');
+			if (row_end) last--;
+
+			bool ok;
+			switch(c.type){
+				case('d'):
+					ok = element_to_double(line, first, last, c.d[c.count]);
+					break;
+				case('b'):
+					ok = element_to_bool(line, first, last, c.b[c.count]);
+					break;
+				default:
+					ok = element_to_string(line, first, last, c.s[c.count]);
+					break;
+			}
+			if (!ok){
+				err_str = "Failed on line " + std::to_string(pos.line) + ".\n\tFailed to convert '" + line.substr(first, last-first) + "'.";
+				at_end = true;
+				return false;
+			}
+
+			c.row_end[c.count] = row_end;
+			c.count++;
+		}
+
+		batch.num_rows++;
+		pos.line++;
+		pos.offset = file.tellg();
+	}
+
+	return (batch.num_rows > 0);
+}
+
+/*
+Moves past up to 'rows' data lines without converting them. Returns the number
+of lines skipped, which is less than 'rows' at the end of the block or on error
+(then err() is not blank).
+*/
+size_t DDFVerticalReader::skip(size_t rows){
+
+	size_t skipped = 0;
+	while (!at_end && skipped < rows){
+
+		std::streamoff line_start;
+		bool waiting;
+		if (!readLine(line_start, waiting)){
+			if (waiting) break;
+			err_str = "Failed on line " + std::to_string(pos.line) + ".\n\tFailed to find closing #VERTICAL statement.";
+			at_end = true;
+			break;
+		}
+
+		tokenize_line(line.c_str(), line.length(), "", words, true);
+
+		//Drop trailing comment
+		for (size_t i = 0 ; i < words.size() ; i++){
+			if (words[i].len >= 2 && words[i].p[0] == '/' && words[i].p[1] == '/'){
+				words.resize(i);
+				break;
+			}
+		}
+
+		if (words.size() == 0){ //Blank or comment line
+			pos.line++;
+			continue;
+		}
+
+		if (token_is(words[0], "#VERTICAL")){
+			pos.offset = line_start;
+			if (!provisionalEnd(line_start)) at_end = true;
+			break;
+		}
+
+		if (words.size() > pos.columns){
+			err_str = "Failed on line " + std::to_string(pos.line) + ".\n\tToo many characters detected.";
+			at_end = true;
+			break;
+		}
+		pos.columns = words.size();
+
+		skipped++;
+		pos.line++;
+		pos.offset = file.tellg();
+	}
+
+	return skipped;
+}
+
+/*
+Returns true once the closing #VERTICAL statement has been read (or an error
+occurred).
+*/
+bool DDFVerticalReader::eof() const{
+	return at_end;
+}
+
+/*
+Turns follow mode on or off (see above). In follow mode reaching the end of
+the file isn't an error, a last line without a newline is treated as still
+being written, and a closing #VERTICAL statement at the end of the file
+doesn't end the block. Once the writer has finished, call follow(false) and
+next() once more to reach eof().
+*/
+void DDFVerticalReader::follow(bool enable){
+	follow_mode = enable;
+}
+
+/*
+Returns the current position, to be passed to seek() later.
+*/
+DDFStreamPos DDFVerticalReader::tell() const{
+	return pos;
+}
+
+/*
+Carries on reading from a position returned by tell() on the same file. The
+file must be open (with the same block selected). Returns false if the
+position is before the block's data.
+*/
+bool DDFVerticalReader::seek(DDFStreamPos p){
+
+	if (!file.is_open() || p.offset < start.offset || p.columns > all_names.size()){
+		err_str = "Invalid stream position.";
+		return false;
+	}
+
+	file.clear();
+	file.seekg(p.offset);
+	if (!file){
+		err_str = "Invalid stream position.";
+		return false;
+	}
+
+	pos = p;
+	at_end = false;
+	err_str = "";
+
+	return true;
+}
+
+//***************************************************************************//
+//***************** DDFVerticalReader - STATUS
+
+/*
+Returns the names of the columns being read, in output order.
+*/
+std::vector<std::string> DDFVerticalReader::names() const{
+
+	std::vector<std::string> out;
+	for (size_t k = 0 ; k < selected.size() ; k++){
+		out.push_back(all_names[selected[k]]);
+	}
+
+	return out;
+}
+
+/*
+Returns the descriptions of the columns being read, in output order. Columns
+without a description give blank strings.
+*/
+std::vector<std::string> DDFVerticalReader::descriptions() const{
+
+	std::vector<std::string> out;
+	for (size_t k = 0 ; k < selected.size() ; k++){
+		out.push_back(all_descs[selected[k]]);
+	}
+
+	return out;
+}
+
+/*
+Returns the type characters of the columns being read, in output order.
+*/
+std::string DDFVerticalReader::types() const{
+
+	std::string out;
+	for (size_t k = 0 ; k < selected.size() ; k++){
+		out += all_types[selected[k]];
+	}
+
+	return out;
+}
+
+/*
+Returns the error status
+*/
+std::string DDFVerticalReader::err() const{
+	return err_str;
+}
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Reads from the start of the file up to and including the declarations of
+vertical block 'block'. Leaves the file at the first data line. 'lineNum' is
+the number of the last line read.
+*/
+bool DDFVerticalReader::readDeclarations(size_t block, size_t& lineNum){
+
+	bool found_version = false;
+	size_t blocks_seen = 0;
+
+	//Find the block's opening statement
+	while (true){
+
+		if (!getline(file, line)){
+			err_str = (found_version) ? "Vertical block " + std::to_string(block) + " not found." : "Failed to open or identify file.";
+			return false;
+		}
+		lineNum++;
+
+		tokenize_line(line.c_str(), line.length(), "", words);
+		if (words.size() < 1) continue;
+
+		if (!found_version){
+			double version = (words.size() == 2 && token_is(words[0], "#VERSION")) ? strtod(words[1].p, NULL) : 0;
+			if (version < 2 || version >= 3){
+				err_str = "Failed on line " + std::to_string(lineNum) + ".\n\tUnsupported version statement.";
+				return false;
+			}
+			found_version = true;
+		}else if (token_is(words[0], "#HEADER")){ //Skip header - it may contain anything
+			while (getline(file, line)){
+				lineNum++;
+				tokenize_line(line.c_str(), line.length(), "", words);
+				if (words.size() > 0 && token_is(words[0], "#HEADER")) break;
+			}
+		}else if (token_is(words[0], "#VERTICAL")){
+			if (blocks_seen == block) break;
+			blocks_seen++;
+			while (getline(file, line)){ //Skip to the end of this block
+				lineNum++;
+				tokenize_line(line.c_str(), line.length(), "", words);
+				if (words.size() > 0 && token_is(words[0], "#VERTICAL")) break;
+			}
+		}
+	}
+
+	size_t openedOnLine = lineNum;
+
+	//Read types, names and descriptions
+	std::vector<std::string> decl;
+	while (decl.size() < 3){
+
+		std::streamoff line_start = file.tellg();
+		if (!getline(file, line)){
+			err_str = "Failed on line " + std::to_string(openedOnLine) + ".\n\tFailed to find closing #VERTICAL statement.";
+			return false;
+		}
+		lineNum++;
+
+		size_t first = line.find_first_not_of(" \t");
+		if (first == std::string::npos || line.compare(first, 2, "//") == 0) continue; //Blank or comment
+
+		if (line.compare(first, 9, "#VERTICAL") == 0){
+			err_str = "Failed in vertical block beginning on line " + std::to_string(openedOnLine) + ".\n\tFound fewer than three non-blank lines.";
+			return false;
+		}
+
+		//Descriptions are optional - stop at the first data line
+		if (decl.size() == 2 && line[first] != '?'){
+			file.seekg(line_start);
+			lineNum--;
+			break;
+		}
+
+		decl.push_back(line);
+	}
+
+	std::vector<DDFToken> types, names;
+	tokenize_line(decl[0].c_str(), decl[0].length(), "", types);
+	tokenize_line(decl[1].c_str(), decl[1].length(), "", names);
+	if (types.size() != names.size()){
+		err_str = "Failed on line " + std::to_string(openedOnLine+1) + ".\n\tNumber of type declarations, names, and descriptions (if present) must match.";
+		return false;
+	}
+
+	for (size_t i = 0 ; i < types.size() ; i++){
+		if (!token_is(types[i], "m<d>") && !token_is(types[i], "m<b>") && !token_is(types[i], "m<s>")){
+			err_str = "Failed on line " + std::to_string(openedOnLine+1) + ".\n\tType '" + std::string(types[i].p, types[i].len) + "' is invalid.";
+			return false;
+		}
+		all_types += types[i].p[2];
+		all_names.push_back(std::string(names[i].p, names[i].len));
+	}
+
+	//Descriptions sit between question marks
+	all_descs.assign(all_names.size(), "");
+	if (decl.size() == 3){
+		std::vector<std::string> descs = gstd::parse(decl[2], "?");
+		if (descs.size() != all_descs.size()){
+			err_str = "Failed on line " + std::to_string(openedOnLine+1) + ".\n\tNumber of type declarations, names, and descriptions (if present) must match.";
+			return false;
+		}
+		for (size_t i = 0 ; i < descs.size() ; i++){
+			gstd::trim_whitespace(descs[i]);
+			all_descs[i] = descs[i];
+		}
+	}
+
+	return true;
+}
+
+/*
+Reads the next line of the file into 'line' and its offset into 'line_start'.
+Returns false at the end of the file. In follow mode, also returns false if the
+line has no newline yet; then 'waiting' is true and the file is left at the
+start of the line so it is read again once complete.
+*/
+bool DDFVerticalReader::readLine(std::streamoff& line_start, bool& waiting){
+
+	waiting = false;
+	line_start = file.tellg();
+
+	bool got = (bool)getline(file, line);
+	if (follow_mode && (!got || file.eof())){
+		file.clear();
+		file.seekg(line_start);
+		waiting = true;
+		return false;
+	}
+
+	return got;
+}
+
+/*
+Called on reading a closing #VERTICAL statement that started at 'line_start'.
+In follow mode, returns true if it is the last thing in the file - the writer
+may still replace it with more rows - and leaves the file at the statement so
+the next call reads it again.
+*/
+bool DDFVerticalReader::provisionalEnd(std::streamoff line_start){
+
+	if (!follow_mode) return false;
+
+	bool last = (file.peek() == std::char_traits<char>::eof());
+	file.clear();
+	if (!last) return false;
+
+	file.seekg(line_start);
+	return true;
+}
+
+/*
+Empties 'batch' and sizes its columns for 'rows' rows. Buffers only grow, so
+refilling a batch doesn't allocate after the first call.
+*/
+void DDFVerticalReader::prepare(DDFBatch& batch, size_t rows){
+
+	batch.num_rows = 0;
+	batch.cols.resize(selected.size());
+
+	for (size_t k = 0 ; k < selected.size() ; k++){
+
+		DDFBatchColumn& c = batch.cols[k];
+		c.name = all_names[selected[k]];
+		c.description = all_descs[selected[k]];
+		c.type = all_types[selected[k]];
+		c.count = 0;
+
+		if (c.capacity < rows || !c.row_end){
+			c.b.reset(new bool[rows]);
+			c.row_end.reset(new bool[rows]);
+			c.capacity = rows;
+		}
+
+		switch(c.type){
+			case('d'):
+				if (c.d.size() < rows) c.d.resize(rows);
+				break;
+			case('s'):
+				if (c.s.size() < rows) c.s.resize(rows);
+				break;
+		}
+	}
+}
+
+#endif
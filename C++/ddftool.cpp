@@ -0,0 +1,550 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "cppddf.hpp"
+#include "ddfbatch.hpp"
+#include "ddfstream.hpp"
+
+/*
+Command-line utility for inspecting and converting DDF files (see 'make
+ddftool'). Run without arguments for usage.
+
+info, cat, head and stats stream through the file and never hold more than a
+batch of rows, so they work on files larger than memory. validate reads the
+file one line at a time without storing it, so it does too. convert and bench
+go through DDFIO and need the file to fit in memory.
+*/
+
+//***************************************************************************//
+//**			TYPE DEFINITIONS										   **//
+//***************************************************************************//
+
+#define TOOL_BATCH 65536 //Rows per batch when streaming
+
+/*
+One variable found by scan_file().
+*/
+typedef struct{
+	std::string name;
+	std::string type;	//As declared, eg. "d" or "m<d>"
+	size_t rows;
+	size_t elements;
+	bool matrix;
+	long block;			//Vertical block, or -1 if inline
+}ToolVar;
+
+/*
+Command-line options shared by the subcommands.
+*/
+typedef struct{
+	std::vector<std::string> args; //Positional arguments after the subcommand
+	size_t block;
+	size_t count;
+	size_t repeats;
+	size_t max_errors;
+	bool vertical;
+	bool compact;
+}ToolArgs;
+
+//***************************************************************************//
+//**			PRIVATE FUNCTION DEFINITIONS							   **//
+//***************************************************************************//
+
+/*
+Prints usage to stderr.
+*/
+static void usage(){
+	std::cerr << "Usage: ddftool <command> [options] <file> [columns...]\n"
+		"\n"
+		"Commands:\n"
+		"\tinfo <file>                  List variables and their shapes\n"
+		"\tvalidate <file> [-e N]       Check the file, reporting up to N errors (0: all)\n"
+		"\tconvert <in> <out> [-v] [-c] Rewrite the file; -v vertical, -c compact\n"
+		"\tcat <file> [columns]         Print a vertical block's columns\n"
+		"\thead <file> [-n N] [columns] Print the first N rows (default 10)\n"
+		"\tstats <file> [columns]       Count, sum, mean, min and max of m<d> columns\n"
+		"\tbench <file> [-r N]          Time loading and writing, best of N runs (default 5)\n"
+		"\n"
+		"cat, head and stats read vertical block 0 unless given '-b <block>'.\n";
+}
+
+/*
+Reads the options and positional arguments following the subcommand. Returns
+false on an unknown or incomplete option.
+*/
+static bool parse_args(int argc, char** argv, ToolArgs& a){
+
+	a.block = 0;
+	a.count = 10;
+	a.repeats = 5;
+	a.max_errors = 1;
+	a.vertical = false;
+	a.compact = false;
+
+	for (int i = 2 ; i < argc ; i++){
+
+		std::string s = argv[i];
+		if (s == "-v"){
+			a.vertical = true;
+		}else if (s == "-c"){
+			a.compact = true;
+		}else if (s == "-b" || s == "-n" || s == "-r" || s == "-e"){
+			if (i+1 >= argc) return false;
+			size_t n = strtoul(argv[++i], NULL, 10);
+			if (s == "-b") a.block = n;
+			else if (s == "-n") a.count = n;
+			else if (s == "-r") a.repeats = (n > 0) ? n : 1;
+			else a.max_errors = n;
+		}else if (s.length() > 1 && s[0] == '-'){
+			return false;
+		}else{
+			a.args.push_back(s);
+		}
+	}
+
+	return true;
+}
+
+/*
+Tokenizes 'line' into 'toks' and drops any trailing comment.
+*/
+static void tool_tokens(const std::string& line, std::vector<DDFToken>& toks){
+
+	tokenize_line(line.c_str(), line.length(), "", toks, true);
+	for (size_t i = 0 ; i < toks.size() ; i++){
+		if (toks[i].len >= 2 && toks[i].p[0] == '/' && toks[i].p[1] == '/'){
+			toks.resize(i);
+			break;
+		}
+	}
+}
+
+/*
+Lists the variables in 'fileIn' with their shapes by scanning its structure.
+Matrix elements are counted from the separators, without being converted.
+*/
+static bool scan_file(std::string fileIn, std::vector<ToolVar>& vars, std::string& err){
+
+	std::ifstream file(fileIn.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open()){
+		err = "Failed to open file '" + fileIn + "'.";
+		return false;
+	}
+
+	std::string line;
+	std::vector<DDFToken> toks;
+	DDFStructIndex sidx;
+	size_t lineNum = 0;
+	long blocks = 0;
+
+	while (getline(file, line)){
+
+		lineNum++;
+		tool_tokens(line, toks);
+		if (toks.size() == 0) continue;
+
+		std::string first(toks[0].p, toks[0].len);
+
+		if (first == "#VERSION"){
+			continue;
+		}else if (first == "#HEADER"){ //Skip header - it may contain anything
+			while (getline(file, line)){
+				lineNum++;
+				tool_tokens(line, toks);
+				if (toks.size() > 0 && token_is(toks[0], "#HEADER")) break;
+			}
+		}else if (first == "#VERTICAL"){
+
+			size_t first_var = vars.size();
+			size_t decl = 0; //Declaration lines read
+			std::vector<size_t> last_row; //Element count at each column's last ';'
+			bool closed = false;
+
+			while (getline(file, line)){
+
+				lineNum++;
+				tool_tokens(line, toks);
+				if (toks.size() == 0) continue;
+				if (token_is(toks[0], "#VERTICAL")){
+					closed = true;
+					break;
+				}
+
+				if (decl == 0){ //Types
+					for (size_t i = 0 ; i < toks.size() ; i++){
+						ToolVar v;
+						v.type = std::string(toks[i].p, toks[i].len);
+						v.rows = 0;
+						v.elements = 0;
+						v.matrix = true;
+						v.block = blocks;
+						vars.push_back(v);
+					}
+					last_row.assign(toks.size(), 0);
+					decl++;
+				}else if (decl == 1){ //Names
+					if (toks.size() != vars.size() - first_var){
+						err = "Failed on line " + std::to_string(lineNum) + ".\n\tNumber of type declarations and names must match.";
+						return false;
+					}
+					for (size_t i = 0 ; i < toks.size() ; i++){
+						vars[first_var+i].name = std::string(toks[i].p, toks[i].len);
+					}
+					decl++;
+				}else if (decl == 2 && toks[0].p[0] == '?'){ //Descriptions
+					decl++;
+				}else{
+					decl = 3;
+					for (size_t i = 0 ; i < toks.size() && first_var+i < vars.size() ; i++){
+						ToolVar& v = vars[first_var+i];
+						v.elements++;
+						if (toks[i].p[toks[i].len-1] == ';'){
+							v.rows++;
+							last_row[i] = v.elements;
+						}
+					}
+				}
+			}
+
+			if (!closed){
+				err = "Failed on line " + std::to_string(lineNum) + ".\n\tFailed to find closing #VERTICAL statement.";
+				return false;
+			}
+
+			//Elements after the last ';' form the last row
+			for (size_t i = first_var ; i < vars.size() ; i++){
+				if (vars[i].elements > last_row[i-first_var]) vars[i].rows++;
+			}
+
+			blocks++;
+		}else{ //Inline statement
+
+			if (toks.size() < 2){
+				err = "Failed on line " + std::to_string(lineNum) + ".\n\tInsufficient number of tokens for inline variable statement.";
+				return false;
+			}
+
+			ToolVar v;
+			v.type = first;
+			v.name = std::string(toks[1].p, toks[1].len);
+			v.block = -1;
+			v.matrix = (first.length() == 4 && first[0] == 'm');
+			v.rows = 1;
+			v.elements = 1;
+
+			if (v.matrix){
+				simd_scan_structure(line.c_str(), line.length(), sidx);
+				if (sidx.open == DDF_NPOS || sidx.close == DDF_NPOS){
+					err = "Failed on line " + std::to_string(lineNum) + ".\n\tFor variable '" + v.name + "': Failed to find square brackets.";
+					return false;
+				}
+
+				bool empty = true;
+				for (size_t i = sidx.open+1 ; i < sidx.close ; i++){
+					if (line[i] != ' ' && line[i] != '\t'){
+						empty = false;
+						break;
+					}
+				}
+
+				v.rows = empty ? 0 : sidx.semis + 1;
+				v.elements = empty ? 0 : sidx.commas + sidx.semis + 1;
+			}
+
+			vars.push_back(v);
+		}
+	}
+
+	return true;
+}
+
+/*
+Describes the shape of 'v', eg. "scalar", "12" or "3 rows, 12 el.".
+*/
+static std::string shape_of(const ToolVar& v){
+
+	if (!v.matrix) return "scalar";
+	if (v.rows > 1) return std::to_string(v.rows) + " rows, " + std::to_string(v.elements) + " el.";
+	return std::to_string(v.elements);
+}
+
+/*
+Opens vertical block 'a.block' of 'fileIn', with the columns named in the
+remaining positional arguments (all if none).
+*/
+static bool open_block(DDFVerticalReader& rd, const ToolArgs& a){
+
+	std::vector<std::string> columns(a.args.begin()+1, a.args.end());
+	if (!rd.open(a.args[0], a.block, columns)){
+		std::cerr << rd.err() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+Prints rows of a vertical block, tab separated, starting with a line of names.
+Stops after 'limit' rows.
+*/
+static int print_rows(const ToolArgs& a, size_t limit){
+
+	DDFVerticalReader rd;
+	if (!open_block(rd, a)) return 1;
+
+	std::vector<std::string> names = rd.names();
+	std::string out;
+	for (size_t k = 0 ; k < names.size() ; k++){
+		if (k != 0) out += "\t";
+		out += names[k];
+	}
+	std::cout << out << "\n";
+
+	DDFBatch batch;
+	size_t printed = 0;
+	while (printed < limit && rd.next(batch, std::min((size_t)TOOL_BATCH, limit - printed))){
+
+		out.clear();
+		for (size_t r = 0 ; r < batch.rows() ; r++){
+			for (size_t k = 0 ; k < batch.columns() ; k++){
+				if (k != 0) out += "\t";
+				switch(batch.type(k)){
+					case('d'):
+						if (r < batch.doubles(k).size()) out += element_string(batch.doubles(k)[r]);
+						break;
+					case('b'):
+						if (r < batch.bools(k).size()) out += element_string(batch.bools(k)[r]);
+						break;
+					default:
+						if (r < batch.strings(k).size()) out += element_string(batch.strings(k)[r]);
+						break;
+				}
+			}
+			out += "\n";
+		}
+		std::cout << out;
+		printed += batch.rows();
+	}
+
+	if (rd.err() != ""){
+		std::cerr << rd.err() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+Returns the seconds taken by the fastest of 'repeats' calls to 'fn', or a
+negative number if any call fails.
+*/
+template<typename F>
+static double best_time(size_t repeats, F fn){
+
+	double best = -1;
+	for (size_t i = 0 ; i < repeats ; i++){
+		auto t0 = std::chrono::steady_clock::now();
+		if (!fn()) return -1;
+		double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (best < 0 || t < best) best = t;
+	}
+
+	return best;
+}
+
+/*
+Prints one benchmark result.
+*/
+static void print_time(std::string what, double seconds, size_t bytes){
+
+	if (seconds < 0){
+		printf("%-14s failed\n", what.c_str());
+		return;
+	}
+
+	printf("%-14s %10.3f ms %10.1f MB/s\n", what.c_str(), seconds*1e3, bytes / seconds / 1e6);
+}
+
+//***************************************************************************//
+//***************** COMMANDS
+
+static int cmd_info(const ToolArgs& a){
+
+	std::vector<ToolVar> vars;
+	std::string err;
+	if (!scan_file(a.args[0], vars, err)){
+		std::cerr << err << std::endl;
+		return 1;
+	}
+
+	size_t w = 4;
+	for (size_t i = 0 ; i < vars.size() ; i++){
+		w = std::max(w, vars[i].name.length());
+	}
+
+	printf("%-*s  %-5s  %-22s  %s\n", (int)w, "Name", "Type", "Shape", "Location");
+	for (size_t i = 0 ; i < vars.size() ; i++){
+		std::string where = (vars[i].block < 0) ? "inline" : "vertical block " + std::to_string(vars[i].block);
+		printf("%-*s  %-5s  %-22s  %s\n", (int)w, vars[i].name.c_str(), vars[i].type.c_str(), shape_of(vars[i]).c_str(), where.c_str());
+	}
+	printf("%zu variables, %zu bytes\n", vars.size(), fileSize(a.args[0]));
+
+	return 0;
+}
+
+static int cmd_validate(const ToolArgs& a){
+
+	DDFIO ddf;
+	if (!ddf.validate(a.args[0], a.max_errors)){
+		std::cerr << ddf.err() << std::endl;
+		return 1;
+	}
+
+	std::cout << a.args[0] << " is valid." << std::endl;
+	return 0;
+}
+
+static int cmd_convert(const ToolArgs& a){
+
+	if (a.args.size() < 2){
+		usage();
+		return 2;
+	}
+
+	DDFIO ddf;
+	if (!ddf.load(a.args[0])){
+		std::cerr << ((ddf.err() != "") ? ddf.err() : "Failed to open or identify file '" + a.args[0] + "'.") << std::endl;
+		return 1;
+	}
+
+	std::string options;
+	if (a.vertical) options += "v";
+	if (a.compact) options += "o";
+
+	if (!ddf.write(a.args[1], options)){
+		std::cerr << "Failed to write file '" << a.args[1] << "'." << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int cmd_stats(const ToolArgs& a){
+
+	DDFVerticalReader rd;
+	if (!open_block(rd, a)) return 1;
+
+	std::vector<std::string> names = rd.names();
+	std::string types = rd.types();
+	std::vector<DDFStats> st(names.size());
+	for (size_t k = 0 ; k < st.size() ; k++){
+		st[k] = simd_reduce((const double*)NULL, 0);
+	}
+
+	DDFBatch batch;
+	while (rd.next(batch, TOOL_BATCH)){
+		for (size_t k = 0 ; k < batch.columns() ; k++){
+			if (types[k] != 'd') continue;
+			DDFSpan<double> v = batch.doubles(k);
+			simd_merge_stats(st[k], simd_reduce(v.data(), v.size()), st[k].count);
+		}
+	}
+
+	if (rd.err() != ""){
+		std::cerr << rd.err() << std::endl;
+		return 1;
+	}
+
+	printf("%-16s %12s %14s %14s %14s %14s\n", "Column", "Count", "Sum", "Mean", "Min", "Max");
+	for (size_t k = 0 ; k < names.size() ; k++){
+		if (types[k] != 'd'){
+			printf("%-16s (m<%c>, skipped)\n", names[k].c_str(), types[k]);
+			continue;
+		}
+		printf("%-16s %12zu %14.6g %14.6g %14.6g %14.6g\n", names[k].c_str(), st[k].count, st[k].sum, st[k].mean, st[k].min, st[k].max);
+	}
+
+	return 0;
+}
+
+static int cmd_bench(const ToolArgs& a){
+
+	std::string fileIn = a.args[0];
+	size_t bytes = fileSize(fileIn);
+
+	DDFIO ddf;
+	if (!ddf.load(fileIn)){
+		std::cerr << ((ddf.err() != "") ? ddf.err() : "Failed to open or identify file '" + fileIn + "'.") << std::endl;
+		return 1;
+	}
+	size_t out_bytes = ddf.swrite("").length();
+
+	printf("%s: %zu bytes, %zu variables, best of %zu\n", fileIn.c_str(), bytes, ddf.numVar(), a.repeats);
+
+	print_time("load", best_time(a.repeats, [&](){
+		DDFIO d;
+		return d.load(fileIn);
+	}), bytes);
+
+	print_time("validate", best_time(a.repeats, [&](){
+		DDFIO d;
+		return d.validate(fileIn);
+	}), bytes);
+
+	print_time("swrite", best_time(a.repeats, [&](){
+		return ddf.swrite("") != "";
+	}), out_bytes);
+
+	print_time("swrite (par)", best_time(a.repeats, [&](){
+		return ddf.swrite("", "p") != "";
+	}), out_bytes);
+
+	//Only if the file has a vertical block
+	DDFVerticalReader probe;
+	if (probe.open(fileIn)){
+		probe.close();
+		print_time("stream", best_time(a.repeats, [&](){
+			DDFVerticalReader rd;
+			DDFBatch batch;
+			if (!rd.open(fileIn)) return false;
+			while (rd.next(batch, TOOL_BATCH));
+			return (rd.err() == "");
+		}), bytes);
+	}
+
+	return 0;
+}
+
+//***************************************************************************//
+//**			MAIN													   **//
+//***************************************************************************//
+
+int main(int argc, char** argv){
+
+	if (argc < 3){
+		usage();
+		return 2;
+	}
+
+	std::string cmd = argv[1];
+	ToolArgs a;
+	if (!parse_args(argc, argv, a) || a.args.size() < 1){
+		usage();
+		return 2;
+	}
+
+	if (cmd == "info") return cmd_info(a);
+	if (cmd == "validate") return cmd_validate(a);
+	if (cmd == "convert") return cmd_convert(a);
+	if (cmd == "cat") return print_rows(a, DDF_NPOS);
+	if (cmd == "head") return print_rows(a, a.count);
+	if (cmd == "stats") return cmd_stats(a);
+	if (cmd == "bench") return cmd_bench(a);
+
+	usage();
+	return 2;
+}
@@ -0,0 +1,82 @@
+import math
+import sys
+from pyddf import DDFIO
+from cppddf_bridge import NativeDDFIO
+
+# Checks that the Python reader agrees with the C++ reader (through
+# cppddf_bridge, so libcppddf must be built). Each file is loaded with both, and
+# any difference in whether it loads, which variables it holds, or their values
+# is printed. Exits with 1 if any file differs.
+#
+#	python3 check_parity.py ../examples/*.ddf
+#
+
+def plain(x):
+	""" Converts a value (or matrix, memoryview or ndarray) to nested lists """
+
+	if isinstance(x, (str, bool, float, int)):
+		return x
+	if hasattr(x, "tolist"):
+		return x.tolist()
+	return [plain(v) for v in x]
+
+def same(a, b):
+	""" Compares values, counting NaNs as equal """
+
+	if isinstance(a, list) and isinstance(b, list):
+		return len(a) == len(b) and all(same(x, y) for x, y in zip(a, b))
+	if isinstance(a, float) and isinstance(b, float) and math.isnan(a) and math.isnan(b):
+		return True
+	return type(a) == type(b) and a == b
+
+def variables(ddf):
+	""" Returns {name: (dimension, type, value)} for all variables of 'ddf' """
+
+	out = {}
+	for item in ddf.varsFlat + ddf.vars1D + ddf.vars2D:
+		out[item.name] = (item.dimension, item.type, plain(item.val))
+	return out
+
+def compare(fileIn:str):
+	""" Loads 'fileIn' with both readers. Returns a list of differences. """
+
+	py = DDFIO()
+	cpp = NativeDDFIO()
+	py_ok = py.loadDDF_V1(fileIn)
+	cpp_ok = cpp.load(fileIn)
+
+	if py_ok != cpp_ok:
+		return [f"Python {'loads' if py_ok else 'fails'} ({py.err().strip()}), C++ {'loads' if cpp_ok else 'fails'} ({cpp.err().strip()})"]
+	if not py_ok:
+		return []
+
+	py_vars = variables(py)
+	cpp_vars = variables(cpp)
+
+	diffs = []
+	if len(py_vars) != len(cpp_vars):
+		diffs.append(f"Python read {len(py_vars)} variables, C++ read {len(cpp_vars)}")
+
+	for name in sorted(set(py_vars) | set(cpp_vars)):
+		if name not in py_vars:
+			diffs.append(f"'{name}' missing from Python")
+		elif name not in cpp_vars:
+			diffs.append(f"'{name}' missing from C++")
+		elif py_vars[name][0:2] != cpp_vars[name][0:2]:
+			diffs.append(f"'{name}' is {py_vars[name][0:2]} in Python, {cpp_vars[name][0:2]} in C++")
+		elif not same(py_vars[name][2], cpp_vars[name][2]):
+			diffs.append(f"'{name}' is {py_vars[name][2]} in Python, {cpp_vars[name][2]} in C++")
+
+	return diffs
+
+if __name__ == "__main__":
+
+	failed = False
+	for fileIn in sys.argv[1:]:
+		diffs = compare(fileIn)
+		print(f"{fileIn}: {'ok' if len(diffs) == 0 else 'DIFFERENT'}")
+		for d in diffs:
+			print(f"\t{d}")
+		failed = failed or len(diffs) > 0
+
+	sys.exit(1 if failed else 0)
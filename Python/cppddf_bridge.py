@@ -0,0 +1,283 @@
+import ctypes
+import os
+import sys
+from ddf_types import *
+from pyddf import DDFIO
+
+# Optional pyddf backend that reads and writes files with the C++ library
+# (libcppddf, built with 'make libcppddf' in C++/). The library is looked for
+# at $CPPDDF_LIB, then next to the C++ sources.
+#
+#	from cppddf_bridge import NativeDDFIO
+#
+#	ddf = NativeDDFIO("data.ddf")
+#	x = ddf("freqs").val		# memoryview onto the C++ data, no copy
+#
+# m<d> matrices are memoryviews onto the loaded data (one per row for 2D
+# matrices) and share its lifetime, so they stay valid after the NativeDDFIO
+# that made them is gone. m<b> and m<s> matrices are copied into lists.
+
+#***************** LIBRARY *************************************************#
+
+class _cddf_var(ctypes.Structure):
+	_fields_ = [("name", ctypes.c_void_p),
+				("name_len", ctypes.c_size_t),
+				("description", ctypes.c_void_p),
+				("description_len", ctypes.c_size_t),
+				("type", ctypes.c_char),
+				("dims", ctypes.c_int),
+				("single", ctypes.c_int),
+				("rows", ctypes.c_size_t),
+				("cols", ctypes.c_size_t),
+				("elements", ctypes.c_size_t)]
+
+_lib = None
+
+def _libraryPath():
+	""" Returns the path to libcppddf """
+
+	if "CPPDDF_LIB" in os.environ:
+		return os.environ["CPPDDF_LIB"]
+
+	ext = "dylib" if sys.platform == "darwin" else "so"
+	here = os.path.dirname(os.path.abspath(__file__))
+	return os.path.join(here, "..", "C++", "libcppddf." + ext)
+
+def _library():
+	""" Loads libcppddf and declares its functions on first use """
+
+	global _lib
+	if _lib is not None:
+		return _lib
+
+	lib = ctypes.CDLL(_libraryPath())
+
+	P = ctypes.c_void_p
+	S = ctypes.c_size_t
+	C = ctypes.c_char_p
+	PS = ctypes.POINTER(ctypes.c_size_t)
+
+	sigs = {
+		"cddf_create": ([], P),
+		"cddf_destroy": ([P], None),
+		"cddf_load": ([P, C, C], ctypes.c_int),
+		"cddf_load_string": ([P, C, S, C], ctypes.c_int),
+		"cddf_write": ([P, C, C], ctypes.c_int),
+		"cddf_swrite": ([P, C, PS], P),
+		"cddf_err": ([P], C),
+		"cddf_header": ([P], C),
+		"cddf_version": ([P], ctypes.c_double),
+		"cddf_num_vars": ([P], S),
+		"cddf_info": ([P, S, ctypes.POINTER(_cddf_var)], ctypes.c_int),
+		"cddf_row_length": ([P, S, S], S),
+		"cddf_get_double": ([P, S, ctypes.POINTER(ctypes.c_double)], ctypes.c_int),
+		"cddf_get_bool": ([P, S, ctypes.POINTER(ctypes.c_int)], ctypes.c_int),
+		"cddf_get_string": ([P, S, S, S, PS], P),
+		"cddf_doubles": ([P, S, S, PS], P),
+		"cddf_floats": ([P, S, S, PS], P),
+		"cddf_get_bools": ([P, S, S, ctypes.POINTER(ctypes.c_ubyte), S], S),
+	}
+
+	for name, (args, res) in sigs.items():
+		f = getattr(lib, name)
+		f.argtypes = args
+		f.restype = res
+
+	_lib = lib
+	return _lib
+
+def available():
+	""" Returns True if libcppddf can be loaded """
+
+	try:
+		_library()
+		return True
+	except OSError:
+		return False
+
+def _text(ptr, n):
+	""" Decodes 'n' bytes at 'ptr' """
+	if n == 0:
+		return ""
+	return ctypes.string_at(ptr, n).decode("utf-8", errors="replace")
+
+class _Handle():
+	""" Owns one C++ DDFIO object. Buffers exported from it keep a reference. """
+
+	def __init__(self):
+		self.lib = _library()
+		self.ptr = self.lib.cddf_create()
+		if not self.ptr:
+			raise MemoryError("cddf_create() failed")
+
+	def __del__(self):
+		if self.ptr:
+			self.lib.cddf_destroy(self.ptr)
+			self.ptr = None
+
+#***************** DDFIO BACKEND *******************************************#
+
+class NativeDDFIO(DDFIO):
+
+	def __init__(self, fileIn:str=""):
+		""" Initializer that opens a file if provided """
+
+		super().__init__(fileIn)
+
+		self._handle = None
+		self._dirty = True
+
+		if len(fileIn) > 0:
+			self.load(fileIn)
+
+	#************************** FILE I/O **************************************#
+
+	def load(self, fileIn:str, options:str=""):
+		""" Loads a file with the C++ parser. Options are as for DDFIO::load in C++. """
+
+		h = _Handle()
+		if not h.lib.cddf_load(h.ptr, fileIn.encode(), options.encode()):
+			self.logErr(h.lib.cddf_err(h.ptr).decode("utf-8", errors="replace"))
+			return False
+
+		return self._populate(h)
+
+	def loadDDF_V1(self, fileIn:str, options:str=""):
+		return self.load(fileIn, options)
+
+	def loads(self, data:str, options:str=""):
+		""" Loads DDF data from a string """
+
+		h = _Handle()
+		raw = data.encode()
+		if not h.lib.cddf_load_string(h.ptr, raw, len(raw), options.encode()):
+			self.logErr(h.lib.cddf_err(h.ptr).decode("utf-8", errors="replace"))
+			return False
+
+		return self._populate(h)
+
+	def swrite(self, options:str=""):
+		""" Writes with the C++ writer unless variables were changed from Python """
+
+		if self._dirty or self._handle is None or self.header != self._loaded_header:
+			return super().swrite(options)
+
+		h = self._handle
+		n = ctypes.c_size_t(0)
+		ptr = h.lib.cddf_swrite(h.ptr, options.encode(), ctypes.byref(n))
+		if not ptr:
+			self.logErr(h.lib.cddf_err(h.ptr).decode("utf-8", errors="replace"))
+			return None
+
+		return _text(ptr, n.value)
+
+	#********************** VARIABLE MANAGEMENT ******************************#
+
+	def add(self, newVar, varName:str, desc:str=""):
+		self._dirty = True
+		return super().add(newVar, varName, desc)
+
+	def clear(self):
+		self._dirty = True
+		super().clear()
+
+	#*************************** INTERNAL ************************************#
+
+	def _populate(self, h):
+		""" Replaces the variables with those loaded into handle 'h' """
+
+		varsFlat = []
+		vars1D = []
+		vars2D = []
+
+		info = _cddf_var()
+		for idx in range(h.lib.cddf_num_vars(h.ptr)):
+
+			if not h.lib.cddf_info(h.ptr, idx, ctypes.byref(info)):
+				self.logErr(h.lib.cddf_err(h.ptr).decode("utf-8", errors="replace"))
+				return False
+
+			item = DDFItem.__new__(DDFItem)
+			item.name = _text(info.name, info.name_len)
+			item.desc = _text(info.description, info.description_len)
+			item.type = info.type.decode()
+			item.dimension = info.dims
+
+			if info.dims == FLAT:
+				item.val = self._readFlat(h, idx, item.type)
+				varsFlat.append(item)
+			elif info.dims == M1D:
+				item.val = self._readRow(h, idx, 0, info)
+				vars1D.append(item)
+			else:
+				item.val = [self._readRow(h, idx, r, info) for r in range(info.rows)]
+				vars2D.append(item)
+
+		self.varsFlat = varsFlat
+		self.vars1D = vars1D
+		self.vars2D = vars2D
+
+		self.header = h.lib.cddf_header(h.ptr).decode("utf-8", errors="replace")
+		self.fileVersion = h.lib.cddf_version(h.ptr)
+
+		self._loaded_header = self.header
+		self._handle = h
+		self._dirty = False
+
+		return True
+
+	def _readFlat(self, h, idx, type):
+		""" Reads a d, b or s variable """
+
+		if type == DOUBLE:
+			x = ctypes.c_double()
+			h.lib.cddf_get_double(h.ptr, idx, ctypes.byref(x))
+			return x.value
+		elif type == BOOL:
+			x = ctypes.c_int()
+			h.lib.cddf_get_bool(h.ptr, idx, ctypes.byref(x))
+			return x.value != 0
+		else:
+			n = ctypes.c_size_t(0)
+			ptr = h.lib.cddf_get_string(h.ptr, idx, 0, 0, ctypes.byref(n))
+			return _text(ptr, n.value)
+
+	def _readRow(self, h, idx, row, info):
+		""" Reads a 1D matrix or one row of a 2D matrix """
+
+		type = info.type.decode()
+
+		if type == DOUBLE:
+
+			n = ctypes.c_size_t(0)
+			if info.single:
+				ptr = h.lib.cddf_floats(h.ptr, idx, row, ctypes.byref(n))
+				ctype = ctypes.c_float
+			else:
+				ptr = h.lib.cddf_doubles(h.ptr, idx, row, ctypes.byref(n))
+				ctype = ctypes.c_double
+
+			fmt = "f" if info.single else "d"
+			if not ptr or n.value == 0:
+				return memoryview(b"").cast(fmt)
+
+			arr = (ctype * n.value).from_address(ptr)
+			arr._owner = h # Keeps the C++ data alive while the view is in use
+			return memoryview(arr).cast("B").cast(fmt).toreadonly() # Native format instead of ctypes' '<d'
+
+
+		elif type == BOOL:
+
+			n = h.lib.cddf_row_length(h.ptr, idx, row)
+			buf = (ctypes.c_ubyte * max(n, 1))()
+			h.lib.cddf_get_bools(h.ptr, idx, row, buf, n)
+			return [buf[k] != 0 for k in range(n)]
+
+		else:
+
+			out = []
+			n = ctypes.c_size_t(0)
+			for col in range(h.lib.cddf_row_length(h.ptr, idx, row)):
+				ptr = h.lib.cddf_get_string(h.ptr, idx, row, col, ctypes.byref(n))
+				out.append(_text(ptr, n.value))
+			return out
@@ -75,7 +75,7 @@ class DDFItem():
 		if self.type == DOUBLE:
 			return str(X) #TODO: Make the formatting of doubles more intelligent
 		elif self.type == STRING:
-			return "\"" + X + "\""
+			return escapeString(X)
 		elif self.type == BOOL:
 			if X:
 				return "True"
@@ -128,6 +128,31 @@ class DDFItem():
 			return outstr + "]"
 
 
+# Returns 'x' as a DDF string literal, quotes included. The inverse of
+# unescapeString() in helpers.py.
+#
+def escapeString(x:str):
+
+	out = ['"']
+	idx = 0
+	n = len(x)
+	while idx < n:
+
+		run = 0
+		while idx + run < n and x[idx+run] == '\\':
+			run += 1
+
+		if idx + run == n or x[idx+run] == '"': # Run (possibly empty) before a quote or the end
+			out.append('\\'*(2*run))
+			if idx + run < n:
+				out.append('\\"')
+		else:
+			out.append(x[idx:idx+run+1])
+		idx += run + 1
+
+	out.append('"')
+	return "".join(out)
+
 def getType(value):
 
 	it_val = value
@@ -172,3 +197,16 @@ def getTypeSymbol(depth, type):
 		return f"m<{base_sym}>"
 	else:
 		return "?<?>"
+
+def makeItem(value, name:str, type, dimension, desc:str=""):
+	""" Creates a DDFItem with the given type and dimension without inspecting
+	'value', so matrices can be any sequence (eg. a NumPy array). """
+
+	item = DDFItem.__new__(DDFItem)
+	item.type = type
+	item.dimension = dimension
+	item.val = value
+	item.name = name
+	item.desc = desc
+
+	return item
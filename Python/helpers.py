@@ -36,6 +36,159 @@ def parseIdxKeep(input:str, delims:str=" ", keep_delims:str=""):
 
 	return out
 
+# Returns 'line' with any '//' comment removed. Comment markers inside double
+# quoted strings are ignored. A quote after an odd number of backslashes is
+# escaped (\") and doesn't end a string, as in the C++ reader.
+#
+def stripComment(line:str):
+
+	# Quick path for lines without strings
+	if '"' not in line:
+		idx = line.find("//")
+		return line if idx == -1 else line[0:idx]
+
+	in_str = False
+	escaped = False
+	for idx, c in enumerate(line):
+		if escaped:
+			escaped = False
+		elif c == '\\':
+			escaped = True
+		elif c == '"':
+			in_str = not in_str
+		elif c == '/' and not in_str and line[idx+1:idx+2] == '/':
+			return line[0:idx]
+
+	return line
+
+# Splits 'input' at characters in 'delims', but keeps double quoted strings
+# (including the quotes) in one piece.
+#
+def splitQuoted(input:str, delims:str=" \t"):
+
+	out = []
+	tok = []
+	in_str = False
+	escaped = False
+	for c in input:
+		if escaped:
+			escaped = False
+		elif c == '\\':
+			escaped = True
+		elif c == '"':
+			in_str = not in_str
+		if c in delims and not in_str:
+			if len(tok) > 0:
+				out.append("".join(tok))
+				tok = []
+		else:
+			tok.append(c)
+
+	if len(tok) > 0:
+		out.append("".join(tok))
+
+	return out
+
+# Returns the index of the first ']' in 'input' at or after 'start' which is
+# not inside a double quoted string, or -1 if there is none.
+#
+def findClosingBracket(input:str, start:int=0):
+
+	in_str = False
+	escaped = False
+	for idx in range(start, len(input)):
+		c = input[idx]
+		if escaped:
+			escaped = False
+		elif c == '\\':
+			escaped = True
+		elif c == '"':
+			in_str = not in_str
+		elif c == ']' and not in_str:
+			return idx
+
+	return -1
+
+# Returns the offsets of the opening and closing quotes of the first string
+# literal in 's' at or after 'start', or None if there isn't a complete one.
+# Quotes escaped with a backslash don't count (see stripComment).
+#
+def findStringLiteral(s:str, start:int=0):
+
+	q1 = -1
+	escaped = False
+	for idx in range(start, len(s)):
+		c = s[idx]
+		if escaped:
+			escaped = False
+		elif c == '\\':
+			escaped = True
+		elif c == '"':
+			if q1 == -1:
+				q1 = idx
+			else:
+				return (q1, idx)
+
+	return None
+
+# Removes the escapes from the text between the quotes of a string literal.
+# Backslashes are only special before a quote or at the end: there each pair
+# stands for one backslash, and an odd one out escapes the quote. Others are
+# kept as written. Matches unescape_string() in the C++ reader.
+#
+def unescapeString(s:str):
+
+	out = []
+	idx = 0
+	n = len(s)
+	while idx < n:
+
+		if s[idx] != '\\':
+			out.append(s[idx])
+			idx += 1
+			continue
+
+		run = 0
+		while idx + run < n and s[idx+run] == '\\':
+			run += 1
+
+		if idx + run < n and s[idx+run] != '"': # Ordinary backslashes
+			out.append(s[idx:idx+run])
+			idx += run
+			continue
+
+		out.append('\\'*(run//2))
+		idx += run
+		if run % 2 == 1 and idx < n: # Escaped quote
+			out.append('"')
+			idx += 1
+
+	return "".join(out)
+
+# Returns the contents of the first string literal in 's', with escapes
+# removed, or None if there isn't one. Text around the literal is ignored, as
+# in the C++ reader.
+#
+def unquote(s:str):
+
+	q = findStringLiteral(s)
+	if q is None:
+		return None
+
+	return unescapeString(s[q[0]+1:q[1]])
+
+# Converts a DDF boolean ("true"/"false" in any case). Returns None if invalid.
+#
+def toBool(s:str):
+
+	s = s.strip().upper()
+	if s == "TRUE":
+		return True
+	elif s == "FALSE":
+		return False
+
+	return None
+
 # def parseIdx(input:str, delims:str=" ", keep_delims:str=""):
 #
 # 	for in
@@ -1,5 +1,11 @@
 from ddf_types import *
 from helpers import *
+
+try:
+	import numpy as np
+except ImportError:
+	np = None
+
 class DDFIO:
 
 	#***************** INITIALIZERS *******************************************#
@@ -261,8 +267,8 @@ class DDFIO:
 		if not name[0].isalpha():
 			return False;
 
-		# All characters are alphanumeric
-		if not name.isalnum():
+		# All characters are alphanumeric or underscores
+		if not name.replace("_", "").isalnum():
 			return False
 
 		return True
@@ -270,6 +276,19 @@ class DDFIO:
 	#************************** FILE I/O **************************************#
 
 	def loadDDF_V1(self, fileIn:str, options:str=""):
+		""" Reads a version 1 or 2 DDF file.
+
+		Options:
+			n: NumPy mode. m<d> data is converted in bulk rather than value by
+			   value and stored as float64 ndarrays: one array per column of a
+			   vertical block, and one 2D array per rectangular 2D matrix (a list
+			   of 1D arrays if its rows differ in length).
+		"""
+
+		use_numpy = ("n" in options)
+		if use_numpy and np is None:
+			self.logErr("NumPy mode requires numpy, which could not be imported.")
+			return False
 
 		with open(fileIn) as file:
 
@@ -346,6 +365,38 @@ class DDFIO:
 					if not foundHeader:
 						self.logErr(f"Failed on line {openedOnLine}, failed to find closing #HEADER statement.")
 						return False
+				elif words[0].str == "#VERTICAL":
+
+					openedOnLine = lnum
+					block = []
+					line_nums = []
+
+					foundBlock = False
+
+					#Keep reading lines until closing statement found
+					for line in file:
+						lnum += 1
+
+						#Remove comments and skip blank lines
+						line = stripComment(line.rstrip("\n"))
+						first = line.lstrip()
+						if len(first) == 0:
+							continue
+
+						if first.startswith("#VERTICAL") and first.split()[0] == "#VERTICAL":
+							foundBlock = True
+							break
+
+						block.append(line)
+						line_nums.append(lnum)
+
+					if not foundBlock:
+						self.logErr(f"Failed on line {openedOnLine}, failed to find closing #VERTICAL statement.")
+						return False
+
+					if not self.readVertical(block, line_nums, openedOnLine, use_numpy):
+						return False
+
 				elif words[0].str == '//':
 					continue
 				elif words[0].str == 'd' or words[0].str == 's' or words[0].str == 'b' or words[0].str == 'm<d>' or words[0].str == 'm<s>' or words[0].str == 'm<b>':
@@ -363,7 +414,7 @@ class DDFIO:
 
 					# Read value
 					optional_features_start = 3
-					if words[0].str == 'd' or words[0] == 'b':
+					if words[0].str == 'd' or words[0].str == 'b':
 
 						if words[0].str == 'd':
 							try:
@@ -400,7 +451,7 @@ class DDFIO:
 								desc_start = wd.idx_end+1;
 
 								temp.desc = line[wd.idx-len(wd.str)-2]
-							elif wd.str == '//':
+							elif wd.str[0:2] == '//':
 								desc_end = wd.idx-1;
 								break #Rest is a comment
 							elif not in_desc:
@@ -414,7 +465,246 @@ class DDFIO:
 							else:
 								temp.desc = line[desc_start:desc_end]
 
-					self.vars1D.append(temp)
+						self.storeItem(temp)
+
+					elif words[0].str == 's':
+
+						q = findStringLiteral(line, words[0].idx_end)
+						if q is None:
+							w2 = words[2].str
+							self.logErr(f"Failed on line {lnum}. Failed to interpret '{w2}' as a string.")
+							return False
+
+						temp = DDFItem(unescapeString(line[q[0]+1:q[1]]), words[1].str)
+
+						# Read optional semicolon and description
+						rest = stripComment(line[q[1]+1:]).strip()
+						if len(rest) > 0 and rest[0] == ';':
+							rest = rest[1:].strip()
+						if len(rest) > 0:
+							if rest[0] != '?':
+								self.logErr(f"Failed on line {lnum}. Superfluous character after variable declaration ({rest}).")
+								return False
+							temp.desc = rest[1:]
+
+						self.storeItem(temp)
+
+					elif words[0].str[0] == 'm':
+
+						temp = self.readInlineMatrix(line, words, lnum, use_numpy)
+						if temp is None:
+							return False
+
+						self.storeItem(temp)
+
+		return True
+
+	def storeItem(self, item:DDFItem):
+		""" Saves a newly read variable in the list for its dimension """
+
+		if item.dimension == FLAT:
+			self.varsFlat.append(item)
+		elif item.dimension == M1D:
+			self.vars1D.append(item)
+		else:
+			self.vars2D.append(item)
+
+	def readInlineMatrix(self, line:str, words:list, lnum:int, use_numpy:bool):
+		""" Reads a one line matrix statement (eg. 'm<d> x [1, 2; 3, 4] ?desc').
+		Returns the new DDFItem, or None on error. """
+
+		type = words[0].str[2]
+
+		# Find matrix body
+		open_idx = line.find('[', words[1].idx_end)
+		close_idx = -1
+		if open_idx != -1:
+			close_idx = findClosingBracket(line, open_idx+1)
+		if close_idx == -1:
+			self.logErr(f"Failed on line {lnum}. Failed to find matrix body in brackets.")
+			return None
+
+		# Read description
+		desc = ""
+		rest = stripComment(line[close_idx+1:])
+		if len(rest.strip()) > 0:
+			if rest.strip()[0] != '?':
+				self.logErr(f"Failed on line {lnum}. Superfluous character after variable declaration ({rest.strip()}).")
+				return None
+			desc = rest[rest.index('?')+1:].rstrip()
+
+		# Split body into rows, then elements
+		body = line[open_idx+1:close_idx]
+		if type == DOUBLE:
+			rows = [r.replace(',', ' ').split() for r in body.split(';')] # Can't contain quotes
+		else:
+			rows = [[x.strip() for x in splitQuoted(r, ",")] for r in splitQuoted(body, ";")]
+
+		# Convert values
+		vals = []
+		for r in rows:
+			v = self.convertValues(type, r, use_numpy)
+			if isinstance(v, str):
+				self.logErr(f"Failed on line {lnum}. {v}")
+				return None
+			vals.append(v)
+
+		if len(vals) == 1:
+			return makeItem(vals[0], words[1].str, type, M1D, desc)
+
+		if use_numpy and type == DOUBLE and all(len(r) == len(vals[0]) for r in vals):
+			vals = np.stack(vals)
+
+		return makeItem(vals, words[1].str, type, M2D, desc)
+
+	def readVertical(self, block:list, line_nums:list, openedOnLine:int, use_numpy:bool):
+		""" Reads the non-blank, comment free lines of a vertical block. Returns
+		True if successful. """
+
+		if len(block) < 3:
+			self.logErr(f"Failed in vertical block beginning on line {openedOnLine}. Found fewer than three non-blank lines.")
+			return False
+
+		types = block[0].split()
+		names = block[1].split()
+		descs = []
+		has_descs = (block[2].strip()[0] == '?')
+		if has_descs:
+			descs = [d.strip() for d in block[2].strip()[1:].split('?')]
+
+		if len(types) != len(names) or (len(descs) > 0 and len(descs) != len(types)):
+			self.logErr(f"Failed on line {line_nums[0]}. Number of type declarations, names, and descriptions (if present) must match.")
+			return False
+
+		for t, n in zip(types, names):
+			if not self.isValidName(n):
+				self.logErr(f"Failed on line {line_nums[1]}. Invalid variable name '{n}'.")
+				return False
+			if t != "m<d>" and t != "m<b>" and t != "m<s>":
+				self.logErr(f"Failed on line {line_nums[0]}. Type '{t}' is invalid.")
+				return False
+
+		if len(descs) == 0:
+			descs = [""]*len(names)
+
+		first = 3 if has_descs else 2
+		data = block[first:]
+		data_nums = line_nums[first:]
+		ncols = len(names)
+
+		# Fast path: a table of doubles with no 2D matrices is converted in one go
+		if use_numpy and all(t == "m<d>" for t in types):
+			text = " ".join(data)
+			if ';' not in text and all(len(l.split()) == ncols for l in data):
+				try:
+					table = np.array(text.split(), dtype=np.float64).reshape(-1, ncols)
+				except ValueError:
+					table = None # Fall back to the general reader to locate the error
+
+				if table is not None:
+					table = np.ascontiguousarray(table.T)
+					for i in range(ncols):
+						self.storeItem(makeItem(table[i], names[i], DOUBLE, M1D, descs[i]))
+					return True
+
+		# Split lines into columns. Columns may end early, but can't restart.
+		tokens = [[] for n in names]
+		token_lines = [[] for n in names]
+		max_allowed = ncols
+		for l, lnum in zip(data, data_nums):
+
+			words = splitQuoted(l) if '"' in l else l.split()
+
+			if len(words) > max_allowed:
+				self.logErr(f"Failed on line {lnum}. Too many characters detected.")
+				return False
+			max_allowed = len(words)
+
+			for i, w in enumerate(words):
+				tokens[i].append(w)
+				token_lines[i].append(lnum)
+
+		# Convert each column, splitting rows at tokens ending in ';'
+		for i in range(ncols):
+
+			rows = []
+			row_lines = []
+			cur = []
+			for w, lnum in zip(tokens[i], token_lines[i]):
+				if w[-1] == ';':
+					cur.append(w[0:-1])
+					rows.append(cur)
+					row_lines.append(lnum)
+					cur = []
+				else:
+					cur.append(w)
+			is_2D = len(rows) > 0
+			if len(cur) > 0 or not is_2D:
+				rows.append(cur)
+				row_lines.append(token_lines[i][-1] if len(token_lines[i]) > 0 else openedOnLine)
+
+			type = types[i][2]
+			vals = []
+			for r, lnum in zip(rows, row_lines):
+				v = self.convertValues(type, r, use_numpy)
+				if isinstance(v, str):
+					self.logErr(f"Failed in vertical block ending on line {lnum}. {v}")
+					return False
+				vals.append(v)
+
+			if is_2D:
+				if use_numpy and type == DOUBLE and all(len(r) == len(vals[0]) for r in vals):
+					vals = np.stack(vals)
+				self.storeItem(makeItem(vals, names[i], type, M2D, descs[i]))
+			else:
+				self.storeItem(makeItem(vals[0], names[i], type, M1D, descs[i]))
+
+		return True
+
+	def convertValues(self, type, words:list, use_numpy:bool):
+		""" Converts the strings in 'words' to values of 'type'. Returns a list
+		(or ndarray for doubles in NumPy mode), or an error message string. """
+
+		if type == DOUBLE:
+
+			if use_numpy:
+				try:
+					return np.array(words, dtype=np.float64)
+				except ValueError:
+					pass
+			else:
+				try:
+					return [float(w) for w in words]
+				except ValueError:
+					pass
+
+			for w in words:
+				try:
+					float(w)
+				except ValueError:
+					return f"Failed to convert value '{w}' to float."
+
+			return [float(w) for w in words]
+
+		elif type == BOOL:
+
+			out = []
+			for w in words:
+				b = toBool(w)
+				if b is None:
+					return f"Unrecognized boolian value '{w}'."
+				out.append(b)
+			return out
+
+		else:
+
+			out = []
+			for w in words:
+				x = unquote(w)
+				if x is None:
+					return f"Failed to read string '{w}'."
+				out.append(x)
+			return out
 
 
 
@@ -2,7 +2,7 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
-#include "../C++/cppddf.hpp"
+#include "../C++/ddfbatch.hpp"
 
 using namespace std;
 
@@ -13,18 +13,18 @@ int main(){
 	test_files.push_back("../examples/read_test2.ddf");
 	test_files.push_back("../examples/read_test3.ddf");
 
-	DDFIO ddf;
+	//Load all files concurrently
+	vector<DDFResult> results = batchLoad(test_files);
 
-	for (size_t i = 0 ; i < test_files.size() ; i++){
+	for (size_t i = 0 ; i < results.size() ; i++){
 
-		cout << " ****************** Testing " << test_files[i] << " **************** " << endl;
+		cout << " ****************** Testing " << results[i].file << " **************** " << endl;
 
-		if (!ddf.load(test_files[i])){
-			cout << "Failed to read file '" << test_files[i] << "'." << endl;
-			cout << ddf.err() << endl;
+		if (!results[i].success){
+			cout << "Failed to read file '" << results[i].file << "'." << endl;
+			cout << results[i].err << endl;
 		}else{
-			cout << ddf.show() << endl;
-			ddf.clear();
+			cout << results[i].ddf.show() << endl;
 		}
 	}
 